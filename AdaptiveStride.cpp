@@ -0,0 +1,55 @@
+#include "AdaptiveStride.hpp"
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+	const cv::Size THUMBNAIL_SIZE(64, 64);
+}
+
+AdaptiveStride::AdaptiveStride(std::size_t max_stride, double pixel_threshold, int changed_pixels)
+	:max_stride_(std::max<std::size_t>(1, max_stride)), pixel_threshold_(pixel_threshold), changed_pixels_(std::max(1, changed_pixels)) {
+}
+
+bool AdaptiveStride::isStatic(const cv::Mat& frame) {
+	cv::resize(frame, this->thumbnail_, THUMBNAIL_SIZE, 0, 0, cv::INTER_AREA);
+	if (this->thumbnail_.channels() != 1) {
+		cv::cvtColor(this->thumbnail_, this->thumbnail_, cv::COLOR_BGR2GRAY);
+	}
+	if (this->reference_.empty()) {
+		this->thumbnail_.copyTo(this->reference_);
+		return false;
+	}
+	cv::absdiff(this->thumbnail_, this->reference_, this->diff_);
+	cv::threshold(this->diff_, this->diff_, this->pixel_threshold_, 255, cv::THRESH_BINARY);
+	if (cv::countNonZero(this->diff_) < this->changed_pixels_) {
+		return true;
+	}
+	this->thumbnail_.copyTo(this->reference_);
+	return false;
+}
+
+std::size_t AdaptiveStride::update(bool near_line, bool has_detections, bool is_static) {
+	if (near_line) {
+		this->stride_ = 1;
+	}
+	else if (is_static || !has_detections) {
+		this->stride_ = std::min(this->stride_ * 2, this->max_stride_);
+	}
+	else {
+		this->stride_ = std::min(this->stride_ + 1, this->max_stride_);
+	}
+	return this->stride_;
+}
+
+std::size_t AdaptiveStride::stride()const {
+	return this->stride_;
+}
+
+const cv::Mat& AdaptiveStride::reference()const {
+	return this->reference_;
+}
+
+void AdaptiveStride::restore(std::size_t stride, const cv::Mat& reference) {
+	this->stride_ = std::max<std::size_t>(1, std::min(stride, this->max_stride_));
+	reference.copyTo(this->reference_);
+}
@@ -0,0 +1,55 @@
+#ifndef __ADAPTIVE_STRIDE_HPP__
+#define __ADAPTIVE_STRIDE_HPP__
+#include <opencv2/core.hpp>
+
+/**
+ * Chooses how many frames to advance after each processed frame.
+ *
+ * A small grayscale thumbnail of each frame is compared with the last frame that changed;
+ * while the scene is static segmentation can be skipped. A fruit covers only a few thumbnail
+ * pixels, so the frame changed when enough single pixels did, whatever the mean difference.
+ * The stride grows while nothing is near a counting line and drops back to 1 as soon as
+ * something is, so a crossing is always observed on consecutive frames.
+ */
+class AdaptiveStride {
+private:
+	std::size_t max_stride_;
+	double pixel_threshold_;
+	int changed_pixels_;
+	std::size_t stride_ = 1;
+	cv::Mat reference_;
+	cv::Mat thumbnail_;
+	cv::Mat diff_;
+public:
+	/**
+	 * \param[in] max_stride upper bound of the stride
+	 * \param[in] pixel_threshold absolute difference (0-255) above which a thumbnail pixel changed
+	 * \param[in] changed_pixels number of changed thumbnail pixels from which a frame is not static
+	 */
+	AdaptiveStride(std::size_t max_stride = 8, double pixel_threshold = 8.0, int changed_pixels = 1);
+
+	/**
+	 * Returns true if frame looks the same as the last non-static frame.
+	 */
+	bool isStatic(const cv::Mat& frame);
+
+	/**
+	 * Updates and returns the stride.
+	 * \param[in] near_line something is close enough to a counting line to cross it soon
+	 * \param[in] has_detections there is at least one detection in the frame
+	 * \param[in] is_static result of isStatic for the frame
+	 */
+	std::size_t update(bool near_line, bool has_detections, bool is_static);
+	std::size_t stride()const;
+
+	/**
+	 * Thumbnail of the last non-static frame, empty before the first frame.
+	 */
+	const cv::Mat& reference()const;
+
+	/**
+	 * Continues from the stride and reference of an earlier run.
+	 */
+	void restore(std::size_t stride, const cv::Mat& reference);
+};
+#endif
@@ -0,0 +1,196 @@
+#include "BandComponents.hpp"
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+void BandComponents::reset(int rows, int bands) {
+	bands = std::max(1, std::min(bands, rows));
+	this->bands_.resize(bands);
+	for (int i = 0; i < bands; ++i) {
+		this->bands_[i].y0 = static_cast<int>(static_cast<long long>(rows) * i / bands);
+		this->bands_[i].y1 = static_cast<int>(static_cast<long long>(rows) * (i + 1) / bands);
+	}
+}
+
+int BandComponents::bands()const {
+	return static_cast<int>(this->bands_.size());
+}
+
+cv::Range BandComponents::band(int i)const {
+	return cv::Range(this->bands_[i].y0, this->bands_[i].y1);
+}
+
+void BandComponents::label(const cv::Mat& binary, int i) {
+	Band& band = this->bands_[i];
+	band.rects.clear();
+	band.top_x.clear();
+	band.first.clear();
+	band.last.clear();
+	band.background_count = 0;
+	band.background_first.clear();
+	band.background_last.clear();
+	if (band.y0 >= band.y1) {
+		return;
+	}
+	const cv::Mat rows = binary.rowRange(band.y0, band.y1);
+	const int n = cv::connectedComponentsWithStats(rows, band.labels, band.stats, band.centroids, 8, CV_32S);
+	for (int l = 1; l < n; ++l) {
+		const int* s = band.stats.ptr<int>(l);
+		band.rects.push_back(cv::Rect(
+			s[cv::CC_STAT_LEFT],
+			s[cv::CC_STAT_TOP] + band.y0,
+			s[cv::CC_STAT_WIDTH],
+			s[cv::CC_STAT_HEIGHT]));
+		const int* top = band.labels.ptr<int>(s[cv::CC_STAT_TOP]);
+		int x = s[cv::CC_STAT_LEFT];
+		while (top[x] != l) {
+			++x;
+		}
+		band.top_x.push_back(x);
+	}
+	const int* first = band.labels.ptr<int>(0);
+	const int* last = band.labels.ptr<int>(band.labels.rows - 1);
+	band.first.assign(first, first + band.labels.cols);
+	band.last.assign(last, last + band.labels.cols);
+	// findContours follows the foreground 8-connected, so the background it encloses is 4-connected
+	cv::compare(rows, 0, band.inverted, cv::CMP_EQ);
+	band.background_count = cv::connectedComponents(band.inverted, band.background, 4, CV_32S) - 1;
+	const int* background_first = band.background.ptr<int>(0);
+	const int* background_last = band.background.ptr<int>(band.background.rows - 1);
+	band.background_first.assign(background_first, background_first + band.background.cols);
+	band.background_last.assign(background_last, background_last + band.background.cols);
+}
+
+int BandComponents::find(std::vector<int>& parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+void BandComponents::merge(std::vector<cv::Rect>& rects) {
+	// component l of band b is offsets[b] + l - 1, background component l is background_offsets[b] + l - 1
+	std::vector<int> offsets(this->bands_.size() + 1, 0);
+	std::vector<int> background_offsets(this->bands_.size() + 1, 0);
+	for (std::size_t b = 0; b < this->bands_.size(); ++b) {
+		offsets[b + 1] = offsets[b] + static_cast<int>(this->bands_[b].rects.size());
+		background_offsets[b + 1] = background_offsets[b] + this->bands_[b].background_count;
+	}
+	this->parent_.resize(offsets.back());
+	for (int i = 0; i < offsets.back(); ++i) {
+		this->parent_[i] = i;
+	}
+	this->background_parent_.resize(background_offsets.back());
+	for (int i = 0; i < background_offsets.back(); ++i) {
+		this->background_parent_[i] = i;
+	}
+	auto join = [](std::vector<int>& parent, int a, int c) {
+		a = BandComponents::find(parent, a);
+		c = BandComponents::find(parent, c);
+		if (a != c) {
+			parent[std::max(a, c)] = std::min(a, c);
+		}
+	};
+	// the bands of a seam are the last non-empty band above and the next one below
+	int above = -1;
+	int last_band = -1;
+	for (int b = 0; b < static_cast<int>(this->bands_.size()); ++b) {
+		const Band& band = this->bands_[b];
+		if (band.y0 >= band.y1) {
+			continue;
+		}
+		if (above >= 0) {
+			const std::vector<int>& top = this->bands_[above].last;
+			const std::vector<int>& bottom = band.first;
+			const std::vector<int>& background_top = this->bands_[above].background_last;
+			const std::vector<int>& background_bottom = band.background_first;
+			const int cols = static_cast<int>(top.size());
+			for (int x = 0; x < cols; ++x) {
+				if (background_top[x] != 0 && background_bottom[x] != 0) {
+					join(this->background_parent_, background_offsets[above] + background_top[x] - 1, background_offsets[b] + background_bottom[x] - 1);
+				}
+				if (top[x] == 0) {
+					continue;
+				}
+				for (int dx = -1; dx <= 1; ++dx) {
+					if (x + dx >= 0 && x + dx < cols && bottom[x + dx] != 0) {
+						join(this->parent_, offsets[above] + top[x] - 1, offsets[b] + bottom[x + dx] - 1);
+					}
+				}
+			}
+		}
+		above = b;
+		last_band = b;
+	}
+	// findContours pads the image with background, so background on the border is outside of every component
+	this->is_outside_.assign(background_offsets.back(), false);
+	auto markOutside = [this, &background_offsets](int b, int label) {
+		if (label != 0) {
+			this->is_outside_[BandComponents::find(this->background_parent_, background_offsets[b] + label - 1)] = true;
+		}
+	};
+	int first_band = -1;
+	for (int b = 0; b < static_cast<int>(this->bands_.size()); ++b) {
+		const Band& band = this->bands_[b];
+		if (band.y0 >= band.y1) {
+			continue;
+		}
+		if (first_band < 0) {
+			first_band = b;
+			for (const int label : band.background_first) {
+				markOutside(b, label);
+			}
+		}
+		if (b == last_band) {
+			for (const int label : band.background_last) {
+				markOutside(b, label);
+			}
+		}
+		for (int y = 0; y < band.background.rows; ++y) {
+			const int* row = band.background.ptr<int>(y);
+			markOutside(b, row[0]);
+			markOutside(b, row[band.background.cols - 1]);
+		}
+	}
+	// roots are the lowest index of their set, so rects come out in raster order of the first pixel rows
+	rects.clear();
+	const int UNSEEN = -1;
+	const int ENCLOSED = -2;
+	std::vector<int> slot(offsets.back(), UNSEEN);
+	above = -1;
+	for (int b = 0; b < static_cast<int>(this->bands_.size()); ++b) {
+		const Band& band = this->bands_[b];
+		for (std::size_t l = 0; l < band.rects.size(); ++l) {
+			const int root = BandComponents::find(this->parent_, offsets[b] + static_cast<int>(l));
+			if (slot[root] == ENCLOSED) {
+				continue;
+			}
+			if (slot[root] >= 0) {
+				rects[slot[root]] |= band.rects[l];
+				continue;
+			}
+			// the first piece holds the top row, and the pixel above its leftmost top pixel is background
+			// outside of the component: the image border, or the hole of another component
+			const cv::Rect& rect = band.rects[l];
+			const int x = band.top_x[l];
+			bool is_outside = true;
+			if (rect.y > band.y0) {
+				const int label = band.background.ptr<int>(rect.y - 1 - band.y0)[x];
+				is_outside = this->is_outside_[BandComponents::find(this->background_parent_, background_offsets[b] + label - 1)];
+			}
+			else if (rect.y > 0) {
+				const int label = this->bands_[above].background_last[x];
+				is_outside = this->is_outside_[BandComponents::find(this->background_parent_, background_offsets[above] + label - 1)];
+			}
+			if (!is_outside) {
+				slot[root] = ENCLOSED;
+				continue;
+			}
+			slot[root] = static_cast<int>(rects.size());
+			rects.push_back(rect);
+		}
+		if (band.y0 < band.y1) {
+			above = b;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef __BAND_COMPONENTS_HPP__
+#define __BAND_COMPONENTS_HPP__
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Bounding rects of the 8-connected components of a binary image that is labeled
+ * in horizontal bands, possibly in parallel, and joined across the seams afterwards.
+ *
+ * The rects are those of cv::findContours(RETR_EXTERNAL) on the whole image: components
+ * lying in a hole of another one are dropped. They come in raster order of their top rows
+ * rather than in the order of findContours.
+ */
+class BandComponents {
+private:
+	struct Band {
+		int y0 = 0;
+		int y1 = 0;
+		cv::Mat labels;
+		cv::Mat stats;
+		cv::Mat centroids;
+		/** labels of the first and the last row of the band */
+		std::vector<int> first;
+		std::vector<int> last;
+		/** rects of labels 1.. in image coordinates */
+		std::vector<cv::Rect> rects;
+		/** x of the leftmost pixel in the top row of labels 1.. */
+		std::vector<int> top_x;
+		/** 4-connected components of the background, labels 1.. (0 is the foreground) */
+		cv::Mat inverted;
+		cv::Mat background;
+		int background_count = 0;
+		std::vector<int> background_first;
+		std::vector<int> background_last;
+	};
+	std::vector<Band> bands_;
+	std::vector<int> parent_;
+	std::vector<int> background_parent_;
+	std::vector<bool> is_outside_;
+	static int find(std::vector<int>& parent, int i);
+public:
+	/**
+	 * Splits rows into bands of about equal height.
+	 */
+	void reset(int rows, int bands);
+	int bands()const;
+	cv::Range band(int i)const;
+
+	/**
+	 * Labels band i of binary, a CV_8UC1 image of the rows given to reset.
+	 * Different bands can be labeled concurrently.
+	 */
+	void label(const cv::Mat& binary, int i);
+
+	/**
+	 * Joins the components touching across the seams once every band is labeled,
+	 * and drops the ones that the background around them does not connect to the image border.
+	 */
+	void merge(std::vector<cv::Rect>& rects);
+};
+#endif
@@ -0,0 +1,226 @@
+#include "BinaryMorphology.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	const int WORD_BITS = 64;
+
+	/**
+	 * dst[x] = src[x + d] for every pixel of the row, pixels outside read as fill.
+	 * Positive d looks to the right, negative to the left.
+	 */
+	void shiftRow(const std::uint64_t* src, std::uint64_t* dst, int words, int d, std::uint64_t fill) {
+		const bool right = d > 0;
+		const int n = right ? d : -d;
+		const int word_shift = n / WORD_BITS;
+		const int bit_shift = n % WORD_BITS;
+		for (int w = 0; w < words; ++w) {
+			const int s0 = right ? w + word_shift : w - word_shift;
+			const int s1 = right ? s0 + 1 : s0 - 1;
+			const std::uint64_t a = (s0 >= 0 && s0 < words) ? src[s0] : fill;
+			const std::uint64_t b = (s1 >= 0 && s1 < words) ? src[s1] : fill;
+			if (bit_shift == 0) {
+				dst[w] = a;
+			}
+			else if (right) {
+				dst[w] = (a >> bit_shift) | (b << (WORD_BITS - bit_shift));
+			}
+			else {
+				dst[w] = (a << bit_shift) | (b >> (WORD_BITS - bit_shift));
+			}
+		}
+	}
+
+	template<bool IS_ERODE>
+	void rowPass(const BitMask& src, BitMask& dst, int r) {
+		const int words = src.wordsPerRow();
+		const std::uint64_t fill = IS_ERODE ? ~std::uint64_t(0) : 0;
+		const std::uint64_t last_mask = src.lastWordMask();
+		std::vector<std::uint64_t> padded(words), shifted(words);
+		for (int y = 0; y < src.rows(); ++y) {
+			std::copy(src.row(y), src.row(y) + words, padded.begin());
+			if (IS_ERODE) {
+				// pixels past cols are outside of the image
+				padded[words - 1] |= ~last_mask;
+			}
+			std::uint64_t* out = dst.row(y);
+			std::copy(padded.begin(), padded.end(), out);
+			for (int d = 1; d <= r; ++d) {
+				::shiftRow(padded.data(), shifted.data(), words, d, fill);
+				for (int w = 0; w < words; ++w) {
+					out[w] = IS_ERODE ? (out[w] & shifted[w]) : (out[w] | shifted[w]);
+				}
+				::shiftRow(padded.data(), shifted.data(), words, -d, fill);
+				for (int w = 0; w < words; ++w) {
+					out[w] = IS_ERODE ? (out[w] & shifted[w]) : (out[w] | shifted[w]);
+				}
+			}
+			out[words - 1] &= last_mask;
+		}
+	}
+
+	template<bool IS_ERODE>
+	void columnPass(const BitMask& src, BitMask& dst, int r) {
+		const int words = src.wordsPerRow();
+		for (int y = 0; y < src.rows(); ++y) {
+			const int y0 = std::max(0, y - r);
+			const int y1 = std::min(src.rows() - 1, y + r);
+			std::uint64_t* out = dst.row(y);
+			std::copy(src.row(y0), src.row(y0) + words, out);
+			for (int yy = y0 + 1; yy <= y1; ++yy) {
+				const std::uint64_t* in = src.row(yy);
+				for (int w = 0; w < words; ++w) {
+					out[w] = IS_ERODE ? (out[w] & in[w]) : (out[w] | in[w]);
+				}
+			}
+		}
+	}
+
+	template<bool IS_ERODE>
+	void morphRect(const BitMask& src, BitMask& dst, int rx, int ry) {
+		if (src.rows() == 0 || src.cols() == 0) {
+			dst.create(src.rows(), src.cols());
+			return;
+		}
+		BitMask temp(src.rows(), src.cols());
+		::rowPass<IS_ERODE>(src, temp, rx);
+		dst.create(src.rows(), src.cols());
+		::columnPass<IS_ERODE>(temp, dst, ry);
+	}
+}
+
+BitMask::BitMask() {
+}
+
+BitMask::BitMask(int rows, int cols) {
+	this->create(rows, cols);
+}
+
+void BitMask::create(int rows, int cols) {
+	this->rows_ = rows;
+	this->cols_ = cols;
+	this->words_per_row_ = (cols + WORD_BITS - 1) / WORD_BITS;
+	this->bits_.assign(static_cast<std::size_t>(rows) * this->words_per_row_, 0);
+}
+
+int BitMask::rows()const {
+	return this->rows_;
+}
+
+int BitMask::cols()const {
+	return this->cols_;
+}
+
+int BitMask::wordsPerRow()const {
+	return this->words_per_row_;
+}
+
+std::uint64_t* BitMask::row(int y) {
+	return this->bits_.data() + static_cast<std::size_t>(y) * this->words_per_row_;
+}
+
+const std::uint64_t* BitMask::row(int y)const {
+	return this->bits_.data() + static_cast<std::size_t>(y) * this->words_per_row_;
+}
+
+std::uint64_t BitMask::lastWordMask()const {
+	const int used = this->cols_ - (this->words_per_row_ - 1) * WORD_BITS;
+	return used >= WORD_BITS ? ~std::uint64_t(0) : ((std::uint64_t(1) << used) - 1);
+}
+
+void packThreshold(const cv::Mat& src, double thresh, BitMask& dst) {
+	CV_Assert(src.type() == CV_8UC1);
+	dst.create(src.rows, src.cols);
+	for (int y = 0; y < src.rows; ++y) {
+		const unsigned char* in = src.ptr<unsigned char>(y);
+		std::uint64_t* out = dst.row(y);
+		for (int w = 0; w < dst.wordsPerRow(); ++w) {
+			const int x0 = w * WORD_BITS;
+			const int n = std::min(WORD_BITS, src.cols - x0);
+			std::uint64_t bits = 0;
+			for (int j = 0; j < n; ++j) {
+				bits |= static_cast<std::uint64_t>(in[x0 + j] > thresh) << j;
+			}
+			out[w] = bits;
+		}
+	}
+}
+
+void packThreshold(const cv::Mat& src, double thresh, const cv::Rect& rect, BitMask& dst) {
+	CV_Assert(src.type() == CV_8UC1 && dst.rows() == src.rows && dst.cols() == src.cols && rect.x % WORD_BITS == 0);
+	const int x_end = rect.x + rect.width;
+	for (int y = rect.y; y < rect.y + rect.height; ++y) {
+		const unsigned char* in = src.ptr<unsigned char>(y);
+		std::uint64_t* out = dst.row(y);
+		for (int x0 = rect.x; x0 < x_end; x0 += WORD_BITS) {
+			const int n = std::min(WORD_BITS, src.cols - x0);
+			std::uint64_t bits = 0;
+			for (int j = 0; j < n; ++j) {
+				bits |= static_cast<std::uint64_t>(in[x0 + j] > thresh) << j;
+			}
+			out[x0 / WORD_BITS] = bits;
+		}
+	}
+}
+
+void unpackMask(const BitMask& src, cv::Mat& dst) {
+	dst.create(src.rows(), src.cols(), CV_8UC1);
+	for (int y = 0; y < src.rows(); ++y) {
+		const std::uint64_t* in = src.row(y);
+		unsigned char* out = dst.ptr<unsigned char>(y);
+		for (int x = 0; x < src.cols(); ++x) {
+			out[x] = ((in[x / WORD_BITS] >> (x % WORD_BITS)) & 1) ? 255 : 0;
+		}
+	}
+}
+
+void unpackMask(const BitMask& src, cv::Mat& dst, int y0, int y1) {
+	for (int y = y0; y < y1; ++y) {
+		const std::uint64_t* in = src.row(y);
+		unsigned char* out = dst.ptr<unsigned char>(y);
+		for (int x = 0; x < src.cols(); ++x) {
+			out[x] = ((in[x / WORD_BITS] >> (x % WORD_BITS)) & 1) ? 255 : 0;
+		}
+	}
+}
+
+void erodeRect(const BitMask& src, BitMask& dst, int rx, int ry) {
+	::morphRect<true>(src, dst, rx, ry);
+}
+
+void dilateRect(const BitMask& src, BitMask& dst, int rx, int ry) {
+	::morphRect<false>(src, dst, rx, ry);
+}
+
+void openRect(const BitMask& src, BitMask& dst, int rx, int ry) {
+	if (src.rows() == 0 || src.cols() == 0) {
+		dst.create(src.rows(), src.cols());
+		return;
+	}
+	BitMask a(src.rows(), src.cols());
+	BitMask b(src.rows(), src.cols());
+	::rowPass<true>(src, a, rx);
+	::columnPass<true>(a, b, ry);
+	::rowPass<false>(b, a, rx);
+	dst.create(src.rows(), src.cols());
+	::columnPass<false>(a, dst, ry);
+}
+
+void openRect(const BitMask& src, BitMask& dst, int rx, int ry, int y0, int y1) {
+	if (y0 >= y1 || src.cols() == 0) {
+		return;
+	}
+	// erosion is exact from ry rows inside the halo on, and dilation reads ry rows of it
+	const int top = std::max(0, y0 - 2 * ry);
+	const int bottom = std::min(src.rows(), y1 + 2 * ry);
+	const std::size_t row_bytes = src.wordsPerRow() * sizeof(std::uint64_t);
+	BitMask band(bottom - top, src.cols());
+	for (int y = top; y < bottom; ++y) {
+		std::memcpy(band.row(y - top), src.row(y), row_bytes);
+	}
+	BitMask opened;
+	::openRect(band, opened, rx, ry);
+	for (int y = y0; y < y1; ++y) {
+		std::memcpy(dst.row(y), opened.row(y - top), row_bytes);
+	}
+}
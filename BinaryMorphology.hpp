@@ -0,0 +1,155 @@
+#ifndef __BINARY_MORPHOLOGY_HPP__
+#define __BINARY_MORPHOLOGY_HPP__
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+/**
+ * Binary image packed 64 pixels per word. Bit j of word w in a row is pixel w * 64 + j.
+ * Bits past cols in the last word of a row are always 0.
+ */
+class BitMask {
+private:
+	int rows_ = 0;
+	int cols_ = 0;
+	int words_per_row_ = 0;
+	std::vector<std::uint64_t> bits_;
+public:
+	BitMask();
+	BitMask(int rows, int cols);
+	void create(int rows, int cols);
+	int rows()const;
+	int cols()const;
+	int wordsPerRow()const;
+	std::uint64_t* row(int y);
+	const std::uint64_t* row(int y)const;
+	/**
+	 * Bits of the last word of a row that are inside the image.
+	 */
+	std::uint64_t lastWordMask()const;
+};
+
+/**
+ * dst = src > thresh, same as cv::threshold(THRESH_BINARY) on a CV_8UC1 image.
+ */
+void packThreshold(const cv::Mat& src, double thresh, BitMask& dst);
+
+/**
+ * packThreshold of rect only; the rest of dst is kept. dst must already have the size of src
+ * and rect.x must be a multiple of 64, so rect covers whole words up to the end of the row.
+ */
+void packThreshold(const cv::Mat& src, double thresh, const cv::Rect& rect, BitMask& dst);
+
+/**
+ * Expands a mask back to a CV_8UC1 image of 0 and 255.
+ */
+void unpackMask(const BitMask& src, cv::Mat& dst);
+
+/**
+ * unpackMask of rows [y0, y1) only; the other rows of dst are kept.
+ * dst must already be a CV_8UC1 image of the size of src.
+ */
+void unpackMask(const BitMask& src, cv::Mat& dst, int y0, int y1);
+
+/**
+ * Erosion / dilation with a (2 * rx + 1) x (2 * ry + 1) rectangle, done as a row pass and a column pass.
+ * Pixels outside the image do not affect the result, as with OpenCV's default border.
+ */
+void erodeRect(const BitMask& src, BitMask& dst, int rx, int ry);
+void dilateRect(const BitMask& src, BitMask& dst, int rx, int ry);
+
+/**
+ * Opening with a (2 * rx + 1) x (2 * ry + 1) rectangle.
+ * n iterations of cv::erode/cv::dilate with the default 3x3 kernel equal openRect with rx = ry = n.
+ */
+void openRect(const BitMask& src, BitMask& dst, int rx, int ry);
+
+/**
+ * Rows [y0, y1) of openRect(src, dst, rx, ry); the other rows of dst are kept.
+ * dst must already have the size of src. Only rows within 2 * ry of the band are read,
+ * so disjoint bands can be opened in parallel.
+ */
+void openRect(const BitMask& src, BitMask& dst, int rx, int ry, int y0, int y1);
+/**
+ * Erosion (IS_ERODE) or dilation of one row along x with a (2 * R + 1) segment.
+ * R is below the word size, so a word only needs the words next to it and every shift is a constant.
+ */
+template<int R, bool IS_ERODE>
+void morphRowFixed(const std::uint64_t* src, std::uint64_t* dst, int words, std::uint64_t last_mask) {
+	static_assert(R >= 1 && R < 64, "R must be less than the word size");
+	const std::uint64_t fill = IS_ERODE ? ~std::uint64_t(0) : 0;
+	// pixels past cols are outside of the image
+	const std::uint64_t outside = IS_ERODE ? ~last_mask : 0;
+	std::uint64_t prev = fill;
+	std::uint64_t cur = words == 1 ? (src[0] | outside) : src[0];
+	for (int w = 0; w < words; ++w) {
+		const std::uint64_t next = w + 1 < words ? (w + 2 == words ? (src[w + 1] | outside) : src[w + 1]) : fill;
+		std::uint64_t out = cur;
+		for (int d = 1; d <= R; ++d) {
+			const std::uint64_t right = (cur >> d) | (next << (64 - d));
+			const std::uint64_t left = (cur << d) | (prev >> (64 - d));
+			out = IS_ERODE ? (out & right & left) : (out | right | left);
+		}
+		dst[w] = out;
+		prev = cur;
+		cur = next;
+	}
+	dst[words - 1] &= last_mask;
+}
+
+/**
+ * Erosion (IS_ERODE) or dilation of row y along y with a (2 * R + 1) segment.
+ * Rows past the image repeat the edge row, which leaves both operations unchanged.
+ * \param[in] row returns the row of the source image at an index in [0, rows)
+ */
+template<int R, bool IS_ERODE, class Row>
+void morphColumnFixed(const Row& row, int rows, int y, std::uint64_t* dst, int words) {
+	const std::uint64_t* in[2 * R + 1];
+	for (int d = -R; d <= R; ++d) {
+		in[d + R] = row(std::min(rows - 1, std::max(0, y + d)));
+	}
+	for (int w = 0; w < words; ++w) {
+		std::uint64_t out = in[0][w];
+		for (int k = 1; k <= 2 * R; ++k) {
+			out = IS_ERODE ? (out & in[k][w]) : (out | in[k][w]);
+		}
+		dst[w] = out;
+	}
+}
+
+/**
+ * Rows [y0, y1) of openRect(src, dst, R, R) with the radius fixed at compile time, so the
+ * shift and row loops unroll. dst must already have the size of src; the other rows are kept.
+ * Only rows within 2 * R of the band are read, so disjoint bands can be opened in parallel.
+ */
+template<int R>
+void openSquare(const BitMask& src, BitMask& dst, int y0, int y1) {
+	if (y0 >= y1 || src.cols() == 0) {
+		return;
+	}
+	const int rows = src.rows();
+	const int words = src.wordsPerRow();
+	const std::uint64_t last_mask = src.lastWordMask();
+	// the row pass of the erosion covers [top, bottom), the erosion [eroded_top, eroded_bottom)
+	const int top = std::max(0, y0 - 2 * R);
+	const int bottom = std::min(rows, y1 + 2 * R);
+	const int eroded_top = std::max(0, y0 - R);
+	const int eroded_bottom = std::min(rows, y1 + R);
+	BitMask a(bottom - top, src.cols());
+	BitMask b(bottom - top, src.cols());
+	for (int y = top; y < bottom; ++y) {
+		::morphRowFixed<R, true>(src.row(y), a.row(y - top), words, last_mask);
+	}
+	auto a_row = [&a, top](int y) { return static_cast<const BitMask&>(a).row(y - top); };
+	for (int y = eroded_top; y < eroded_bottom; ++y) {
+		::morphColumnFixed<R, true>(a_row, rows, y, b.row(y - top), words);
+	}
+	for (int y = eroded_top; y < eroded_bottom; ++y) {
+		::morphRowFixed<R, false>(b.row(y - top), a.row(y - top), words, last_mask);
+	}
+	for (int y = y0; y < y1; ++y) {
+		::morphColumnFixed<R, false>(a_row, rows, y, dst.row(y), words);
+	}
+}
+#endif
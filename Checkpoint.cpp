@@ -0,0 +1,134 @@
+#include "Checkpoint.hpp"
+#include "StateFile.hpp"
+#include <fstream>
+#include <limits>
+
+namespace {
+	const char CHECKPOINT_MAGIC[] = "FruitsCounterCheckpoint";
+	const int CHECKPOINT_VERSION = 1;
+
+	void writeTracks(std::ostream& os, const std::vector<MotionTracker::Track>& tracks) {
+		os << "tracks " << tracks.size() << "\n";
+		for (const auto& t : tracks) {
+			os << t.position.x << " " << t.position.y << " " << t.velocity.x << " " << t.velocity.y << " "
+				<< t.last_frame << " " << t.hits << " " << t.misses << "\n";
+		}
+	}
+
+	bool readTracks(std::istream& is, std::vector<MotionTracker::Track>& tracks) {
+		std::string key;
+		std::size_t size = 0;
+		if (!(is >> key >> size) || key != "tracks") {
+			return false;
+		}
+		tracks.resize(size);
+		for (auto& t : tracks) {
+			if (!(is >> t.position.x >> t.position.y >> t.velocity.x >> t.velocity.y >> t.last_frame >> t.hits >> t.misses)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * CV_8UC1 image as rows of pixel values.
+	 */
+	void writeImage(std::ostream& os, const std::string& name, const cv::Mat& image) {
+		os << name << " " << image.rows << " " << image.cols << "\n";
+		for (int y = 0; y < image.rows; ++y) {
+			const uchar* row = image.ptr<uchar>(y);
+			for (int x = 0; x < image.cols; ++x) {
+				os << (x == 0 ? "" : " ") << static_cast<int>(row[x]);
+			}
+			os << "\n";
+		}
+	}
+
+	bool readImage(std::istream& is, const std::string& name, cv::Mat& image) {
+		std::string key;
+		int rows = 0, cols = 0;
+		if (!(is >> key >> rows >> cols) || key != name || rows < 0 || cols < 0) {
+			return false;
+		}
+		image.create(rows, cols, CV_8UC1);
+		for (int y = 0; y < rows; ++y) {
+			uchar* row = image.ptr<uchar>(y);
+			for (int x = 0; x < cols; ++x) {
+				int value = 0;
+				if (!(is >> value) || value < 0 || value > 255) {
+					return false;
+				}
+				row[x] = static_cast<uchar>(value);
+			}
+		}
+		return true;
+	}
+}
+
+bool writeCheckpoint(const std::string& filename, const CheckpointState& state) {
+	// write to a temporary file first so a crash while writing leaves the previous checkpoint intact
+	const std::string temp = filename + ".tmp";
+	{
+		std::ofstream ofs(temp);
+		if (!ofs) {
+			return false;
+		}
+		// track positions and velocities have to come back bit for bit to reproduce the count
+		ofs.precision(std::numeric_limits<double>::max_digits10);
+		ofs << CHECKPOINT_MAGIC << " " << CHECKPOINT_VERSION << "\n"
+			<< "config " << state.config_hash << "\n"
+			<< "position " << state.next_frame << " " << state.step << " " << state.near_line << "\n"
+			<< "counter " << state.counter.frames << " " << state.counter.frame << " " << state.counter.count << "\n"
+			<< "size " << state.counter.size.width << " " << state.counter.size.height << "\n";
+		::writeRects(ofs, "detections", state.counter.detections);
+		::writeTracks(ofs, state.counter.tracks);
+		ofs << "stride " << state.stride << "\n";
+		::writeImage(ofs, "reference", state.stride_reference);
+		ofs << "events " << state.events_written << "\n";
+		ofs.flush();
+		if (!ofs) {
+			return false;
+		}
+	}
+	return ::replaceFile(temp, filename);
+}
+
+bool readCheckpoint(const std::string& filename, CheckpointState& state) {
+	std::ifstream ifs(filename);
+	std::string magic, key;
+	int version = 0;
+	if (!(ifs >> magic >> version) || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+		return false;
+	}
+	if (!(ifs >> key >> state.config_hash) || key != "config") {
+		return false;
+	}
+	if (!(ifs >> key >> state.next_frame >> state.step >> state.near_line) || key != "position") {
+		return false;
+	}
+	if (!(ifs >> key >> state.counter.frames >> state.counter.frame >> state.counter.count) || key != "counter") {
+		return false;
+	}
+	if (!(ifs >> key >> state.counter.size.width >> state.counter.size.height) || key != "size") {
+		return false;
+	}
+	if (!::readRects(ifs, "detections", state.counter.detections) || !::readTracks(ifs, state.counter.tracks)) {
+		return false;
+	}
+	if (!(ifs >> key >> state.stride) || key != "stride") {
+		return false;
+	}
+	if (!::readImage(ifs, "reference", state.stride_reference)) {
+		return false;
+	}
+	return (ifs >> key >> state.events_written) && key == "events";
+}
+
+std::uint64_t checkpointHash(const std::string& text) {
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const char c : text) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
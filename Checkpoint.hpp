@@ -0,0 +1,35 @@
+#ifndef __CHECKPOINT_HPP__
+#define __CHECKPOINT_HPP__
+#include <string>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include "FruitsCounter.hpp"
+
+/**
+ * Position and state of a counting run of main, enough to continue it after a restart
+ * and arrive at the same count as a run that was never interrupted.
+ */
+struct CheckpointState {
+	/** checkpointHash of the options the count depends on */
+	std::uint64_t config_hash = 0;
+	/** frame the next read starts at */
+	std::size_t next_frame = 0;
+	/** frames to advance after the next processed frame */
+	std::size_t step = 1;
+	bool near_line = false;
+	FruitsCounterState counter;
+	/** AdaptiveStride::stride() and reference() */
+	std::size_t stride = 1;
+	cv::Mat stride_reference;
+	/** CountEventLog::written() once the events of the processed frames were flushed */
+	std::uint64_t events_written = 0;
+};
+
+bool writeCheckpoint(const std::string& filename, const CheckpointState& state);
+bool readCheckpoint(const std::string& filename, CheckpointState& state);
+
+/**
+ * 64-bit FNV-1a hash of a description of the configuration.
+ */
+std::uint64_t checkpointHash(const std::string& text);
+#endif
@@ -0,0 +1,147 @@
+#include "CountEventLog.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <opencv2/core.hpp>
+#include <boost/filesystem.hpp>
+
+const char CountEventFormat::MAGIC[8] = { 'F', 'C', 'E', 'V', 'N', 'T', 0, 0 };
+
+CountEventLog::CountEventLog(std::size_t capacity, double flush_interval)
+	:capacity_(capacity), flush_interval_(flush_interval) {
+}
+
+CountEventLog::~CountEventLog() {
+	this->close();
+}
+
+bool CountEventLog::open(const std::string& filename, Format format) {
+	this->close();
+	if (filename == "-") {
+		this->os_ = &std::cout;
+	}
+	else {
+		const auto mode = format == BINARY ? std::ios::out | std::ios::binary | std::ios::trunc : std::ios::out | std::ios::trunc;
+		this->file_.reset(new std::ofstream(filename, mode));
+		if (!*this->file_) {
+			this->file_.reset();
+			return false;
+		}
+		this->os_ = this->file_.get();
+	}
+	this->format_ = format;
+	this->buffer_.reserve(this->capacity_);
+	this->last_flush_ = cv::getTickCount();
+	this->written_ = 0;
+	if (format == BINARY) {
+		CountEventFormat::Header header;
+		std::memcpy(header.magic, CountEventFormat::MAGIC, sizeof(header.magic));
+		header.version = CountEventFormat::VERSION;
+		header.record_size = sizeof(CountEventFormat::Record);
+		this->append(&header, sizeof(header));
+	}
+	else {
+		const char columns[] = "frame,timestamp,x,y,line,total\n";
+		this->append(columns, sizeof(columns) - 1);
+	}
+	return true;
+}
+
+bool CountEventLog::resume(const std::string& filename, Format format, std::uint64_t written) {
+	namespace bf = boost::filesystem;
+	this->close();
+	if (filename == "-") {
+		this->os_ = &std::cout;
+	}
+	else {
+		boost::system::error_code ec;
+		const std::uint64_t size = bf::file_size(filename, ec);
+		if (ec || size < written) {
+			return false;
+		}
+		bf::resize_file(filename, written, ec);
+		if (ec) {
+			return false;
+		}
+		const auto mode = format == BINARY ? std::ios::out | std::ios::binary | std::ios::app : std::ios::out | std::ios::app;
+		this->file_.reset(new std::ofstream(filename, mode));
+		if (!*this->file_) {
+			this->file_.reset();
+			return false;
+		}
+		this->os_ = this->file_.get();
+	}
+	this->format_ = format;
+	this->buffer_.reserve(this->capacity_);
+	this->last_flush_ = cv::getTickCount();
+	this->written_ = written;
+	return true;
+}
+
+bool CountEventLog::isOpened()const {
+	return this->os_ != nullptr;
+}
+
+void CountEventLog::append(const void* data, std::size_t size) {
+	const char* bytes = static_cast<const char*>(data);
+	this->buffer_.insert(this->buffer_.end(), bytes, bytes + size);
+}
+
+void CountEventLog::write(const CountEvent& event) {
+	if (!this->os_) {
+		return;
+	}
+	if (this->format_ == BINARY) {
+		CountEventFormat::Record record;
+		record.frame = event.frame;
+		record.timestamp = event.timestamp;
+		record.x = event.x;
+		record.y = event.y;
+		record.line = event.line;
+		record.reserved = 0;
+		record.total = event.total;
+		this->append(&record, sizeof(record));
+	}
+	else {
+		char line[128];
+		const int length = std::snprintf(line, sizeof(line), "%llu,%.3f,%d,%d,%d,%llu\n",
+			static_cast<unsigned long long>(event.frame), event.timestamp,
+			event.x, event.y, event.line,
+			static_cast<unsigned long long>(event.total));
+		this->append(line, static_cast<std::size_t>(length));
+	}
+	if (this->buffer_.size() >= this->capacity_) {
+		this->flush();
+	}
+	else {
+		this->flushIfDue();
+	}
+}
+
+void CountEventLog::flushIfDue() {
+	if (!this->buffer_.empty()
+		&& (cv::getTickCount() - this->last_flush_) / cv::getTickFrequency() >= this->flush_interval_) {
+		this->flush();
+	}
+}
+
+void CountEventLog::flush() {
+	if (this->os_ && !this->buffer_.empty()) {
+		this->os_->write(this->buffer_.data(), this->buffer_.size());
+		this->os_->flush();
+		this->written_ += this->buffer_.size();
+		this->buffer_.clear();
+	}
+	this->last_flush_ = cv::getTickCount();
+}
+
+void CountEventLog::close() {
+	this->flush();
+	this->file_.reset();
+	this->os_ = nullptr;
+}
+
+std::uint64_t CountEventLog::written()const {
+	return this->written_;
+}
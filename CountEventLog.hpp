@@ -0,0 +1,105 @@
+#ifndef __COUNT_EVENT_LOG_HPP__
+#define __COUNT_EVENT_LOG_HPP__
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+
+/**
+ * One counted tomato.
+ * line is the index of the crossed counting line, RANGE for a tomato counted
+ * because it was in range at the first frame or out of range at the last frame,
+ * or MANUAL for a tomato counted by hand in counter.
+ * timestamp is the time of frame in the source (frame / frame rate), or the frame index
+ * if the frame rate is unknown, so a rerun writes the same log.
+ */
+struct CountEvent {
+	static const std::int32_t RANGE = -1;
+	static const std::int32_t MANUAL = -2;
+	std::uint64_t frame;
+	double timestamp;
+	std::int32_t x;
+	std::int32_t y;
+	std::int32_t line;
+	std::uint64_t total;
+};
+
+/**
+ * Binary event log.
+ *
+ * Layout (native endian):
+ *   Header
+ *   Record records[]   until the end of the file
+ */
+struct CountEventFormat {
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t record_size;
+	};
+	struct Record {
+		std::uint64_t frame;
+		double timestamp;
+		std::int32_t x;
+		std::int32_t y;
+		std::int32_t line;
+		std::int32_t reserved;
+		std::uint64_t total;
+	};
+	static const std::uint32_t VERSION = 1;
+	static const char MAGIC[8];
+};
+
+/**
+ * Buffered writer of count events as CSV or CountEventFormat records.
+ *
+ * Records are formatted into an in-memory buffer and written when it fills up,
+ * when flush_interval seconds have passed since the last write, or on close.
+ */
+class CountEventLog {
+public:
+	enum Format {
+		CSV,
+		BINARY
+	};
+private:
+	std::unique_ptr<std::ostream> file_;
+	std::ostream* os_ = nullptr;
+	Format format_ = CSV;
+	std::vector<char> buffer_;
+	std::size_t capacity_;
+	double flush_interval_;
+	std::int64_t last_flush_ = 0;
+	std::uint64_t written_ = 0;
+	void append(const void* data, std::size_t size);
+public:
+	CountEventLog(std::size_t capacity = 64 * 1024, double flush_interval = 1.0);
+	~CountEventLog();
+
+	/**
+	 * \param[in] filename output file, "-" for stdout
+	 */
+	bool open(const std::string& filename, Format format);
+
+	/**
+	 * Continues a log of an earlier run that had written() bytes: the events after them are
+	 * dropped and new ones appended. Stdout can not be rewound, so "-" only appends.
+	 */
+	bool resume(const std::string& filename, Format format, std::uint64_t written);
+	bool isOpened()const;
+	void write(const CountEvent& event);
+
+	/**
+	 * Flushes if flush_interval has passed; cheap enough to call every frame.
+	 */
+	void flushIfDue();
+	void flush();
+	void close();
+
+	/**
+	 * Bytes written to the output, header included; the buffer counts only once flushed.
+	 */
+	std::uint64_t written()const;
+};
+#endif
@@ -0,0 +1,212 @@
+#include "CountingGeometry.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+	const double PI = 3.141592653589793238463;
+
+	double cross(const cv::Point2d& o, const cv::Point2d& a, const cv::Point2d& b) {
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	}
+
+	/**
+	 * Returns true if a-b intersects c-d and sets t to where, 0 at a and 1 at b.
+	 * A point on c-d counts as being on its negative side, so touching a line and moving on counts once.
+	 */
+	bool segmentsIntersect(const cv::Point& a, const cv::Point& b, const cv::Point& c, const cv::Point& d, double& t) {
+		const double d1 = ::cross(c, d, a), d2 = ::cross(c, d, b);
+		const double d3 = ::cross(a, b, c), d4 = ::cross(a, b, d);
+		if (((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0))) {
+			t = d1 != d2 ? d1 / (d1 - d2) : 0.0;
+			return true;
+		}
+		return false;
+	}
+
+	double distanceToSegment(const cv::Point& p, const cv::Point& a, const cv::Point& b) {
+		const double vx = b.x - a.x, vy = b.y - a.y;
+		const double length2 = vx * vx + vy * vy;
+		double t = length2 > 0 ? ((p.x - a.x) * vx + (p.y - a.y) * vy) / length2 : 0.0;
+		t = std::max(0.0, std::min(1.0, t));
+		const double dx = p.x - (a.x + t * vx), dy = p.y - (a.y + t * vy);
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+	bool readPolyline(const cv::FileNode& node, CountingGeometry::Polyline& polyline) {
+		std::vector<int> values;
+		node >> values;
+		if (values.size() < 4 || values.size() % 2 != 0) {
+			return false;
+		}
+		polyline.clear();
+		for (std::size_t i = 0; i < values.size(); i += 2) {
+			polyline.push_back(cv::Point(values[i], values[i + 1]));
+		}
+		return true;
+	}
+}
+
+CountingGeometry::CountingGeometry() {
+}
+
+CountingGeometry CountingGeometry::radial(const cv::Size& size, double line_rad) {
+	const cv::Point center(size.width / 2, size.height / 2);
+	// long enough to leave the image in every direction
+	const double far = 2.0 * (size.width + size.height);
+	auto ray = [&](double theta) {
+		return cv::Point(
+			static_cast<int>(center.x + far * std::cos(theta)),
+			static_cast<int>(center.y + far * std::sin(theta)));
+	};
+	// image y grows downwards, so the range above the center is theta in [-(pi - line_rad), -line_rad]
+	const cv::Point right = ray(-line_rad);
+	const cv::Point left = ray(-(PI - line_rad));
+	std::vector<Polyline> lines;
+	lines.push_back(Polyline{ center, right });
+	lines.push_back(Polyline{ center, left });
+	Polyline range{ center, right, ray(-PI / 2.0), left };
+	CountingGeometry geometry;
+	// two lines make at most three regions
+	geometry.create(size, lines, range);
+	return geometry;
+}
+
+bool CountingGeometry::load(const std::string& filename, const cv::Size& size, CountingGeometry& geometry) {
+	cv::FileStorage fs(filename, cv::FileStorage::READ);
+	if (!fs.isOpened()) {
+		return false;
+	}
+	std::vector<Polyline> lines;
+	for (const auto& node : fs["lines"]) {
+		Polyline line;
+		if (!::readPolyline(node, line)) {
+			return false;
+		}
+		lines.push_back(line);
+	}
+	Polyline range;
+	if (lines.empty() || !::readPolyline(fs["range"], range)) {
+		return false;
+	}
+	return geometry.create(size, lines, range);
+}
+
+bool CountingGeometry::create(const cv::Size& size, const std::vector<Polyline>& lines, const Polyline& range) {
+	// 8-connected lines can not be passed by 4-connected regions
+	cv::Mat boundary = cv::Mat::zeros(size, CV_8UC1);
+	cv::polylines(boundary, lines, false, cv::Scalar(255), 1, cv::LINE_8);
+	cv::Mat free_space = boundary == 0;
+	cv::Mat labels;
+	if (cv::connectedComponents(free_space, labels, 4, CV_32S) - 1 > REGION_MASK) {
+		return false;
+	}
+	this->size_ = size;
+	this->lines_ = lines;
+	const cv::Mat line_pixels = boundary / 255;
+	cv::integral(line_pixels, this->line_sums_, CV_32S);
+	// pixels on a line take the region of a neighbour
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int y = 0; y < size.height; ++y) {
+			int* row = labels.ptr<int>(y);
+			for (int x = 0; x < size.width; ++x) {
+				if (row[x] != 0) {
+					continue;
+				}
+				int label = 0;
+				if (x > 0 && row[x - 1] > 0) label = row[x - 1];
+				else if (y > 0 && labels.ptr<int>(y - 1)[x] > 0) label = labels.ptr<int>(y - 1)[x];
+				else if (x + 1 < size.width && row[x + 1] > 0) label = row[x + 1];
+				else if (y + 1 < size.height && labels.ptr<int>(y + 1)[x] > 0) label = labels.ptr<int>(y + 1)[x];
+				if (label > 0) {
+					row[x] = label;
+					changed = true;
+				}
+			}
+		}
+	}
+	cv::Mat in_range = cv::Mat::zeros(size, CV_8UC1);
+	cv::fillPoly(in_range, std::vector<Polyline>{ range }, cv::Scalar(255));
+	this->regions_.create(size, CV_16UC1);
+	for (int y = 0; y < size.height; ++y) {
+		const int* label = labels.ptr<int>(y);
+		const unsigned char* inside = in_range.ptr<unsigned char>(y);
+		unsigned short* out = this->regions_.ptr<unsigned short>(y);
+		for (int x = 0; x < size.width; ++x) {
+			out[x] = static_cast<unsigned short>(label[x] | (inside[x] ? IN_RANGE_BIT : 0));
+		}
+	}
+	return true;
+}
+
+bool CountingGeometry::empty()const {
+	return this->regions_.empty();
+}
+
+const cv::Size& CountingGeometry::size()const {
+	return this->size_;
+}
+
+unsigned short CountingGeometry::lookup(const cv::Point& p)const {
+	const int x = std::max(0, std::min(this->size_.width - 1, p.x));
+	const int y = std::max(0, std::min(this->size_.height - 1, p.y));
+	return this->regions_.ptr<unsigned short>(y)[x];
+}
+
+bool CountingGeometry::isInRange(const cv::Point& p)const {
+	return (this->lookup(p) & IN_RANGE_BIT) != 0;
+}
+
+bool CountingGeometry::isClear(const cv::Point& a, const cv::Point& b)const {
+	const cv::Rect image(cv::Point(0, 0), this->size_);
+	if (!image.contains(a) || !image.contains(b)
+		|| (this->lookup(a) & REGION_MASK) != (this->lookup(b) & REGION_MASK)) {
+		return false;
+	}
+	// the raster of a line is within half a pixel of it, so a line meeting a-b leaves a pixel in the padded box
+	const int x0 = std::max(0, std::min(a.x, b.x) - 1);
+	const int y0 = std::max(0, std::min(a.y, b.y) - 1);
+	const int x1 = std::min(this->size_.width, std::max(a.x, b.x) + 2);
+	const int y1 = std::min(this->size_.height, std::max(a.y, b.y) + 2);
+	const int sum = this->line_sums_.at<int>(y1, x1) - this->line_sums_.at<int>(y0, x1)
+		- this->line_sums_.at<int>(y1, x0) + this->line_sums_.at<int>(y0, x0);
+	return sum == 0;
+}
+
+std::size_t CountingGeometry::crossedLines(const cv::Point& a, const cv::Point& b, std::vector<int>& lines)const {
+	if (this->isClear(a, b)) {
+		return 0;
+	}
+	std::vector<std::pair<double, int>> crossings;
+	double t;
+	for (std::size_t l = 0; l < this->lines_.size(); ++l) {
+		const auto& line = this->lines_[l];
+		for (std::size_t i = 0; i + 1 < line.size(); ++i) {
+			if (::segmentsIntersect(a, b, line[i], line[i + 1], t)) {
+				crossings.push_back(std::make_pair(t, static_cast<int>(l)));
+			}
+		}
+	}
+	std::sort(crossings.begin(), crossings.end());
+	for (const auto& crossing : crossings) {
+		lines.push_back(crossing.second);
+	}
+	return crossings.size();
+}
+
+double CountingGeometry::distanceToLines(const cv::Point& p)const {
+	double distance = std::numeric_limits<double>::infinity();
+	for (const auto& line : this->lines_) {
+		for (std::size_t i = 0; i + 1 < line.size(); ++i) {
+			distance = std::min(distance, ::distanceToSegment(p, line[i], line[i + 1]));
+		}
+	}
+	return distance;
+}
+
+const std::vector<CountingGeometry::Polyline>& CountingGeometry::lines()const {
+	return this->lines_;
+}
@@ -0,0 +1,67 @@
+#ifndef __COUNTING_GEOMETRY_HPP__
+#define __COUNTING_GEOMETRY_HPP__
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Counting lines and counting range of a run, rasterized once into a per-pixel region map.
+ *
+ * Each pixel holds 16 bits: the id of the region the lines cut it into (bits 0-14)
+ * and whether it is inside the counting range (bit 15), so the range test is one lookup.
+ * A step that stays in its region and whose box holds no line pixel, looked up in an
+ * integral image of the rasterized lines, crosses nothing; only the other steps are
+ * intersected with the line segments, since a step can cross several lines and still
+ * end in the region it started from.
+ */
+class CountingGeometry {
+public:
+	typedef std::vector<cv::Point> Polyline;
+	CountingGeometry();
+
+	/**
+	 * Two lines from the image center at line_rad above the horizontal, counting range between them.
+	 * The lines run to the image border so they split the image into the range and the rest.
+	 */
+	static CountingGeometry radial(const cv::Size& size, double line_rad);
+
+	/**
+	 * Reads lines and range from a cv::FileStorage file:
+	 *   lines: [ [x0, y0, x1, y1, ...], ... ]
+	 *   range: [x0, y0, x1, y1, ...]
+	 */
+	static bool load(const std::string& filename, const cv::Size& size, CountingGeometry& geometry);
+
+	/**
+	 * Rasterizes lines and range.
+	 * \return false if the lines cut the image into more than 32767 regions
+	 */
+	bool create(const cv::Size& size, const std::vector<Polyline>& lines, const Polyline& range);
+	bool empty()const;
+	const cv::Size& size()const;
+	bool isInRange(const cv::Point& p)const;
+
+	/**
+	 * Appends the index of every line the segment a-b crosses, in the order a-b meets them,
+	 * and returns how many there are. A polyline crossed twice is listed twice.
+	 */
+	std::size_t crossedLines(const cv::Point& a, const cv::Point& b, std::vector<int>& lines)const;
+	double distanceToLines(const cv::Point& p)const;
+	const std::vector<Polyline>& lines()const;
+private:
+	static const unsigned short IN_RANGE_BIT = 0x8000;
+	static const unsigned short REGION_MASK = 0x7fff;
+	cv::Size size_;
+	std::vector<Polyline> lines_;
+	cv::Mat regions_;
+	/** integral image of the rasterized lines, (width + 1) x (height + 1) */
+	cv::Mat line_sums_;
+	unsigned short lookup(const cv::Point& p)const;
+
+	/**
+	 * Returns true if a-b certainly crosses no line: both ends are in the image and the same region,
+	 * and no line pixel is within a pixel of the box of a-b.
+	 */
+	bool isClear(const cv::Point& a, const cv::Point& b)const;
+};
+#endif
@@ -0,0 +1,104 @@
+#include "CountingSession.hpp"
+#include <iostream>
+
+CountingSession::CountingSession(const std::string& name, const FruitsCounterConfig& config)
+	:name_(name), counter_(config) {
+	this->status_.name = name;
+	this->status_.state = "closed";
+}
+
+bool CountingSession::openTimeLapse(const std::string& dirname) {
+	this->source_ = dirname;
+	this->lapse_.reset(new TimeLapse());
+	if (!this->counter_.isConfigured()
+		|| !this->lapse_->setDecodeScale(this->counter_.config().decode_scale)
+		|| !this->lapse_->open(dirname)) {
+		this->publish("error");
+		return false;
+	}
+	this->publish("running");
+	return true;
+}
+
+bool CountingSession::openStream(const std::string& host, const std::string& file, const std::string& port) {
+	this->source_ = "http://" + host + ":" + port + "/" + file;
+	this->stream_.reset(new MJpegStream());
+	if (!this->counter_.isConfigured() || !this->stream_->setDecodeScale(this->counter_.config().decode_scale)) {
+		this->publish("error");
+		return false;
+	}
+	this->stream_->connect(host, file, port);
+	if (!this->stream_->isConnected()) {
+		std::cerr << "ERROR: " << this->name_ << ": " << this->stream_->getLastErrorMessage() << std::endl;
+		this->publish("error");
+		return false;
+	}
+	this->publish("running");
+	return true;
+}
+
+CountingSession::StepResult CountingSession::step() {
+	if (this->start_tick_ == 0) {
+		this->start_tick_ = cv::getTickCount();
+	}
+	std::size_t frame_index;
+	if (this->lapse_) {
+		if (!this->lapse_->isOpened()) {
+			this->counter_.finish();
+			this->publish("finished");
+			return FINISHED;
+		}
+		// an unreadable frame is skipped entirely; the counter never sees it, as with a dropped stream image
+		if (!this->lapse_->read(this->frame_)) {
+			this->frame_.release();
+		}
+		frame_index = this->lapse_->currentFrame();
+	}
+	else if (this->stream_) {
+		// the last images may arrive just before the camera closes the stream
+		const bool connected = this->stream_->isConnected();
+		const std::size_t received = this->stream_->receivedFrames();
+		if (received == this->last_received_) {
+			if (!connected) {
+				this->counter_.finish();
+				this->publish("finished");
+				return FINISHED;
+			}
+			return IDLE;
+		}
+		this->last_received_ = received;
+		this->frame_ = this->stream_->readImage();
+		frame_index = received;
+	}
+	else {
+		return FINISHED;
+	}
+	if (!this->frame_.empty() && !this->counter_.pushFrame(frame_index, this->frame_)) {
+		std::cerr << "ERROR: " << this->name_ << ": can not read counting geometry" << std::endl;
+		this->publish("error");
+		return FINISHED;
+	}
+	this->publish("running");
+	return FRAME;
+}
+
+void CountingSession::publish(const std::string& state) {
+	const double elapsed = this->start_tick_ == 0
+		? 0.0
+		: (cv::getTickCount() - this->start_tick_) / cv::getTickFrequency();
+	boost::mutex::scoped_lock l(this->status_mutex_);
+	this->status_.source = this->source_;
+	this->status_.state = state;
+	this->status_.frames = this->counter_.frames();
+	this->status_.count = this->counter_.total();
+	this->status_.fps = elapsed > 0 ? this->counter_.frames() / elapsed : 0.0;
+}
+
+SessionStatus CountingSession::status()const {
+	boost::mutex::scoped_lock l(this->status_mutex_);
+	return this->status_;
+}
+
+const std::string& CountingSession::name()const {
+	return this->name_;
+}
@@ -0,0 +1,66 @@
+#ifndef __COUNTING_SESSION_HPP__
+#define __COUNTING_SESSION_HPP__
+#include <string>
+#include <vector>
+#include <memory>
+#include <boost/thread.hpp>
+#include <opencv2/core.hpp>
+#include "TimeLapse.hpp"
+#include "MJpegStream.hpp"
+#include "FruitsCounter.hpp"
+
+struct SessionStatus {
+	std::string name;
+	std::string source;
+	std::string state;
+	std::size_t frames = 0;
+	/** count as main would report it if the source ended at the last processed frame */
+	std::size_t count = 0;
+	double fps = 0.0;
+};
+
+/**
+ * One counting source hosted by the daemon, with its own FruitsCounter.
+ *
+ * step() processes one frame and is never called concurrently for the same session,
+ * so the counter needs no locking; only the status is shared with other threads.
+ */
+class CountingSession {
+public:
+	enum StepResult {
+		FRAME,
+		IDLE,
+		FINISHED
+	};
+private:
+	std::string name_;
+	std::string source_;
+	std::unique_ptr<TimeLapse> lapse_;
+	std::unique_ptr<MJpegStream> stream_;
+	std::size_t last_received_ = 0;
+	FruitsCounter counter_;
+	cv::Mat frame_;
+	int64 start_tick_ = 0;
+	mutable boost::mutex status_mutex_;
+	SessionStatus status_;
+public:
+	CountingSession(const std::string& name, const FruitsCounterConfig& config);
+
+	bool openTimeLapse(const std::string& dirname);
+	bool openStream(const std::string& host, const std::string& file, const std::string& port);
+
+	/**
+	 * Processes the next frame.
+	 * \return FRAME if a frame was processed, IDLE if a stream has no new image yet,
+	 * FINISHED at the end of the source or on an error
+	 */
+	StepResult step();
+
+	/**
+	 * Updates the status with state and the current counts.
+	 */
+	void publish(const std::string& state);
+	SessionStatus status()const;
+	const std::string& name()const;
+};
+#endif
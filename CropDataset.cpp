@@ -0,0 +1,214 @@
+#include "CropDataset.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <opencv2/imgproc.hpp>
+
+const char CropDatasetFormat::MAGIC[8] = { 'F', 'C', 'C', 'R', 'O', 'P', '\0', '\0' };
+
+std::size_t CropDatasetFormat::recordSize(const cv::Size& size) {
+	return sizeof(Record) + ((static_cast<std::size_t>(size.area()) + 7) & ~static_cast<std::size_t>(7));
+}
+
+CropDataset::CropDataset() {
+	std::memset(&this->header_, 0, sizeof(this->header_));
+}
+
+CropDataset::~CropDataset() {
+}
+
+bool CropDataset::isDataset(const std::string& filename) {
+	std::ifstream ifs(filename, std::ios::binary);
+	char magic[sizeof(CropDatasetFormat::MAGIC)];
+	if (!ifs.read(magic, sizeof(magic))) {
+		return false;
+	}
+	return std::memcmp(magic, CropDatasetFormat::MAGIC, sizeof(magic)) == 0;
+}
+
+bool CropDataset::open(const std::string& filename) {
+	typedef CropDatasetFormat::Header Header;
+	this->close();
+	if (!this->mapped_.open(filename) || this->mapped_.size() < sizeof(Header)) {
+		this->close();
+		return false;
+	}
+	std::memcpy(&this->header_, this->mapped_.data(), sizeof(Header));
+	if (std::memcmp(this->header_.magic, CropDatasetFormat::MAGIC, sizeof(this->header_.magic)) != 0
+		|| this->header_.version != CropDatasetFormat::VERSION
+		|| this->header_.width <= 0
+		|| this->header_.height <= 0) {
+		this->close();
+		return false;
+	}
+	this->record_size_ = CropDatasetFormat::recordSize(cv::Size(this->header_.width, this->header_.height));
+	this->count_ = (this->mapped_.size() - sizeof(Header)) / this->record_size_;
+	this->mapped_.adviseSequential();
+	return this->count_ > 0;
+}
+
+void CropDataset::close() {
+	this->mapped_.close();
+	std::memset(&this->header_, 0, sizeof(this->header_));
+	this->record_size_ = 0;
+	this->count_ = 0;
+}
+
+std::size_t CropDataset::size()const {
+	return this->count_;
+}
+
+cv::Size CropDataset::cropSize()const {
+	return cv::Size(this->header_.width, this->header_.height);
+}
+
+const CropDatasetFormat::Record& CropDataset::record(const std::size_t& i)const {
+	return *reinterpret_cast<const CropDatasetFormat::Record*>(
+		this->mapped_.data() + sizeof(CropDatasetFormat::Header) + i * this->record_size_);
+}
+
+const unsigned char* CropDataset::payload(const std::size_t& i)const {
+	return reinterpret_cast<const unsigned char*>(&this->record(i)) + sizeof(CropDatasetFormat::Record);
+}
+
+bool CropDataset::isCrop(const std::size_t& i)const {
+	return this->record(i).kind == CropDatasetFormat::CROP;
+}
+
+int CropDataset::label(const std::size_t& i)const {
+	return this->record(i).label;
+}
+
+cv::Rect CropDataset::rect(const std::size_t& i)const {
+	const auto& r = this->record(i);
+	return cv::Rect(r.x, r.y, r.width, r.height);
+}
+
+std::string CropDataset::source(const std::size_t& i)const {
+	const std::uint64_t s = this->record(i).source;
+	if (s >= this->count_ || this->record(static_cast<std::size_t>(s)).kind != CropDatasetFormat::SOURCE) {
+		return std::string();
+	}
+	const char* path = reinterpret_cast<const char*>(this->payload(static_cast<std::size_t>(s)));
+	const std::size_t payload_size = this->record_size_ - sizeof(CropDatasetFormat::Record);
+	return std::string(path, std::find(path, path + payload_size, '\0'));
+}
+
+cv::Mat CropDataset::image(const std::size_t& i)const {
+	return cv::Mat(
+		this->header_.height,
+		this->header_.width,
+		CV_8UC1,
+		const_cast<unsigned char*>(this->payload(i)));
+}
+
+CropDatasetWriter::CropDatasetWriter() {
+}
+
+CropDatasetWriter::~CropDatasetWriter() {
+	if (this->ofs_.is_open()) {
+		this->close();
+	}
+}
+
+bool CropDatasetWriter::open(const std::string& filename, const cv::Size& size) {
+	typedef CropDatasetFormat::Header Header;
+	namespace bf = boost::filesystem;
+	this->size_ = size;
+	this->count_ = 0;
+	this->has_source_ = false;
+	boost::system::error_code ec;
+	const bool exists = bf::is_regular_file(filename, ec) && bf::file_size(filename, ec) > 0;
+	const std::uint64_t record_size = CropDatasetFormat::recordSize(size);
+	if (exists) {
+		Header header;
+		std::ifstream ifs(filename, std::ios::binary);
+		if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| std::memcmp(header.magic, CropDatasetFormat::MAGIC, sizeof(header.magic)) != 0
+			|| header.version != CropDatasetFormat::VERSION
+			|| header.width != size.width
+			|| header.height != size.height) {
+			return false;
+		}
+		const std::uint64_t file_size = bf::file_size(filename, ec);
+		this->count_ = (file_size - sizeof(Header)) / record_size;
+		if (sizeof(Header) + this->count_ * record_size != file_size) {
+			// drop the record an interrupted writer left behind
+			bf::resize_file(filename, sizeof(Header) + this->count_ * record_size, ec);
+			if (ec) {
+				return false;
+			}
+		}
+		this->ofs_.open(filename, std::ios::binary | std::ios::app);
+		return static_cast<bool>(this->ofs_);
+	}
+	this->ofs_.open(filename, std::ios::binary | std::ios::trunc);
+	if (!this->ofs_) {
+		return false;
+	}
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, CropDatasetFormat::MAGIC, sizeof(header.magic));
+	header.version = CropDatasetFormat::VERSION;
+	header.width = size.width;
+	header.height = size.height;
+	this->ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return static_cast<bool>(this->ofs_);
+}
+
+bool CropDatasetWriter::write(const CropDatasetFormat::Record& record, const unsigned char* payload, std::size_t payload_size) {
+	const std::size_t full_size = CropDatasetFormat::recordSize(this->size_) - sizeof(CropDatasetFormat::Record);
+	this->ofs_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	this->ofs_.write(reinterpret_cast<const char*>(payload), std::min(payload_size, full_size));
+	for (std::size_t i = payload_size; i < full_size; ++i) {
+		this->ofs_.put('\0');
+	}
+	this->count_++;
+	return static_cast<bool>(this->ofs_);
+}
+
+bool CropDatasetWriter::beginSource(const std::string& path) {
+	if (!this->ofs_.is_open() || path.size() >= static_cast<std::size_t>(this->size_.area())) {
+		return false;
+	}
+	CropDatasetFormat::Record record;
+	std::memset(&record, 0, sizeof(record));
+	record.kind = CropDatasetFormat::SOURCE;
+	record.source = this->count_;
+	this->source_ = this->count_;
+	this->has_source_ = true;
+	return this->write(record, reinterpret_cast<const unsigned char*>(path.data()), path.size());
+}
+
+bool CropDatasetWriter::append(const cv::Mat& image, const cv::Rect& rect, int label) {
+	if (!this->ofs_.is_open() || !this->has_source_) {
+		return false;
+	}
+	// same conversion as train applies to a crop read from a file
+	if (image.channels() == 3) {
+		cv::cvtColor(image(rect), this->gray_, cv::COLOR_BGR2GRAY);
+	}
+	else {
+		this->gray_ = image(rect);
+	}
+	cv::resize(this->gray_, this->resized_, this->size_);
+	CropDatasetFormat::Record record;
+	std::memset(&record, 0, sizeof(record));
+	record.kind = CropDatasetFormat::CROP;
+	record.label = label;
+	record.source = this->source_;
+	record.x = rect.x;
+	record.y = rect.y;
+	record.width = rect.width;
+	record.height = rect.height;
+	if (!this->resized_.isContinuous()) {
+		this->resized_ = this->resized_.clone();
+	}
+	return this->write(record, this->resized_.ptr<unsigned char>(), static_cast<std::size_t>(this->size_.area()));
+}
+
+bool CropDatasetWriter::close() {
+	this->ofs_.close();
+	return !this->ofs_.fail();
+}
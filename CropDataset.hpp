@@ -0,0 +1,132 @@
+#ifndef __CROP_DATASET_HPP__
+#define __CROP_DATASET_HPP__
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include "MappedFile.hpp"
+
+/**
+ * Append-only file of training crops, each converted to grayscale and resized to the
+ * HOG window, so train computes features straight from the mapping.
+ *
+ * Layout (native endian):
+ *   Header
+ *   Record records[]   each followed by width * height bytes of payload, padded to 8 bytes
+ *
+ * A SOURCE record holds the path of the image the following crops were cut from
+ * (payload: the path, padded with NUL). A CROP record refers to it by record number.
+ * Every record has the same size, so record i is at a fixed offset and a record cut
+ * short by an interrupted writer is simply ignored.
+ */
+struct CropDatasetFormat {
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::int32_t width;
+		std::int32_t height;
+		std::uint32_t reserved;
+	};
+	struct Record {
+		std::uint32_t kind;
+		/** +1 positive, -1 negative, 0 not labeled */
+		std::int32_t label;
+		/** record number of the SOURCE record of a crop */
+		std::uint64_t source;
+		/** rect of the crop in the source image */
+		std::int32_t x;
+		std::int32_t y;
+		std::int32_t width;
+		std::int32_t height;
+	};
+	enum Kind {
+		SOURCE = 1,
+		CROP = 2
+	};
+	static const std::uint32_t VERSION = 1;
+	static const char MAGIC[8];
+	static std::size_t recordSize(const cv::Size& size);
+};
+
+/**
+ * Reader of a crop dataset. The file is mmapped and crops are handed out
+ * as cv::Mat headers over the mapping.
+ */
+class CropDataset {
+private:
+	MappedFile mapped_;
+	CropDatasetFormat::Header header_;
+	std::size_t record_size_ = 0;
+	std::size_t count_ = 0;
+	const CropDatasetFormat::Record& record(const std::size_t& i)const;
+	const unsigned char* payload(const std::size_t& i)const;
+public:
+	CropDataset();
+	~CropDataset();
+
+	/**
+	 * Returns true if filename starts with the dataset magic.
+	 */
+	static bool isDataset(const std::string& filename);
+	bool open(const std::string& filename);
+	void close();
+
+	/**
+	 * Number of records, SOURCE and CROP.
+	 */
+	std::size_t size()const;
+
+	/**
+	 * Size every crop was resized to when it was appended.
+	 */
+	cv::Size cropSize()const;
+	bool isCrop(const std::size_t& i)const;
+	int label(const std::size_t& i)const;
+	cv::Rect rect(const std::size_t& i)const;
+
+	/**
+	 * Path of the image crop i was cut from.
+	 */
+	std::string source(const std::size_t& i)const;
+
+	/**
+	 * Crop i as a CV_8UC1 matrix of the window size pointing into the mapping.
+	 * Valid while the dataset is open.
+	 */
+	cv::Mat image(const std::size_t& i)const;
+};
+
+/**
+ * Appends crops to a dataset, creating it if it does not exist.
+ */
+class CropDatasetWriter {
+private:
+	std::ofstream ofs_;
+	cv::Size size_;
+	std::uint64_t count_ = 0;
+	std::uint64_t source_ = 0;
+	bool has_source_ = false;
+	cv::Mat gray_;
+	cv::Mat resized_;
+	bool write(const CropDatasetFormat::Record& record, const unsigned char* payload, std::size_t payload_size);
+public:
+	CropDatasetWriter();
+	~CropDatasetWriter();
+
+	/**
+	 * \param[in] size crop size; an existing file must have the same
+	 */
+	bool open(const std::string& filename, const cv::Size& size);
+
+	/**
+	 * Starts the crops of the image at path.
+	 */
+	bool beginSource(const std::string& path);
+
+	/**
+	 * Appends image(rect) of the current source, converted to gray and resized.
+	 */
+	bool append(const cv::Mat& image, const cv::Rect& rect, int label);
+	bool close();
+};
+#endif
@@ -0,0 +1,29 @@
+#ifndef __DECODE_SCALE_HPP__
+#define __DECODE_SCALE_HPP__
+#include <opencv2/imgcodecs.hpp>
+
+/**
+ * Decode scales supported by cv::IMREAD_REDUCED_*.
+ * For JPEG the reduction is done inside libjpeg by DCT scaling,
+ * so a smaller scale makes the decode itself cheaper.
+ */
+inline bool isValidDecodeScale(int scale) {
+	return scale == 1 || scale == 2 || scale == 4 || scale == 8;
+}
+
+/**
+ * imread/imdecode flag that decodes a color image at 1/scale resolution.
+ */
+inline int reducedColorFlag(int scale) {
+	switch (scale) {
+	case 2:
+		return cv::IMREAD_REDUCED_COLOR_2;
+	case 4:
+		return cv::IMREAD_REDUCED_COLOR_4;
+	case 8:
+		return cv::IMREAD_REDUCED_COLOR_8;
+	default:
+		return cv::IMREAD_COLOR;
+	}
+}
+#endif
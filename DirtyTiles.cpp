@@ -0,0 +1,116 @@
+#include "DirtyTiles.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+bool DirtyTiles::isTileChanged(const cv::Mat& frame, const cv::Rect& rect, int tolerance)const {
+	const std::size_t row_bytes = rect.width * frame.elemSize();
+	for (int y = rect.y; y < rect.y + rect.height; ++y) {
+		const unsigned char* a = frame.ptr<unsigned char>(y) + rect.x * frame.elemSize();
+		const unsigned char* b = this->reference_.ptr<unsigned char>(y) + rect.x * frame.elemSize();
+		if (tolerance <= 0) {
+			if (std::memcmp(a, b, row_bytes) != 0) {
+				return true;
+			}
+			continue;
+		}
+		for (std::size_t i = 0; i < row_bytes; ++i) {
+			if (std::abs(static_cast<int>(a[i]) - b[i]) > tolerance) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void DirtyTiles::update(const cv::Mat& frame, int tolerance) {
+	CV_Assert(frame.depth() == CV_8U);
+	const bool is_new = this->reference_.size() != frame.size() || this->reference_.type() != frame.type();
+	this->cols_ = (frame.cols + TILE - 1) / TILE;
+	this->rows_ = (frame.rows + TILE - 1) / TILE;
+	this->dirty_.assign(static_cast<std::size_t>(this->cols_) * this->rows_, 1);
+	this->dirty_count_ = this->dirty_.size();
+	if (is_new) {
+		frame.copyTo(this->reference_);
+		return;
+	}
+	for (int ty = 0; ty < this->rows_; ++ty) {
+		for (int tx = 0; tx < this->cols_; ++tx) {
+			const cv::Rect rect = cv::Rect(tx * TILE, ty * TILE, TILE, TILE) & cv::Rect(0, 0, frame.cols, frame.rows);
+			if (this->isTileChanged(frame, rect, tolerance)) {
+				frame(rect).copyTo(this->reference_(rect));
+			}
+			else {
+				this->dirty_[ty * this->cols_ + tx] = 0;
+				this->dirty_count_--;
+			}
+		}
+	}
+}
+
+void DirtyTiles::reset() {
+	this->reference_.release();
+	this->dirty_.clear();
+	this->dirty_count_ = 0;
+	this->cols_ = 0;
+	this->rows_ = 0;
+}
+
+int DirtyTiles::cols()const {
+	return this->cols_;
+}
+
+int DirtyTiles::rows()const {
+	return this->rows_;
+}
+
+bool DirtyTiles::isDirty(int tx, int ty)const {
+	return this->dirty_[ty * this->cols_ + tx] != 0;
+}
+
+std::size_t DirtyTiles::dirtyCount()const {
+	return this->dirty_count_;
+}
+
+void DirtyTiles::rects(int halo, std::vector<cv::Rect>& rects)const {
+	rects.clear();
+	const int grow = (std::max(halo, 0) + TILE - 1) / TILE;
+	// a tile is covered if a dirty tile is within grow tiles in both directions
+	std::vector<unsigned char> rows_grown(this->dirty_.size(), 0);
+	for (int ty = 0; ty < this->rows_; ++ty) {
+		for (int tx = 0; tx < this->cols_; ++tx) {
+			if (!this->isDirty(tx, ty)) {
+				continue;
+			}
+			for (int x = std::max(0, tx - grow); x <= std::min(this->cols_ - 1, tx + grow); ++x) {
+				rows_grown[ty * this->cols_ + x] = 1;
+			}
+		}
+	}
+	std::vector<unsigned char> grown(this->dirty_.size(), 0);
+	for (int ty = 0; ty < this->rows_; ++ty) {
+		for (int tx = 0; tx < this->cols_; ++tx) {
+			if (!rows_grown[ty * this->cols_ + tx]) {
+				continue;
+			}
+			for (int y = std::max(0, ty - grow); y <= std::min(this->rows_ - 1, ty + grow); ++y) {
+				grown[y * this->cols_ + tx] = 1;
+			}
+		}
+	}
+	const int width = this->reference_.cols;
+	const int height = this->reference_.rows;
+	for (int ty = 0; ty < this->rows_; ++ty) {
+		for (int tx = 0; tx < this->cols_; ++tx) {
+			if (!grown[ty * this->cols_ + tx]) {
+				continue;
+			}
+			const int begin = tx;
+			while (tx + 1 < this->cols_ && grown[ty * this->cols_ + tx + 1]) {
+				tx++;
+			}
+			const cv::Rect rect(begin * TILE, ty * TILE, (tx - begin + 1) * TILE, TILE);
+			rects.push_back(rect & cv::Rect(0, 0, width, height));
+		}
+	}
+}
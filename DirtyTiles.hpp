@@ -0,0 +1,46 @@
+#ifndef __DIRTY_TILES_HPP__
+#define __DIRTY_TILES_HPP__
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Marks the 64x64 tiles of a frame that changed since they were last recomputed.
+ *
+ * Each tile is compared with the reference copy of itself taken when it was last dirty,
+ * so a slow drift is caught once it adds up to more than the tolerance.
+ * Tiles are as wide as a BitMask word, so tile columns map to whole mask words.
+ */
+class DirtyTiles {
+public:
+	static const int TILE = 64;
+private:
+	cv::Mat reference_;
+	int cols_ = 0;
+	int rows_ = 0;
+	std::vector<unsigned char> dirty_;
+	std::size_t dirty_count_ = 0;
+	bool isTileChanged(const cv::Mat& frame, const cv::Rect& rect, int tolerance)const;
+public:
+	/**
+	 * Compares frame with the reference and takes the changed tiles into it.
+	 * Every tile is dirty on the first frame and when the size or type changes.
+	 * \param[in] tolerance largest difference of a channel value that does not make a tile dirty
+	 */
+	void update(const cv::Mat& frame, int tolerance);
+
+	/**
+	 * Forgets the reference, so the next frame is dirty everywhere.
+	 */
+	void reset();
+	int cols()const;
+	int rows()const;
+	bool isDirty(int tx, int ty)const;
+	std::size_t dirtyCount()const;
+
+	/**
+	 * Pixel rects covering the dirty tiles grown by halo pixels, rounded out to whole tiles
+	 * and clipped to the frame. Horizontal runs of tiles are merged into one rect.
+	 */
+	void rects(int halo, std::vector<cv::Rect>& rects)const;
+};
+#endif
@@ -0,0 +1,319 @@
+#include "FastHog.hpp"
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <boost/thread.hpp>
+
+namespace {
+	/**
+	 * Per pixel magnitude split between the two nearest orientation bins, as in
+	 * cv::HOGDescriptor::computeGradient without gamma correction:
+	 * grad[2 * i] goes to bin qangle[2 * i] and grad[2 * i + 1] to bin qangle[2 * i + 1].
+	 */
+	void computeGradient(const cv::Mat& img, std::vector<float>& grad, std::vector<unsigned char>& qangle) {
+		CV_Assert(img.type() == CV_8UC1 || img.type() == CV_8UC3);
+		const int width = img.cols;
+		const int height = img.rows;
+		const int cn = img.channels();
+		const float angle_scale = static_cast<float>(FastHog::NBINS / CV_PI);
+		grad.resize(static_cast<std::size_t>(width) * height * 2);
+		qangle.resize(grad.size());
+		// reflect-101 borders
+		std::vector<int> xmap(width + 2);
+		for (int x = -1; x <= width; ++x) {
+			xmap[x + 1] = cv::borderInterpolate(x, width, cv::BORDER_REFLECT_101);
+		}
+		std::vector<float> dx(width), dy(width), mag(width), angle(width);
+		cv::Mat dx_row(1, width, CV_32FC1, dx.data());
+		cv::Mat dy_row(1, width, CV_32FC1, dy.data());
+		cv::Mat mag_row(1, width, CV_32FC1, mag.data());
+		cv::Mat angle_row(1, width, CV_32FC1, angle.data());
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* prev = img.ptr<unsigned char>(cv::borderInterpolate(y - 1, height, cv::BORDER_REFLECT_101));
+			const unsigned char* cur = img.ptr<unsigned char>(y);
+			const unsigned char* next = img.ptr<unsigned char>(cv::borderInterpolate(y + 1, height, cv::BORDER_REFLECT_101));
+			if (cn == 1) {
+				for (int x = 0; x < width; ++x) {
+					dx[x] = static_cast<float>(cur[xmap[x + 2]]) - cur[xmap[x]];
+					dy[x] = static_cast<float>(next[x]) - prev[x];
+				}
+			}
+			else {
+				// the channel with the largest magnitude, the first one tried kept on ties.
+				// OpenCV tries B first in its vectorized loop over groups of 4 pixels
+				// and R first in the scalar loop over the remaining pixels of the row.
+				const int vector_width = width & ~3;
+				for (int x = 0; x < width; ++x) {
+					const unsigned char* right = cur + xmap[x + 2] * 3;
+					const unsigned char* left = cur + xmap[x] * 3;
+					const int first = x < vector_width ? 0 : 2;
+					const int step = x < vector_width ? 1 : -1;
+					float best_dx = 0.0f, best_dy = 0.0f, best_mag = -1.0f;
+					for (int i = 0, c = first; i < 3; ++i, c += step) {
+						const float cdx = static_cast<float>(right[c]) - left[c];
+						const float cdy = static_cast<float>(next[x * 3 + c]) - prev[x * 3 + c];
+						const float cmag = cdx * cdx + cdy * cdy;
+						if (best_mag < cmag) {
+							best_dx = cdx;
+							best_dy = cdy;
+							best_mag = cmag;
+						}
+					}
+					dx[x] = best_dx;
+					dy[x] = best_dy;
+				}
+			}
+			cv::cartToPolar(dx_row, dy_row, mag_row, angle_row, false);
+			float* g = grad.data() + static_cast<std::size_t>(y) * width * 2;
+			unsigned char* q = qangle.data() + static_cast<std::size_t>(y) * width * 2;
+			for (int x = 0; x < width; ++x) {
+				float a = angle[x] * angle_scale - 0.5f;
+				int hidx = cvFloor(a);
+				a -= hidx;
+				g[x * 2] = mag[x] * (1.0f - a);
+				g[x * 2 + 1] = mag[x] * a;
+				if (hidx < 0) {
+					hidx += FastHog::NBINS;
+				}
+				else if (hidx >= FastHog::NBINS) {
+					hidx -= FastHog::NBINS;
+				}
+				q[x * 2] = static_cast<unsigned char>(hidx);
+				q[x * 2 + 1] = static_cast<unsigned char>(hidx + 1 < FastHog::NBINS ? hidx + 1 : 0);
+			}
+		}
+	}
+
+	/**
+	 * L2-Hys of cv::HOGDescriptor::normalizeBlockHistogram.
+	 */
+	void normalizeBlock(float* hist) {
+		const float threshold = 0.2f;
+		float sum = 0.0f;
+		for (int i = 0; i < FastHog::BLOCK_HIST; ++i) {
+			sum += hist[i] * hist[i];
+		}
+		float scale = 1.0f / (std::sqrt(sum) + FastHog::BLOCK_HIST * 0.1f);
+		sum = 0.0f;
+		for (int i = 0; i < FastHog::BLOCK_HIST; ++i) {
+			hist[i] = std::min(hist[i] * scale, threshold);
+			sum += hist[i] * hist[i];
+		}
+		scale = 1.0f / (std::sqrt(sum) + 1e-3f);
+		for (int i = 0; i < FastHog::BLOCK_HIST; ++i) {
+			hist[i] *= scale;
+		}
+	}
+
+	float dot(const float* a, const float* b, int n) {
+		float s = 0.0f;
+		for (int i = 0; i < n; ++i) {
+			s += a[i] * b[i];
+		}
+		return s;
+	}
+}
+
+FastHog::FastHog()
+	: FastHog(0) {
+}
+
+FastHog::FastHog(std::size_t threads)
+	: threads_(threads) {
+	// same tables as cv::HOGCache::init: winSigma (16 + 16) / 8 = 4, centered at 8
+	const float sigma = (BLOCK_SIZE + BLOCK_SIZE) / 8.0f;
+	const float scale = 1.0f / (sigma * sigma * 2);
+	float gauss[BLOCK_SIZE];
+	float cell[BLOCK_SIZE][2];
+	for (int i = 0; i < BLOCK_SIZE; ++i) {
+		const float d = i - BLOCK_SIZE * 0.5f;
+		gauss[i] = std::exp(-d * d * scale);
+		const float c = (i + 0.5f) / CELL_SIZE - 0.5f;
+		for (int k = 0; k < 2; ++k) {
+			cell[i][k] = std::max(0.0f, 1.0f - std::abs(c - k));
+		}
+	}
+	for (int i = 0; i < BLOCK_SIZE; ++i) {
+		for (int j = 0; j < BLOCK_SIZE; ++j) {
+			for (int cx = 0; cx < 2; ++cx) {
+				for (int cy = 0; cy < 2; ++cy) {
+					this->pixel_weights_[i][j][cx * 2 + cy] = gauss[i] * gauss[j] * (cell[j][cx] * cell[i][cy]);
+				}
+			}
+		}
+	}
+}
+
+bool FastHog::isSupported(const cv::HOGDescriptor& hog) {
+	return hog.winSize == cv::Size(WIN_WIDTH, WIN_HEIGHT)
+		&& hog.blockSize == cv::Size(BLOCK_SIZE, BLOCK_SIZE)
+		&& hog.blockStride == cv::Size(CELL_SIZE, CELL_SIZE)
+		&& hog.cellSize == cv::Size(CELL_SIZE, CELL_SIZE)
+		&& hog.nbins == NBINS
+		&& hog.winSigma < 0
+		&& hog.L2HysThreshold == 0.2
+		&& !hog.gammaCorrection
+		&& !hog.signedGradient;
+}
+
+bool FastHog::setSVMDetector(const std::vector<float>& detector) {
+	if (detector.size() != DESCRIPTOR_SIZE + 1) {
+		return false;
+	}
+	this->weights_.assign(detector.begin(), detector.end() - 1);
+	this->bias_ = detector.back();
+	return true;
+}
+
+bool FastHog::setSVMDetector(const cv::Mat& detector) {
+	if (detector.type() != CV_32FC1 || detector.total() != DESCRIPTOR_SIZE + 1 || !detector.isContinuous()) {
+		return false;
+	}
+	const float* p = detector.ptr<float>();
+	return this->setSVMDetector(std::vector<float>(p, p + detector.total()));
+}
+
+void FastHog::computeBlocks(const cv::Mat& img, std::vector<float>& blocks, int& blocks_x, int& blocks_y)const {
+	blocks_x = (img.cols - BLOCK_SIZE) / CELL_SIZE + 1;
+	blocks_y = (img.rows - BLOCK_SIZE) / CELL_SIZE + 1;
+	blocks.assign(static_cast<std::size_t>(blocks_x) * blocks_y * BLOCK_HIST, 0.0f);
+	std::vector<float> grad;
+	std::vector<unsigned char> qangle;
+	::computeGradient(img, grad, qangle);
+	const std::size_t row_step = static_cast<std::size_t>(img.cols) * 2;
+	for (int bx = 0; bx < blocks_x; ++bx) {
+		for (int by = 0; by < blocks_y; ++by) {
+			float* hist = blocks.data() + (static_cast<std::size_t>(bx) * blocks_y + by) * BLOCK_HIST;
+			for (int i = 0; i < BLOCK_SIZE; ++i) {
+				const std::size_t offset = (by * CELL_SIZE + i) * row_step + bx * CELL_SIZE * 2;
+				const float* g = grad.data() + offset;
+				const unsigned char* q = qangle.data() + offset;
+				for (int j = 0; j < BLOCK_SIZE; ++j) {
+					const float* w = this->pixel_weights_[i][j];
+					for (int k = 0; k < 4; ++k) {
+						hist[k * NBINS + q[j * 2]] += g[j * 2] * w[k];
+						hist[k * NBINS + q[j * 2 + 1]] += g[j * 2 + 1] * w[k];
+					}
+				}
+			}
+			::normalizeBlock(hist);
+		}
+	}
+}
+
+void FastHog::compute(const cv::Mat& img, std::vector<float>& descriptors)const {
+	descriptors.clear();
+	if (img.cols < WIN_WIDTH || img.rows < WIN_HEIGHT) {
+		return;
+	}
+	std::vector<float> blocks;
+	int blocks_x, blocks_y;
+	this->computeBlocks(img, blocks, blocks_x, blocks_y);
+	const int windows_x = blocks_x - BLOCKS_X + 1;
+	const int windows_y = blocks_y - BLOCKS_Y + 1;
+	descriptors.reserve(static_cast<std::size_t>(windows_x) * windows_y * DESCRIPTOR_SIZE);
+	for (int wy = 0; wy < windows_y; ++wy) {
+		for (int wx = 0; wx < windows_x; ++wx) {
+			// the blocks of one window column are contiguous in the grid
+			for (int bx = 0; bx < BLOCKS_X; ++bx) {
+				const float* column = blocks.data() + (static_cast<std::size_t>(wx + bx) * blocks_y + wy) * BLOCK_HIST;
+				descriptors.insert(descriptors.end(), column, column + BLOCKS_Y * BLOCK_HIST);
+			}
+		}
+	}
+}
+
+void FastHog::detect(const cv::Mat& img, std::vector<cv::Point>& hits, std::vector<double>& scores, double hit_threshold)const {
+	hits.clear();
+	scores.clear();
+	if (img.cols < WIN_WIDTH || img.rows < WIN_HEIGHT || this->weights_.empty()) {
+		return;
+	}
+	std::vector<float> blocks;
+	int blocks_x, blocks_y;
+	this->computeBlocks(img, blocks, blocks_x, blocks_y);
+	const int windows_x = blocks_x - BLOCKS_X + 1;
+	const int windows_y = blocks_y - BLOCKS_Y + 1;
+	const int column_size = BLOCKS_Y * BLOCK_HIST;
+	for (int wy = 0; wy < windows_y; ++wy) {
+		for (int wx = 0; wx < windows_x; ++wx) {
+			double s = this->bias_;
+			for (int bx = 0; bx < BLOCKS_X; ++bx) {
+				const float* column = blocks.data() + (static_cast<std::size_t>(wx + bx) * blocks_y + wy) * BLOCK_HIST;
+				s += ::dot(column, this->weights_.data() + bx * column_size, column_size);
+			}
+			if (s >= hit_threshold) {
+				hits.push_back(cv::Point(wx * CELL_SIZE, wy * CELL_SIZE));
+				scores.push_back(s);
+			}
+		}
+	}
+}
+
+void FastHog::detectMultiScale(const cv::Mat& img, std::vector<cv::Rect>& found, std::vector<double>& scores,
+	double hit_threshold, double scale0, int group_threshold)const {
+	// level scales of cv::HOGDescriptor::detectMultiScale with nlevels 64
+	const int max_levels = 64;
+	std::vector<double> level_scales;
+	double scale = 1.0;
+	int level = 0;
+	for (; level < max_levels; ++level) {
+		level_scales.push_back(scale);
+		if (cvRound(img.cols / scale) < WIN_WIDTH || cvRound(img.rows / scale) < WIN_HEIGHT || scale0 <= 1) {
+			break;
+		}
+		scale *= scale0;
+	}
+	// the scale that broke the loop is dropped, except when it is the only one
+	level_scales.resize(std::max(level, 1));
+	const std::size_t levels = level_scales.size();
+	std::vector<std::vector<cv::Rect>> level_found(levels);
+	std::vector<std::vector<double>> level_scores(levels);
+	const std::size_t threads = std::min<std::size_t>(levels,
+		this->threads_ > 0 ? this->threads_ : std::max(1u, boost::thread::hardware_concurrency()));
+	// level 0 is the largest, so taking levels in order balances the threads
+	std::atomic<std::size_t> next(0);
+	boost::thread_group group;
+	for (std::size_t t = 0; t < threads; ++t) {
+		group.create_thread([&]() {
+			std::vector<cv::Point> hits;
+			for (std::size_t level = next++; level < levels; level = next++) {
+				const double s = level_scales[level];
+				const cv::Size size(cvRound(img.cols / s), cvRound(img.rows / s));
+				cv::Mat smaller;
+				if (size == img.size()) {
+					smaller = img;
+				}
+				else {
+					cv::resize(img, smaller, size, 0, 0, cv::INTER_LINEAR_EXACT);
+				}
+				this->detect(smaller, hits, level_scores[level], hit_threshold);
+				const cv::Size win(cvRound(WIN_WIDTH * s), cvRound(WIN_HEIGHT * s));
+				for (const auto& p : hits) {
+					level_found[level].push_back(cv::Rect(cvRound(p.x * s), cvRound(p.y * s), win.width, win.height));
+				}
+			}
+		});
+	}
+	group.join_all();
+	found.clear();
+	scores.clear();
+	for (std::size_t level = 0; level < levels; ++level) {
+		found.insert(found.end(), level_found[level].begin(), level_found[level].end());
+		scores.insert(scores.end(), level_scores[level].begin(), level_scores[level].end());
+	}
+	// the grouping detectMultiScale uses; it does not depend on the descriptor parameters
+	cv::HOGDescriptor().groupRectangles(found, scores, group_threshold, 0.2);
+	// windows reaching past the image are clipped to it, as detectMultiScale does
+	const cv::Rect bounds(0, 0, img.cols, img.rows);
+	for (auto& rect : found) {
+		rect &= bounds;
+	}
+}
+
+void FastHog::detectMultiScale(const cv::Mat& img, std::vector<cv::Rect>& found,
+	double hit_threshold, double scale0, int group_threshold)const {
+	std::vector<double> scores;
+	this->detectMultiScale(img, found, scores, hit_threshold, scale0, group_threshold);
+}
@@ -0,0 +1,80 @@
+#ifndef __FAST_HOG_HPP__
+#define __FAST_HOG_HPP__
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+/**
+ * HOG detector specialized for the geometry of getDefaultHOGDescriptor:
+ * 128x64 window, 16x16 blocks with 8x8 stride, 8x8 cells, 9 unsigned bins, windows every 8 pixels.
+ *
+ * The features follow cv::HOGDescriptor (max-channel centered gradients, Gaussian block window,
+ * bilinear cell interpolation, L2-Hys), so detectors trained with either can be used with the other.
+ * Scores differ from OpenCV only by float rounding.
+ *
+ * Gradients and normalized blocks are computed once per pyramid level on the 8 pixel block grid,
+ * and every window is scored against that grid. Pyramid levels run in parallel.
+ */
+class FastHog {
+public:
+	static const int WIN_WIDTH = 128;
+	static const int WIN_HEIGHT = 64;
+	static const int BLOCK_SIZE = 16;
+	static const int CELL_SIZE = 8;
+	static const int NBINS = 9;
+	static const int BLOCK_HIST = 4 * NBINS;
+	static const int BLOCKS_X = (WIN_WIDTH - BLOCK_SIZE) / CELL_SIZE + 1;
+	static const int BLOCKS_Y = (WIN_HEIGHT - BLOCK_SIZE) / CELL_SIZE + 1;
+	static const int DESCRIPTOR_SIZE = BLOCKS_X * BLOCKS_Y * BLOCK_HIST;
+private:
+	/** weights in OpenCV's order (blocks column-major, then cells column-major, then bins) */
+	std::vector<float> weights_;
+	float bias_ = 0.0f;
+	std::size_t threads_ = 0;
+	/** Gaussian window times bilinear cell weight: pixel (y, x) of a block to cell (cx * 2 + cy) */
+	float pixel_weights_[BLOCK_SIZE][BLOCK_SIZE][4];
+
+	/**
+	 * Normalized block histograms of img, blocks at multiples of 8 pixels,
+	 * stored column-major as the windows read them.
+	 */
+	void computeBlocks(const cv::Mat& img, std::vector<float>& blocks, int& blocks_x, int& blocks_y)const;
+public:
+	FastHog();
+	/**
+	 * \param threads threads for the pyramid levels (0: number of hardware threads)
+	 */
+	explicit FastHog(std::size_t threads);
+
+	/**
+	 * Returns true if hog has the geometry this class computes.
+	 */
+	static bool isSupported(const cv::HOGDescriptor& hog);
+
+	/**
+	 * Weights followed by the bias (-rho), as taken by cv::HOGDescriptor::setSVMDetector.
+	 */
+	bool setSVMDetector(const std::vector<float>& detector);
+	bool setSVMDetector(const cv::Mat& detector);
+
+	/**
+	 * Descriptors of all windows of img (8 bit, 1 or 3 channels) concatenated in the order of
+	 * cv::HOGDescriptor::compute with an 8x8 window stride and no padding.
+	 */
+	void compute(const cv::Mat& img, std::vector<float>& descriptors)const;
+
+	/**
+	 * Top-left corners and scores of the windows of img scoring at least hit_threshold.
+	 */
+	void detect(const cv::Mat& img, std::vector<cv::Point>& hits, std::vector<double>& scores, double hit_threshold = 0.0)const;
+
+	/**
+	 * Same pyramid, resizing, grouping and clipping as cv::HOGDescriptor::detectMultiScale with the default
+	 * window stride and padding. group_threshold 0 returns every window.
+	 */
+	void detectMultiScale(const cv::Mat& img, std::vector<cv::Rect>& found, std::vector<double>& scores,
+		double hit_threshold = 0.0, double scale0 = 1.05, int group_threshold = 2)const;
+	void detectMultiScale(const cv::Mat& img, std::vector<cv::Rect>& found,
+		double hit_threshold = 0.0, double scale0 = 1.05, int group_threshold = 2)const;
+};
+#endif
@@ -0,0 +1,114 @@
+#include "FeatureFile.hpp"
+#include <cstring>
+
+const char FeatureFileFormat::MAGIC[8] = { 'F', 'C', 'F', 'E', 'A', 'T', '\0', '\0' };
+
+FeatureFile::FeatureFile() {
+}
+
+FeatureFile::~FeatureFile() {
+}
+
+bool FeatureFile::open(const std::string& filename) {
+	typedef FeatureFileFormat::Header Header;
+	this->close();
+	if (!this->mapped_.open(filename) || this->mapped_.size() < sizeof(Header)) {
+		this->close();
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, this->mapped_.data(), sizeof(Header));
+	if (std::memcmp(header.magic, FeatureFileFormat::MAGIC, sizeof(header.magic)) != 0
+		|| header.version != FeatureFileFormat::VERSION
+		|| header.dims == 0) {
+		this->close();
+		return false;
+	}
+	// derive the row count from the file size so a corrupt header can not overflow the check
+	const std::uint64_t row_size = (static_cast<std::uint64_t>(header.dims) + 1) * sizeof(float);
+	const std::uint64_t body_size = this->mapped_.size() - sizeof(Header);
+	if (body_size % row_size != 0 || header.count != body_size / row_size) {
+		this->close();
+		return false;
+	}
+	this->rows_ = reinterpret_cast<const float*>(this->mapped_.data() + sizeof(Header));
+	this->dims_ = header.dims;
+	this->count_ = static_cast<std::size_t>(header.count);
+	this->mapped_.adviseSequential();
+	return this->count_ > 0;
+}
+
+void FeatureFile::close() {
+	this->mapped_.close();
+	this->rows_ = nullptr;
+	this->dims_ = 0;
+	this->count_ = 0;
+}
+
+std::size_t FeatureFile::size()const {
+	return this->count_;
+}
+
+std::size_t FeatureFile::dims()const {
+	return this->dims_;
+}
+
+float FeatureFile::label(std::size_t i)const {
+	return this->rows_[i * (this->dims_ + 1)];
+}
+
+const float* FeatureFile::features(std::size_t i)const {
+	return this->rows_ + i * (this->dims_ + 1) + 1;
+}
+
+FeatureFileWriter::FeatureFileWriter() {
+}
+
+FeatureFileWriter::~FeatureFileWriter() {
+	if (this->ofs_.is_open()) {
+		this->close();
+	}
+}
+
+bool FeatureFileWriter::open(const std::string& filename, std::size_t dims) {
+	this->ofs_.open(filename, std::ios::binary | std::ios::trunc);
+	if (!this->ofs_ || dims == 0) {
+		return false;
+	}
+	FeatureFileFormat::Header header;
+	std::memset(&header, 0, sizeof(header));
+	this->ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	this->dims_ = dims;
+	this->count_ = 0;
+	return static_cast<bool>(this->ofs_);
+}
+
+bool FeatureFileWriter::append(float label, const std::vector<float>& features) {
+	if (features.size() != this->dims_) {
+		return false;
+	}
+	this->ofs_.write(reinterpret_cast<const char*>(&label), sizeof(label));
+	this->ofs_.write(reinterpret_cast<const char*>(features.data()), features.size() * sizeof(float));
+	if (!this->ofs_) {
+		return false;
+	}
+	this->count_++;
+	return true;
+}
+
+bool FeatureFileWriter::close() {
+	FeatureFileFormat::Header header;
+	std::memcpy(header.magic, FeatureFileFormat::MAGIC, sizeof(header.magic));
+	header.version = FeatureFileFormat::VERSION;
+	header.dims = static_cast<std::uint32_t>(this->dims_);
+	header.count = this->count_;
+	this->ofs_.seekp(0);
+	this->ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	bool ok = static_cast<bool>(this->ofs_);
+	this->ofs_.close();
+	return ok;
+}
+
+std::size_t FeatureFileWriter::size()const {
+	return this->count_;
+}
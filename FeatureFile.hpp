@@ -0,0 +1,64 @@
+#ifndef __FEATURE_FILE_HPP__
+#define __FEATURE_FILE_HPP__
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.hpp"
+
+/**
+ * Labelled feature vectors for out-of-core training.
+ *
+ * Layout (native endian):
+ *   Header
+ *   float rows[count][dims + 1]   label (+1 / -1) followed by the features
+ */
+struct FeatureFileFormat {
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t dims;
+		std::uint64_t count;
+	};
+	static const std::uint32_t VERSION = 1;
+	static const char MAGIC[8];
+};
+
+/**
+ * Reader of a feature file. Rows are used in place in the mapping,
+ * so only the pages being read are resident.
+ */
+class FeatureFile {
+private:
+	MappedFile mapped_;
+	const float* rows_ = nullptr;
+	std::size_t dims_ = 0;
+	std::size_t count_ = 0;
+public:
+	FeatureFile();
+	~FeatureFile();
+	bool open(const std::string& filename);
+	void close();
+	std::size_t size()const;
+	std::size_t dims()const;
+	float label(std::size_t i)const;
+	const float* features(std::size_t i)const;
+};
+
+/**
+ * Appends rows one at a time; the count is written on close.
+ */
+class FeatureFileWriter {
+private:
+	std::ofstream ofs_;
+	std::size_t dims_ = 0;
+	std::size_t count_ = 0;
+public:
+	FeatureFileWriter();
+	~FeatureFileWriter();
+	bool open(const std::string& filename, std::size_t dims);
+	bool append(float label, const std::vector<float>& features);
+	bool close();
+	std::size_t size()const;
+};
+#endif
@@ -0,0 +1,149 @@
+#include "FrameArchive.hpp"
+#include <cstring>
+#include <limits>
+#include <opencv2/imgcodecs.hpp>
+
+const char FrameArchiveFormat::MAGIC[8] = { 'F', 'C', 'A', 'R', 'C', 'H', '\0', '\0' };
+
+FrameArchive::FrameArchive() {
+}
+
+FrameArchive::~FrameArchive() {
+}
+
+bool FrameArchive::isArchive(const std::string& filename) {
+	std::ifstream ifs(filename, std::ios::binary);
+	char magic[sizeof(FrameArchiveFormat::MAGIC)];
+	if (!ifs.read(magic, sizeof(magic))) {
+		return false;
+	}
+	return std::memcmp(magic, FrameArchiveFormat::MAGIC, sizeof(magic)) == 0;
+}
+
+bool FrameArchive::open(const std::string& filename) {
+	typedef FrameArchiveFormat::Header Header;
+	typedef FrameArchiveFormat::Entry Entry;
+	this->close();
+	if (!this->mapped_.open(filename) || this->mapped_.size() < sizeof(Header)) {
+		this->close();
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, this->mapped_.data(), sizeof(Header));
+	if (std::memcmp(header.magic, FrameArchiveFormat::MAGIC, sizeof(header.magic)) != 0
+		|| header.version != FrameArchiveFormat::VERSION
+		|| header.table_offset % sizeof(std::uint64_t) != 0
+		|| header.table_offset < sizeof(Header)
+		|| header.table_offset > this->mapped_.size()
+		// divide rather than multiply so a crafted count can not overflow the check
+		|| (this->mapped_.size() - header.table_offset) % sizeof(Entry) != 0
+		|| header.count != (this->mapped_.size() - header.table_offset) / sizeof(Entry)) {
+		this->close();
+		return false;
+	}
+	this->table_ = reinterpret_cast<const Entry*>(this->mapped_.data() + header.table_offset);
+	this->count_ = static_cast<std::size_t>(header.count);
+	for (std::size_t i = 0; i < this->count_; ++i) {
+		// an empty frame would reach cv::imdecode, which asserts on it
+		const auto& entry = this->table_[i];
+		if (entry.size == 0
+			|| entry.size > static_cast<std::uint64_t>(std::numeric_limits<int>::max())
+			|| entry.offset < sizeof(Header)
+			|| entry.offset > header.table_offset
+			|| entry.size > header.table_offset - entry.offset) {
+			this->close();
+			return false;
+		}
+	}
+	this->mapped_.adviseSequential();
+	return this->count_ > 0;
+}
+
+void FrameArchive::close() {
+	this->mapped_.close();
+	this->table_ = nullptr;
+	this->count_ = 0;
+}
+
+std::size_t FrameArchive::size()const {
+	return this->count_;
+}
+
+cv::Mat FrameArchive::encoded(const std::size_t& frame)const {
+	const auto& entry = this->table_[frame];
+	return cv::Mat(
+		1,
+		static_cast<int>(entry.size),
+		CV_8UC1,
+		const_cast<unsigned char*>(this->mapped_.data() + entry.offset));
+}
+
+bool FrameArchive::read(const std::size_t& frame, cv::Mat& image, int flags)const {
+	image = cv::imdecode(this->encoded(frame), flags);
+	return !image.empty();
+}
+
+FrameArchiveWriter::FrameArchiveWriter() {
+}
+
+FrameArchiveWriter::~FrameArchiveWriter() {
+	if (this->ofs_.is_open()) {
+		this->close();
+	}
+}
+
+bool FrameArchiveWriter::open(const std::string& filename) {
+	this->ofs_.open(filename, std::ios::binary | std::ios::trunc);
+	if (!this->ofs_) {
+		return false;
+	}
+	FrameArchiveFormat::Header header;
+	std::memset(&header, 0, sizeof(header));
+	this->ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	this->table_.clear();
+	this->offset_ = sizeof(header);
+	return static_cast<bool>(this->ofs_);
+}
+
+bool FrameArchiveWriter::append(const unsigned char* data, const std::size_t& size) {
+	if (size == 0) {
+		return false;
+	}
+	this->ofs_.write(reinterpret_cast<const char*>(data), size);
+	if (!this->ofs_) {
+		return false;
+	}
+	FrameArchiveFormat::Entry entry;
+	entry.offset = this->offset_;
+	entry.size = size;
+	this->table_.push_back(entry);
+	this->offset_ += size;
+	return true;
+}
+
+bool FrameArchiveWriter::close() {
+	// keep the table 8-byte aligned so the reader can use it in place
+	const std::uint64_t padding = (sizeof(std::uint64_t) - this->offset_ % sizeof(std::uint64_t)) % sizeof(std::uint64_t);
+	const char zeros[sizeof(std::uint64_t)] = {};
+	this->ofs_.write(zeros, padding);
+	FrameArchiveFormat::Header header;
+	std::memcpy(header.magic, FrameArchiveFormat::MAGIC, sizeof(header.magic));
+	header.version = FrameArchiveFormat::VERSION;
+	header.reserved = 0;
+	header.count = this->table_.size();
+	header.table_offset = this->offset_ + padding;
+	if (!this->table_.empty()) {
+		this->ofs_.write(
+			reinterpret_cast<const char*>(this->table_.data()),
+			this->table_.size() * sizeof(FrameArchiveFormat::Entry));
+	}
+	this->ofs_.seekp(0);
+	this->ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	bool ok = static_cast<bool>(this->ofs_);
+	this->ofs_.close();
+	return ok;
+}
+
+std::size_t FrameArchiveWriter::size()const {
+	return this->table_.size();
+}
@@ -0,0 +1,87 @@
+#ifndef __FRAME_ARCHIVE_HPP__
+#define __FRAME_ARCHIVE_HPP__
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include "MappedFile.hpp"
+
+/**
+ * Single-file timelapse: the encoded frames concatenated, followed by an offset table.
+ *
+ * Layout (native endian):
+ *   Header
+ *   unsigned char frames[]       encoded images as they were on disk
+ *   Entry         table[count]   at Header::table_offset
+ */
+struct FrameArchiveFormat {
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t reserved;
+		std::uint64_t count;
+		std::uint64_t table_offset;
+	};
+	struct Entry {
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+	static const std::uint32_t VERSION = 1;
+	static const char MAGIC[8];
+};
+
+/**
+ * Reader of a frame archive. The file is mmapped and frames are handed out
+ * as cv::Mat headers over the mapping, so nothing is copied before decoding.
+ */
+class FrameArchive {
+private:
+	MappedFile mapped_;
+	const FrameArchiveFormat::Entry* table_ = nullptr;
+	std::size_t count_ = 0;
+public:
+	FrameArchive();
+	~FrameArchive();
+
+	/**
+	 * Returns true if filename starts with the archive magic.
+	 */
+	static bool isArchive(const std::string& filename);
+	bool open(const std::string& filename);
+	void close();
+	std::size_t size()const;
+
+	/**
+	 * Encoded bytes of frame as a 1xN CV_8UC1 matrix pointing into the mapping.
+	 * Valid while the archive is open.
+	 */
+	cv::Mat encoded(const std::size_t& frame)const;
+
+	/**
+	 * Decodes frame with cv::imdecode flags.
+	 */
+	bool read(const std::size_t& frame, cv::Mat& image, int flags)const;
+};
+
+/**
+ * Appends encoded frames to a new archive. The table is written by close().
+ */
+class FrameArchiveWriter {
+private:
+	std::ofstream ofs_;
+	std::vector<FrameArchiveFormat::Entry> table_;
+	std::uint64_t offset_ = 0;
+public:
+	FrameArchiveWriter();
+	~FrameArchiveWriter();
+	bool open(const std::string& filename);
+
+	/**
+	 * Returns false for an empty frame, which the reader rejects.
+	 */
+	bool append(const unsigned char* data, const std::size_t& size);
+	bool close();
+	std::size_t size()const;
+};
+#endif
@@ -0,0 +1,165 @@
+#include "FrameIndex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+namespace {
+	const char FRAME_INDEX_MAGIC[8] = { 'F', 'C', 'F', 'I', 'D', 'X', '\0', '\0' };
+}
+
+FrameIndex::FrameIndex() {
+}
+
+FrameIndex::~FrameIndex() {
+}
+
+boost::filesystem::path FrameIndex::indexPath(const boost::filesystem::path& dirname) {
+	auto dir = boost::filesystem::absolute(dirname);
+	while (dir.has_parent_path() && (dir.filename() == "." || dir.filename().empty() || dir.filename() == "/")) {
+		dir = dir.parent_path();
+	}
+	return dir.parent_path() / (dir.filename().string() + ".frameindex");
+}
+
+bool FrameIndex::open(const boost::filesystem::path& dirname) {
+	namespace bf = boost::filesystem;
+	this->close();
+	boost::system::error_code ec;
+	if (!bf::is_directory(dirname, ec)) {
+		return false;
+	}
+	std::int64_t mtime = static_cast<std::int64_t>(bf::last_write_time(dirname, ec));
+	if (ec) {
+		return false;
+	}
+	this->directory_ = dirname;
+	auto index_path = FrameIndex::indexPath(dirname);
+	if (this->mapped_.open(index_path.string())
+		&& this->attach(reinterpret_cast<const char*>(this->mapped_.data()), this->mapped_.size(), mtime)) {
+		return this->count_ > 0;
+	}
+	this->mapped_.close();
+	return this->build(index_path, mtime) && this->count_ > 0;
+}
+
+void FrameIndex::close() {
+	this->mapped_.close();
+	this->memory_.clear();
+	this->strings_ = nullptr;
+	this->offsets_ = nullptr;
+	this->count_ = 0;
+}
+
+bool FrameIndex::attach(const char* data, const std::size_t& size, const std::int64_t& mtime) {
+	if (size < sizeof(Header)) {
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, data, sizeof(Header));
+	if (std::memcmp(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != FrameIndex::VERSION
+		|| header.directory_mtime != mtime) {
+		return false;
+	}
+	// derive the count from the file size so a corrupt header can not overflow the check
+	const std::uint64_t body_size = size - sizeof(Header);
+	if (header.strings_size > body_size) {
+		return false;
+	}
+	const std::uint64_t table_size = body_size - header.strings_size;
+	if (table_size % sizeof(std::uint64_t) != 0
+		|| table_size / sizeof(std::uint64_t) == 0
+		|| header.count != table_size / sizeof(std::uint64_t) - 1) {
+		return false;
+	}
+	const std::uint64_t* offsets = reinterpret_cast<const std::uint64_t*>(data + sizeof(Header));
+	const std::size_t count = static_cast<std::size_t>(header.count);
+	// path() reads the names between consecutive offsets
+	if (offsets[0] != 0 || offsets[count] != header.strings_size) {
+		return false;
+	}
+	for (std::size_t i = 0; i < count; ++i) {
+		if (offsets[i] > offsets[i + 1]) {
+			return false;
+		}
+	}
+	this->offsets_ = offsets;
+	this->strings_ = data + sizeof(Header) + table_size;
+	this->count_ = count;
+	return true;
+}
+
+bool FrameIndex::build(const boost::filesystem::path& index_path, const std::int64_t& mtime) {
+	namespace bf = boost::filesystem;
+	std::vector<std::string> names;
+	for (const auto& file : bf::directory_iterator(this->directory_)) {
+		if (bf::is_regular(file)) {
+			names.push_back(file.path().filename().string());
+		}
+	}
+	std::sort(names.begin(), names.end());
+	Header header;
+	std::memcpy(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic));
+	header.version = FrameIndex::VERSION;
+	header.reserved = 0;
+	header.directory_mtime = mtime;
+	header.count = names.size();
+	header.strings_size = 0;
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(names.size() + 1);
+	for (const auto& name : names) {
+		offsets.push_back(header.strings_size);
+		header.strings_size += name.size();
+	}
+	offsets.push_back(header.strings_size);
+
+	this->memory_.resize(sizeof(Header) + offsets.size() * sizeof(std::uint64_t) + header.strings_size);
+	char* p = this->memory_.data();
+	std::memcpy(p, &header, sizeof(Header));
+	p += sizeof(Header);
+	std::memcpy(p, offsets.data(), offsets.size() * sizeof(std::uint64_t));
+	p += offsets.size() * sizeof(std::uint64_t);
+	for (const auto& name : names) {
+		std::memcpy(p, name.data(), name.size());
+		p += name.size();
+	}
+	if (!this->attach(this->memory_.data(), this->memory_.size(), mtime)) {
+		return false;
+	}
+	// A directory modified during this second could still change without changing its mtime.
+	if (mtime >= static_cast<std::int64_t>(std::time(nullptr))) {
+		return true;
+	}
+	auto temp_path = index_path;
+	temp_path += ".tmp";
+	{
+		std::ofstream ofs(temp_path.string(), std::ios::binary | std::ios::trunc);
+		if (!ofs) {
+			return true;
+		}
+		ofs.write(this->memory_.data(), this->memory_.size());
+		if (!ofs) {
+			ofs.close();
+			boost::system::error_code ec;
+			bf::remove(temp_path, ec);
+			return true;
+		}
+	}
+	boost::system::error_code ec;
+	bf::rename(temp_path, index_path, ec);
+	if (ec) {
+		bf::remove(temp_path, ec);
+	}
+	return true;
+}
+
+std::size_t FrameIndex::size()const {
+	return this->count_;
+}
+
+boost::filesystem::path FrameIndex::path(const std::size_t& frame)const {
+	const std::uint64_t begin = this->offsets_[frame];
+	const std::uint64_t end = this->offsets_[frame + 1];
+	return this->directory_ / std::string(this->strings_ + begin, static_cast<std::size_t>(end - begin));
+}
@@ -0,0 +1,59 @@
+#ifndef __FRAME_INDEX_HPP__
+#define __FRAME_INDEX_HPP__
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include "MappedFile.hpp"
+
+/**
+ * Sorted list of the frame files in a timelapse directory.
+ *
+ * The list is persisted next to the directory as "<dirname>.frameindex" the first time
+ * it is built and is mmapped on later opens, so a directory with millions of frames
+ * opens without walking it. The index is trusted while the directory mtime matches.
+ *
+ * Layout (native endian):
+ *   Header
+ *   uint64_t offsets[count + 1]   offsets of each file name in the string table
+ *   char     strings[]            file names, not terminated
+ */
+class FrameIndex {
+public:
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t reserved;
+		std::int64_t directory_mtime;
+		std::uint64_t count;
+		std::uint64_t strings_size;
+	};
+	static const std::uint32_t VERSION = 1;
+
+	FrameIndex();
+	~FrameIndex();
+
+	/**
+	 * Opens the index of dirname, rebuilding it if it is missing or stale.
+	 * If the index can not be written the list is kept in memory only.
+	 */
+	bool open(const boost::filesystem::path& dirname);
+	void close();
+	std::size_t size()const;
+	boost::filesystem::path path(const std::size_t& frame)const;
+
+	/**
+	 * Location of the persisted index for dirname.
+	 */
+	static boost::filesystem::path indexPath(const boost::filesystem::path& dirname);
+private:
+	boost::filesystem::path directory_;
+	MappedFile mapped_;
+	std::vector<char> memory_;
+	const char* strings_ = nullptr;
+	const std::uint64_t* offsets_ = nullptr;
+	std::size_t count_ = 0;
+	bool attach(const char* data, const std::size_t& size, const std::int64_t& mtime);
+	bool build(const boost::filesystem::path& index_path, const std::int64_t& mtime);
+};
+#endif
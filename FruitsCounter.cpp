@@ -0,0 +1,262 @@
+#include "FruitsCounter.hpp"
+#include <cmath>
+#include <limits>
+#include "DecodeScale.hpp"
+
+namespace {
+	cv::Point rect2point(const cv::Rect& rect) {
+		return cv::Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
+	}
+
+	double distance(const cv::Point& a, const cv::Point& b) {
+		return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2));
+	}
+
+	/**
+	 * Calls countup_func(previous, current) for every tomato of previous_tomato
+	 * and its nearest neighbour in current_tomato.
+	 */
+	template<typename COUNTUP_FUNC>
+	void associateNearest(const std::vector<cv::Rect>& previous_tomato, const std::vector<cv::Rect>& current_tomato, const COUNTUP_FUNC& coutup_func) {
+		if (previous_tomato.empty() || current_tomato.empty()) {
+			return;
+		}
+		for (const auto& pre : previous_tomato) {
+			double min_dist = std::numeric_limits<double>::infinity();
+			std::size_t min_dist_index = 0;
+			const auto pre_pos = ::rect2point(pre);
+			for (std::size_t i = 0; i < current_tomato.size(); ++i) {
+				double distance = ::distance(pre_pos, ::rect2point(current_tomato[i]));
+				if (min_dist > distance) {
+					min_dist = distance;
+					min_dist_index = i;
+				}
+			}
+			if (!std::isinf(min_dist)) {
+				coutup_func(pre_pos, ::rect2point(current_tomato[min_dist_index]));
+			}
+		}
+	}
+}
+
+FruitsCounter::FruitsCounter() {
+}
+
+FruitsCounter::FruitsCounter(const FruitsCounterConfig& config) {
+	this->configure(config);
+}
+
+bool FruitsCounter::configure(const FruitsCounterConfig& config) {
+	std::string error;
+	return this->configure(config, error);
+}
+
+bool FruitsCounter::configure(const FruitsCounterConfig& config, std::string& error) {
+	this->segmenter_.reset();
+	if (!::isValidDecodeScale(config.decode_scale)) {
+		error = "decode-scale must be 1, 2, 4 or 8";
+		return false;
+	}
+	if (config.tracker != "nearest" && config.tracker != "rotational" && config.tracker != "velocity") {
+		error = "tracker must be nearest, rotational or velocity";
+		return false;
+	}
+	this->config_ = config;
+	this->segmenter_ = ::createSegmenter(config.segmenter, config.decode_scale);
+	if (!this->segmenter_) {
+		error = "unknown segmenter " + config.segmenter;
+		return false;
+	}
+	this->segmenter_->setChangeTolerance(config.change_tolerance);
+	this->segmenter_->setThreads(config.segment_threads);
+	this->reset();
+	return true;
+}
+
+bool FruitsCounter::isConfigured()const {
+	return static_cast<bool>(this->segmenter_);
+}
+
+const FruitsCounterConfig& FruitsCounter::config()const {
+	return this->config_;
+}
+
+bool FruitsCounter::pushFrame(std::size_t frame, const cv::Mat& image) {
+	if (!this->segmenter_) {
+		return false;
+	}
+	std::vector<cv::Rect> rects;
+	this->segmenter_->segment(image, rects);
+	const int scale = this->config_.decode_scale;
+	for (auto& rect : rects) {
+		rect = cv::Rect(rect.x * scale, rect.y * scale, rect.width * scale, rect.height * scale);
+	}
+	return this->pushDetections(frame, cv::Size(image.cols * scale, image.rows * scale), rects);
+}
+
+bool FruitsCounter::prepare(const cv::Size& size) {
+	if (this->geometry_.empty()) {
+		if (this->config_.geometry.empty()) {
+			this->geometry_ = CountingGeometry::radial(size, this->config_.line_rad);
+		}
+		else if (!CountingGeometry::load(this->config_.geometry, size, this->geometry_)) {
+			return false;
+		}
+	}
+	if (!this->tracker_ && this->config_.tracker != "nearest") {
+		this->tracker_.reset(new MotionTracker(
+			cv::Point2d(size.width / 2, size.height / 2),
+			this->config_.tracker == "velocity" ? MotionTracker::CONSTANT_VELOCITY : MotionTracker::ROTATIONAL));
+	}
+	return true;
+}
+
+bool FruitsCounter::pushDetections(std::size_t frame, const cv::Size& size, const std::vector<cv::Rect>& detections) {
+	if (!this->prepare(size)) {
+		return false;
+	}
+	this->previous_.swap(this->detections_);
+	this->detections_ = detections;
+	this->frame_ = frame;
+	this->frames_++;
+	if (this->frames_ == 1 && this->config_.count_first_frame) {
+		for (const auto& rect : this->detections_) {
+			if (this->geometry_.isInRange(::rect2point(rect))) {
+				this->addEvent(frame, ::rect2point(rect), CountEvent::RANGE);
+			}
+		}
+	}
+	const bool counts = frame >= this->config_.count_from;
+	// a step can cross more than one line, and every crossing counts
+	std::vector<int> crossed;
+	auto countup_func = [this, frame, counts, &crossed](const cv::Point& a, const cv::Point& b) {
+		crossed.clear();
+		if (this->geometry_.crossedLines(a, b, crossed) == 0) {
+			return false;
+		}
+		if (counts) {
+			for (const int line : crossed) {
+				this->addEvent(frame, b, line);
+			}
+		}
+		return true;
+	};
+	if (this->config_.tracker == "nearest") {
+		if (this->frames_ >= 2) {
+			const double max_step = this->config_.max_step;
+			::associateNearest(this->previous_, this->detections_,
+				[&countup_func, max_step](const cv::Point& a, const cv::Point& b) {
+					return ::distance(a, b) < max_step && countup_func(a, b);
+				});
+		}
+	}
+	else {
+		this->tracker_->update(frame, this->detections_, countup_func);
+	}
+	return true;
+}
+
+void FruitsCounter::addEvent(std::size_t frame, const cv::Point& position, int line) {
+	this->count_++;
+	CountEvent event;
+	event.frame = frame;
+	event.timestamp = this->config_.frame_rate > 0 ? frame / this->config_.frame_rate : static_cast<double>(frame);
+	event.x = position.x;
+	event.y = position.y;
+	event.line = line;
+	event.total = this->count_;
+	this->events_.push_back(event);
+}
+
+std::size_t FruitsCounter::outOfRange()const {
+	std::size_t count = 0;
+	for (const auto& rect : this->detections_) {
+		if (!this->geometry_.isInRange(::rect2point(rect))) {
+			count++;
+		}
+	}
+	return count;
+}
+
+const std::vector<cv::Rect>& FruitsCounter::detections()const {
+	return this->detections_;
+}
+
+std::size_t FruitsCounter::count()const {
+	return this->count_;
+}
+
+std::size_t FruitsCounter::total()const {
+	return this->finished_ || this->geometry_.empty() ? this->count_ : this->count_ + this->outOfRange();
+}
+
+std::size_t FruitsCounter::finish() {
+	if (!this->finished_ && !this->geometry_.empty()) {
+		for (const auto& rect : this->detections_) {
+			if (!this->geometry_.isInRange(::rect2point(rect))) {
+				this->addEvent(this->frame_, ::rect2point(rect), CountEvent::RANGE);
+			}
+		}
+	}
+	this->finished_ = true;
+	return this->count_;
+}
+
+std::size_t FruitsCounter::takeEvents(std::vector<CountEvent>& events) {
+	const std::size_t taken = this->events_.size();
+	events.insert(events.end(), this->events_.begin(), this->events_.end());
+	this->events_.clear();
+	return taken;
+}
+
+FruitsCounterState FruitsCounter::state()const {
+	FruitsCounterState state;
+	state.frames = this->frames_;
+	state.frame = this->frame_;
+	state.count = this->count_;
+	state.size = this->geometry_.size();
+	state.detections = this->detections_;
+	if (this->tracker_) {
+		state.tracks = this->tracker_->tracks();
+	}
+	return state;
+}
+
+bool FruitsCounter::restore(const FruitsCounterState& state) {
+	this->reset();
+	if (state.frames > 0 && !this->prepare(state.size)) {
+		return false;
+	}
+	if (this->tracker_) {
+		this->tracker_->restore(state.tracks);
+	}
+	this->detections_ = state.detections;
+	this->frames_ = state.frames;
+	this->frame_ = state.frame;
+	this->count_ = state.count;
+	return true;
+}
+
+void FruitsCounter::reset() {
+	this->tracker_.reset();
+	this->geometry_ = CountingGeometry();
+	this->detections_.clear();
+	this->previous_.clear();
+	this->events_.clear();
+	this->frames_ = 0;
+	this->frame_ = 0;
+	this->count_ = 0;
+	this->finished_ = false;
+}
+
+std::size_t FruitsCounter::frames()const {
+	return this->frames_;
+}
+
+const CountingGeometry& FruitsCounter::geometry()const {
+	return this->geometry_;
+}
+
+const SegmenterBase& FruitsCounter::segmenter()const {
+	return *this->segmenter_;
+}
@@ -0,0 +1,146 @@
+#ifndef __FRUITS_COUNTER_HPP__
+#define __FRUITS_COUNTER_HPP__
+#include <string>
+#include <vector>
+#include <memory>
+#include <opencv2/core.hpp>
+#include "Segmenter.hpp"
+#include "MotionTracker.hpp"
+#include "CountingGeometry.hpp"
+#include "CountEventLog.hpp"
+
+struct FruitsCounterConfig {
+	/** segmentation configuration, see segmenterNames() */
+	std::string segmenter = "hls";
+	/** frames given to pushFrame are decoded at 1/decode_scale (1, 2, 4 or 8) */
+	int decode_scale = 1;
+	/** nearest: nearest neighbour of the previous frame, rotational / velocity: MotionTracker */
+	std::string tracker = "nearest";
+	/** counting geometry file (cv::FileStorage); empty uses two radial lines at line_rad */
+	std::string geometry;
+	double line_rad = 30.0 / 180.0 * 3.1415926535;
+	/** longest step in pixels the nearest-neighbour association accepts as a crossing */
+	double max_step = 50.0;
+	/** count the tomatoes in range at the first frame; off for shards, which add them when merged */
+	bool count_first_frame = true;
+	/** crossings into frames before this one only warm the tracker up */
+	std::size_t count_from = 0;
+	/** see SegmenterBase::setChangeTolerance; negative segments every frame in full */
+	int change_tolerance = -1;
+	/** see SegmenterBase::setThreads; 1 segments on the calling thread */
+	std::size_t segment_threads = 1;
+	/** frames per second of the source for CountEvent::timestamp; 0 stamps events with the frame index */
+	double frame_rate = 0.0;
+};
+
+/**
+ * What a FruitsCounter needs to continue a sequence from the last pushed frame.
+ */
+struct FruitsCounterState {
+	std::size_t frames = 0;
+	std::size_t frame = 0;
+	std::size_t count = 0;
+	/** full-resolution frame size, empty before the first frame */
+	cv::Size size;
+	std::vector<cv::Rect> detections;
+	/** tracks of the motion-model trackers */
+	std::vector<MotionTracker::Track> tracks;
+};
+
+/**
+ * Counts tomatoes crossing the counting lines of a sequence of frames.
+ *
+ * The count follows the rule of main: the tomatoes in range at the first frame,
+ * plus every line crossing, plus the tomatoes out of range at the last frame.
+ * Instances are independent, so one process can count any number of sequences;
+ * reset() starts a new sequence without rebuilding the segmenter.
+ */
+class FruitsCounter {
+private:
+	FruitsCounterConfig config_;
+	std::unique_ptr<SegmenterBase> segmenter_;
+	std::unique_ptr<MotionTracker> tracker_;
+	CountingGeometry geometry_;
+	std::vector<cv::Rect> detections_;
+	std::vector<cv::Rect> previous_;
+	std::vector<CountEvent> events_;
+	std::size_t frames_ = 0;
+	std::size_t frame_ = 0;
+	std::size_t count_ = 0;
+	bool finished_ = false;
+	void addEvent(std::size_t frame, const cv::Point& position, int line);
+	bool prepare(const cv::Size& size);
+	std::size_t outOfRange()const;
+public:
+	FruitsCounter();
+	explicit FruitsCounter(const FruitsCounterConfig& config);
+
+	/**
+	 * Returns false if the segmenter, decode_scale or tracker is unknown.
+	 */
+	bool configure(const FruitsCounterConfig& config);
+
+	/**
+	 * configure that also tells which setting was rejected.
+	 */
+	bool configure(const FruitsCounterConfig& config, std::string& error);
+	bool isConfigured()const;
+	const FruitsCounterConfig& config()const;
+
+	/**
+	 * Segments a frame decoded at 1/decode_scale and counts its detections.
+	 * \return false if the counter is not configured or the counting geometry can not be read
+	 */
+	bool pushFrame(std::size_t frame, const cv::Mat& image);
+
+	/**
+	 * Counts detections in full-resolution coordinates of an image of the given size.
+	 * Frames must be pushed in increasing order; gaps are fine for the motion-model trackers.
+	 */
+	bool pushDetections(std::size_t frame, const cv::Size& size, const std::vector<cv::Rect>& detections);
+
+	/**
+	 * Detections of the last pushed frame in full-resolution coordinates.
+	 */
+	const std::vector<cv::Rect>& detections()const;
+
+	/**
+	 * Tomatoes counted so far, without the ones out of range at the last frame.
+	 */
+	std::size_t count()const;
+
+	/**
+	 * Count if the sequence ended at the last pushed frame.
+	 */
+	std::size_t total()const;
+
+	/**
+	 * Ends the sequence: adds the tomatoes out of range at the last frame and returns the total.
+	 */
+	std::size_t finish();
+
+	/**
+	 * Moves the events since the last call to the end of events.
+	 */
+	std::size_t takeEvents(std::vector<CountEvent>& events);
+
+	/**
+	 * State after the last pushed frame; take the events of the frame first, they are not part of it.
+	 */
+	FruitsCounterState state()const;
+
+	/**
+	 * Continues the sequence a counter with the same configuration left in state.
+	 * \return false if the counting geometry can not be read
+	 */
+	bool restore(const FruitsCounterState& state);
+
+	/**
+	 * Starts a new sequence with the same configuration.
+	 */
+	void reset();
+	std::size_t frames()const;
+	const CountingGeometry& geometry()const;
+	const SegmenterBase& segmenter()const;
+};
+#endif
@@ -0,0 +1,109 @@
+#include "HogModel.hpp"
+#include <cstring>
+#include <cstddef>
+#include <fstream>
+#include <boost/crc.hpp>
+
+const char HogModelFormat::MAGIC[8] = { 'F', 'C', 'H', 'O', 'G', '\0', '\0', '\0' };
+
+namespace {
+	const std::size_t CHECKED_OFFSET = offsetof(HogModelFormat::Header, checksum) + sizeof(std::uint32_t);
+
+	std::uint32_t checksum(const HogModelFormat::Header& header, const float* detector) {
+		boost::crc_32_type crc;
+		crc.process_bytes(reinterpret_cast<const char*>(&header) + CHECKED_OFFSET, sizeof(header) - CHECKED_OFFSET);
+		crc.process_bytes(detector, header.detector_size * sizeof(float));
+		return crc.checksum();
+	}
+}
+
+HogModel::HogModel() {
+	std::memset(&this->header_, 0, sizeof(this->header_));
+}
+
+HogModel::~HogModel() {
+}
+
+bool HogModel::isModel(const std::string& filename) {
+	std::ifstream ifs(filename, std::ios::binary);
+	char magic[sizeof(HogModelFormat::MAGIC)];
+	if (!ifs.read(magic, sizeof(magic))) {
+		return false;
+	}
+	return std::memcmp(magic, HogModelFormat::MAGIC, sizeof(magic)) == 0;
+}
+
+bool HogModel::save(const std::string& filename, const cv::HOGDescriptor& hog, const std::vector<float>& detector) {
+	HogModelFormat::Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, HogModelFormat::MAGIC, sizeof(header.magic));
+	header.version = HogModelFormat::VERSION;
+	header.win_width = hog.winSize.width;
+	header.win_height = hog.winSize.height;
+	header.block_width = hog.blockSize.width;
+	header.block_height = hog.blockSize.height;
+	header.block_stride_x = hog.blockStride.width;
+	header.block_stride_y = hog.blockStride.height;
+	header.cell_width = hog.cellSize.width;
+	header.cell_height = hog.cellSize.height;
+	header.nbins = hog.nbins;
+	header.detector_size = static_cast<std::uint32_t>(detector.size());
+	header.checksum = ::checksum(header, detector.data());
+	std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(detector.data()), detector.size() * sizeof(float));
+	return static_cast<bool>(ofs);
+}
+
+bool HogModel::open(const std::string& filename) {
+	typedef HogModelFormat::Header Header;
+	this->close();
+	if (!this->mapped_.open(filename) || this->mapped_.size() < sizeof(Header)) {
+		this->close();
+		return false;
+	}
+	std::memcpy(&this->header_, this->mapped_.data(), sizeof(Header));
+	const float* detector = reinterpret_cast<const float*>(this->mapped_.data() + sizeof(Header));
+	if (std::memcmp(this->header_.magic, HogModelFormat::MAGIC, sizeof(this->header_.magic)) != 0
+		|| this->header_.version != HogModelFormat::VERSION
+		|| sizeof(Header) + this->header_.detector_size * sizeof(float) != this->mapped_.size()
+		|| ::checksum(this->header_, detector) != this->header_.checksum) {
+		this->close();
+		return false;
+	}
+	this->detector_ = detector;
+	return true;
+}
+
+void HogModel::close() {
+	this->mapped_.close();
+	this->detector_ = nullptr;
+	std::memset(&this->header_, 0, sizeof(this->header_));
+}
+
+bool HogModel::isOpened()const {
+	return this->detector_ != nullptr;
+}
+
+cv::HOGDescriptor HogModel::descriptor()const {
+	cv::HOGDescriptor hog(
+		cv::Size(this->header_.win_width, this->header_.win_height),
+		cv::Size(this->header_.block_width, this->header_.block_height),
+		cv::Size(this->header_.block_stride_x, this->header_.block_stride_y),
+		cv::Size(this->header_.cell_width, this->header_.cell_height),
+		this->header_.nbins);
+	hog.setSVMDetector(this->detector());
+	return hog;
+}
+
+cv::Mat HogModel::detector()const {
+	return cv::Mat(
+		1,
+		static_cast<int>(this->header_.detector_size),
+		CV_32FC1,
+		const_cast<float*>(this->detector_));
+}
+
+std::size_t HogModel::detectorSize()const {
+	return this->header_.detector_size;
+}
@@ -0,0 +1,78 @@
+#ifndef __HOG_MODEL_HPP__
+#define __HOG_MODEL_HPP__
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/objdetect.hpp>
+#include "MappedFile.hpp"
+
+/**
+ * Compact HOG detector: the HOG window parameters and the linear SVM collapsed to
+ * one weight vector followed by -rho, as taken by cv::HOGDescriptor::setSVMDetector.
+ *
+ * Layout (native endian):
+ *   Header
+ *   float detector[detector_size]
+ * checksum is the CRC-32 of everything after the checksum field.
+ */
+struct HogModelFormat {
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t checksum;
+		std::int32_t win_width;
+		std::int32_t win_height;
+		std::int32_t block_width;
+		std::int32_t block_height;
+		std::int32_t block_stride_x;
+		std::int32_t block_stride_y;
+		std::int32_t cell_width;
+		std::int32_t cell_height;
+		std::int32_t nbins;
+		std::uint32_t detector_size;
+	};
+	static const std::uint32_t VERSION = 1;
+	static const char MAGIC[8];
+};
+
+/**
+ * Reader of a HOG model. The file is mmapped and the detector is used in place.
+ */
+class HogModel {
+private:
+	MappedFile mapped_;
+	HogModelFormat::Header header_;
+	const float* detector_ = nullptr;
+public:
+	HogModel();
+	~HogModel();
+
+	/**
+	 * Returns true if filename starts with the model magic.
+	 */
+	static bool isModel(const std::string& filename);
+
+	/**
+	 * Writes the window parameters of hog and detector (weights and -rho).
+	 */
+	static bool save(const std::string& filename, const cv::HOGDescriptor& hog, const std::vector<float>& detector);
+
+	/**
+	 * Maps the file and checks the magic, version, size and checksum.
+	 */
+	bool open(const std::string& filename);
+	void close();
+	bool isOpened()const;
+
+	/**
+	 * HOG descriptor with the stored window parameters and the detector set.
+	 */
+	cv::HOGDescriptor descriptor()const;
+
+	/**
+	 * Detector as a 1xN CV_32FC1 matrix pointing into the mapping. Valid while the model is open.
+	 */
+	cv::Mat detector()const;
+	std::size_t detectorSize()const;
+};
+#endif
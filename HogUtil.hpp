@@ -1,11 +1,13 @@
 #ifndef __HOGUTIL_HPP__
 #define __HOGUTIL_HPP__
+#include <vector>
+#include <cstring>
 #include <opencv2/opencv.hpp>
-cv::Size getHOGWinSize() {
+inline cv::Size getHOGWinSize() {
 	return cv::Size(128, 64);
 }
 
-cv::HOGDescriptor getDefaultHOGDescriptor() {
+inline cv::HOGDescriptor getDefaultHOGDescriptor() {
 	return cv::HOGDescriptor(
 		::getHOGWinSize(),
 		cv::Size(16, 16),
@@ -14,4 +16,32 @@ cv::HOGDescriptor getDefaultHOGDescriptor() {
 		9
 	);
 }
+
+/**
+ * Collapses a trained linear SVM to the weight vector followed by -rho,
+ * the form taken by cv::HOGDescriptor::setSVMDetector.
+ * The decision function of a C_SVC is positive for the lower label, so it is negated
+ * to score the +1 class positive as with EPS_SVR.
+ */
+inline void get_svm_detector(const cv::Ptr<cv::ml::SVM>& svm, std::vector< float > & hog_detector)
+{
+	cv::Mat sv = svm->getSupportVectors();
+	const int sv_total = sv.rows;
+	// get the decision function
+	cv::Mat alpha, svidx;
+	double rho = svm->getDecisionFunction(0, alpha, svidx);
+	CV_Assert(alpha.total() == 1 && svidx.total() == 1 && sv_total == 1);
+	CV_Assert((alpha.type() == CV_64F && alpha.at<double>(0) == 1.) ||
+		(alpha.type() == CV_32F && alpha.at<float>(0) == 1.f));
+	CV_Assert(sv.type() == CV_32F);
+	hog_detector.clear();
+	hog_detector.resize(sv.cols + 1);
+	memcpy(&hog_detector[0], sv.ptr(), sv.cols*sizeof(hog_detector[0]));
+	hog_detector[sv.cols] = (float)-rho;
+	if (svm->getType() == cv::ml::SVM::C_SVC) {
+		for (auto& w : hog_detector) {
+			w = -w;
+		}
+	}
+}
 #endif
\ No newline at end of file
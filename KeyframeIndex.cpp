@@ -0,0 +1,294 @@
+#include "KeyframeIndex.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace {
+	const char KEYFRAME_INDEX_MAGIC[8] = { 'F', 'C', 'K', 'I', 'D', 'X', '\0', '\0' };
+
+	/**
+	 * "30000/1001" or "25" to frames per second, 0 if unknown.
+	 */
+	double parseRate(const std::string& rate) {
+		const auto slash = rate.find('/');
+		if (slash == std::string::npos) {
+			return std::atof(rate.c_str());
+		}
+		const double den = std::atof(rate.c_str() + slash + 1);
+		return den > 0 ? std::atof(rate.substr(0, slash).c_str()) / den : 0.0;
+	}
+}
+
+bool readCommandLines(const std::string& command, std::vector<std::string>& lines) {
+	lines.clear();
+	FILE* pipe = popen(command.c_str(), "r");
+	if (pipe == nullptr) {
+		return false;
+	}
+	std::string line;
+	char buffer[4096];
+	while (std::fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+		line += buffer;
+		if (!line.empty() && line.back() == '\n') {
+			line.pop_back();
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			lines.push_back(line);
+			line.clear();
+		}
+	}
+	if (!line.empty()) {
+		lines.push_back(line);
+	}
+	return pclose(pipe) == 0;
+}
+
+std::string shellQuote(const std::string& filename) {
+#ifdef _WIN32
+	// the command line parsing of the C runtime: backslashes are literal unless they precede a quote
+	std::string quoted = "\"";
+	std::size_t backslashes = 0;
+	for (char c : filename) {
+		if (c == '\\') {
+			backslashes++;
+		}
+		else if (c == '"') {
+			quoted.append(backslashes * 2 + 1, '\\');
+			backslashes = 0;
+		}
+		else {
+			quoted.append(backslashes, '\\');
+			backslashes = 0;
+		}
+		if (c != '\\') {
+			quoted += c;
+		}
+	}
+	quoted.append(backslashes * 2, '\\');
+	return quoted + "\"";
+#else
+	std::string quoted = "'";
+	for (char c : filename) {
+		if (c == '\'') {
+			quoted += "'\\''";
+		}
+		else {
+			quoted += c;
+		}
+	}
+	return quoted + "'";
+#endif
+}
+
+KeyframeIndex::KeyframeIndex() {
+	std::memset(&this->header_, 0, sizeof(this->header_));
+}
+
+KeyframeIndex::~KeyframeIndex() {
+}
+
+boost::filesystem::path KeyframeIndex::indexPath(const boost::filesystem::path& video) {
+	auto path = video;
+	path += ".keyindex";
+	return path;
+}
+
+bool KeyframeIndex::open(const boost::filesystem::path& video) {
+	namespace bf = boost::filesystem;
+	this->close();
+	boost::system::error_code ec;
+	const std::int64_t mtime = static_cast<std::int64_t>(bf::last_write_time(video, ec));
+	if (ec) {
+		return false;
+	}
+	const std::uint64_t video_size = bf::file_size(video, ec);
+	if (ec) {
+		return false;
+	}
+	const auto index_path = KeyframeIndex::indexPath(video);
+	if (this->mapped_.open(index_path.string())
+		&& this->attach(reinterpret_cast<const char*>(this->mapped_.data()), this->mapped_.size(), mtime, video_size)) {
+		return this->header_.frame_count > 0;
+	}
+	this->mapped_.close();
+	return this->build(video, index_path, mtime, video_size) && this->header_.frame_count > 0;
+}
+
+void KeyframeIndex::close() {
+	this->mapped_.close();
+	this->memory_.clear();
+	std::memset(&this->header_, 0, sizeof(this->header_));
+	this->key_frames_ = nullptr;
+	this->key_times_ = nullptr;
+}
+
+bool KeyframeIndex::attach(const char* data, const std::size_t& size, const std::int64_t& mtime, const std::uint64_t& video_size) {
+	if (size < sizeof(Header)) {
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, data, sizeof(Header));
+	if (std::memcmp(header.magic, KEYFRAME_INDEX_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != KeyframeIndex::VERSION
+		|| header.video_mtime != mtime
+		|| header.video_size != video_size) {
+		return false;
+	}
+	// derive the key count from the file size so a corrupt header can not overflow the check
+	const std::uint64_t entry_size = sizeof(std::uint64_t) + sizeof(double);
+	const std::uint64_t body_size = size - sizeof(Header);
+	if (body_size % entry_size != 0 || header.key_count != body_size / entry_size || header.key_count == 0) {
+		return false;
+	}
+	// keyBefore searches the key frames and decoding starts at key 0
+	const std::uint64_t* key_frames = reinterpret_cast<const std::uint64_t*>(data + sizeof(Header));
+	if (key_frames[0] != 0) {
+		return false;
+	}
+	for (std::uint64_t i = 1; i < header.key_count; ++i) {
+		if (key_frames[i] < key_frames[i - 1]) {
+			return false;
+		}
+	}
+	this->header_ = header;
+	this->key_frames_ = key_frames;
+	this->key_times_ = reinterpret_cast<const double*>(data + sizeof(Header) + header.key_count * sizeof(std::uint64_t));
+	return true;
+}
+
+bool KeyframeIndex::build(const boost::filesystem::path& video, const boost::filesystem::path& index_path, const std::int64_t& mtime, const std::uint64_t& video_size) {
+	namespace bf = boost::filesystem;
+	const std::string quoted = ::shellQuote(video.string());
+	std::vector<std::string> lines;
+	if (!::readCommandLines("ffprobe -v error -select_streams v:0 -show_entries stream=width,height,avg_frame_rate,start_time -of default=noprint_wrappers=1 " + quoted, lines)) {
+		return false;
+	}
+	std::map<std::string, std::string> stream;
+	for (const auto& line : lines) {
+		const auto eq = line.find('=');
+		if (eq != std::string::npos) {
+			stream[line.substr(0, eq)] = line.substr(eq + 1);
+		}
+	}
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, KEYFRAME_INDEX_MAGIC, sizeof(header.magic));
+	header.version = KeyframeIndex::VERSION;
+	header.video_mtime = mtime;
+	header.video_size = video_size;
+	header.width = std::atoi(stream["width"].c_str());
+	header.height = std::atoi(stream["height"].c_str());
+	header.fps = ::parseRate(stream["avg_frame_rate"]);
+	const double start_time = std::atof(stream["start_time"].c_str());
+	if (header.width <= 0 || header.height <= 0) {
+		return false;
+	}
+	// packets come in decode order; the frame number of a keyframe is the rank of its pts
+	if (!::readCommandLines("ffprobe -v error -select_streams v:0 -show_entries packet=pts_time,flags -of csv=p=0 " + quoted, lines)) {
+		return false;
+	}
+	std::vector<double> pts;
+	std::vector<double> key_pts;
+	pts.reserve(lines.size());
+	for (const auto& line : lines) {
+		const auto comma = line.find(',');
+		if (comma == std::string::npos || line.compare(0, comma, "N/A") == 0) {
+			continue;
+		}
+		const double t = std::atof(line.substr(0, comma).c_str());
+		pts.push_back(t);
+		if (line.find('K', comma) != std::string::npos) {
+			key_pts.push_back(t);
+		}
+	}
+	std::sort(pts.begin(), pts.end());
+	std::sort(key_pts.begin(), key_pts.end());
+	std::vector<std::uint64_t> key_frames;
+	std::vector<double> key_times;
+	for (const double t : key_pts) {
+		key_frames.push_back(std::lower_bound(pts.begin(), pts.end(), t) - pts.begin());
+		key_times.push_back(t - start_time);
+	}
+	if (key_frames.empty() || key_frames[0] != 0) {
+		// decoding always starts at the beginning of the file
+		key_frames.insert(key_frames.begin(), 0);
+		key_times.insert(key_times.begin(), 0.0);
+	}
+	header.frame_count = pts.size();
+	header.key_count = key_frames.size();
+
+	this->memory_.resize(sizeof(Header) + key_frames.size() * (sizeof(std::uint64_t) + sizeof(double)));
+	char* p = this->memory_.data();
+	std::memcpy(p, &header, sizeof(Header));
+	p += sizeof(Header);
+	std::memcpy(p, key_frames.data(), key_frames.size() * sizeof(std::uint64_t));
+	p += key_frames.size() * sizeof(std::uint64_t);
+	std::memcpy(p, key_times.data(), key_times.size() * sizeof(double));
+	if (!this->attach(this->memory_.data(), this->memory_.size(), mtime, video_size)) {
+		return false;
+	}
+	auto temp_path = index_path;
+	temp_path += ".tmp";
+	{
+		std::ofstream ofs(temp_path.string(), std::ios::binary | std::ios::trunc);
+		if (!ofs) {
+			return true;
+		}
+		ofs.write(this->memory_.data(), this->memory_.size());
+		if (!ofs) {
+			ofs.close();
+			boost::system::error_code ec;
+			bf::remove(temp_path, ec);
+			return true;
+		}
+	}
+	boost::system::error_code ec;
+	bf::rename(temp_path, index_path, ec);
+	if (ec) {
+		bf::remove(temp_path, ec);
+	}
+	return true;
+}
+
+std::size_t KeyframeIndex::frameCount()const {
+	return static_cast<std::size_t>(this->header_.frame_count);
+}
+
+std::size_t KeyframeIndex::keyCount()const {
+	return static_cast<std::size_t>(this->header_.key_count);
+}
+
+double KeyframeIndex::fps()const {
+	return this->header_.fps;
+}
+
+int KeyframeIndex::width()const {
+	return this->header_.width;
+}
+
+int KeyframeIndex::height()const {
+	return this->header_.height;
+}
+
+std::size_t KeyframeIndex::keyFrame(const std::size_t& key)const {
+	return static_cast<std::size_t>(this->key_frames_[key]);
+}
+
+double KeyframeIndex::keyTime(const std::size_t& key)const {
+	return this->key_times_[key];
+}
+
+std::size_t KeyframeIndex::keyBefore(const std::size_t& frame)const {
+	const std::uint64_t* end = this->key_frames_ + this->header_.key_count;
+	const std::uint64_t* it = std::upper_bound(this->key_frames_, end, static_cast<std::uint64_t>(frame));
+	return it == this->key_frames_ ? 0 : static_cast<std::size_t>(it - this->key_frames_ - 1);
+}
@@ -0,0 +1,83 @@
+#ifndef __KEYFRAME_INDEX_HPP__
+#define __KEYFRAME_INDEX_HPP__
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include "MappedFile.hpp"
+
+/**
+ * Frame count, geometry and keyframe positions of the first video stream of a file.
+ *
+ * Built once with ffprobe from the packet list (no decoding) and persisted next to the
+ * video as "<video>.keyindex", then mmapped on later opens. The index is trusted while
+ * the mtime and size of the video match.
+ *
+ * Layout (native endian):
+ *   Header
+ *   uint64_t key_frames[key_count]   frame numbers of the keyframes, ascending
+ *   double   key_times[key_count]    presentation time of the keyframes from the start of the file
+ */
+class KeyframeIndex {
+public:
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t reserved;
+		std::int64_t video_mtime;
+		std::uint64_t video_size;
+		std::uint64_t frame_count;
+		std::uint64_t key_count;
+		double fps;
+		std::int32_t width;
+		std::int32_t height;
+	};
+	static const std::uint32_t VERSION = 1;
+
+	KeyframeIndex();
+	~KeyframeIndex();
+
+	/**
+	 * Opens the index of video, rebuilding it if it is missing or stale.
+	 * Returns false if ffprobe is not available or finds no video stream.
+	 * If the index can not be written it is kept in memory only.
+	 */
+	bool open(const boost::filesystem::path& video);
+	void close();
+	std::size_t frameCount()const;
+	std::size_t keyCount()const;
+	double fps()const;
+	int width()const;
+	int height()const;
+	std::size_t keyFrame(const std::size_t& key)const;
+	double keyTime(const std::size_t& key)const;
+
+	/**
+	 * Last keyframe at or before frame, 0 if there is none.
+	 */
+	std::size_t keyBefore(const std::size_t& frame)const;
+
+	/**
+	 * Location of the persisted index for video.
+	 */
+	static boost::filesystem::path indexPath(const boost::filesystem::path& video);
+private:
+	MappedFile mapped_;
+	std::vector<char> memory_;
+	Header header_;
+	const std::uint64_t* key_frames_ = nullptr;
+	const double* key_times_ = nullptr;
+	bool attach(const char* data, const std::size_t& size, const std::int64_t& mtime, const std::uint64_t& video_size);
+	bool build(const boost::filesystem::path& video, const boost::filesystem::path& index_path, const std::int64_t& mtime, const std::uint64_t& video_size);
+};
+
+/**
+ * Runs command through the shell and returns its standard output line by line.
+ */
+bool readCommandLines(const std::string& command, std::vector<std::string>& lines);
+
+/**
+ * filename quoted for the shell.
+ */
+std::string shellQuote(const std::string& filename);
+#endif
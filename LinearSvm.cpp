@@ -0,0 +1,118 @@
+#include "LinearSvm.hpp"
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <boost/thread.hpp>
+
+namespace {
+	/**
+	 * Pegasos on the rows of blocks, starting from start.
+	 * The bias is the last weight, with a constant feature of 1.
+	 * w = scale * v, so the shrinking step of every iteration is O(1).
+	 */
+	void runEpoch(const FeatureFile& features, const LinearSvmParameters& params, const std::vector<std::size_t>& blocks,
+		std::size_t first_step, std::mt19937& rng, const std::vector<double>& start, std::vector<double>& result) {
+		const std::size_t dims = features.dims();
+		const double lambda = params.lambda;
+		const double max_norm2 = 1.0 / lambda;
+		std::vector<double> v(start);
+		double scale = 1.0;
+		double norm2 = 0.0;
+		for (double x : v) {
+			norm2 += x * x;
+		}
+		std::vector<std::size_t> rows;
+		std::size_t step = first_step;
+		for (std::size_t g = 0; g < blocks.size(); g += params.blocks_per_shuffle) {
+			rows.clear();
+			for (std::size_t b = g; b < std::min(g + params.blocks_per_shuffle, blocks.size()); ++b) {
+				const std::size_t begin = blocks[b] * params.block_rows;
+				const std::size_t end = std::min(begin + params.block_rows, features.size());
+				for (std::size_t i = begin; i < end; ++i) {
+					rows.push_back(i);
+				}
+			}
+			std::shuffle(rows.begin(), rows.end(), rng);
+			for (std::size_t i : rows) {
+				const float* x = features.features(i);
+				const double y = features.label(i) > 0 ? 1.0 : -1.0;
+				// offset of 2 keeps the first shrink factor above 0
+				const double eta = 1.0 / (lambda * (step + 2));
+				step++;
+				scale *= 1.0 - eta * lambda;
+				double dot = v[dims];
+				double x_norm2 = 1.0;
+				for (std::size_t d = 0; d < dims; ++d) {
+					dot += v[d] * x[d];
+					x_norm2 += static_cast<double>(x[d]) * x[d];
+				}
+				if (y * scale * dot < 1.0) {
+					const double c = eta * y / scale;
+					for (std::size_t d = 0; d < dims; ++d) {
+						v[d] += c * x[d];
+					}
+					v[dims] += c;
+					norm2 += 2.0 * c * dot + c * c * x_norm2;
+				}
+				// projection onto the ball of radius 1 / sqrt(lambda)
+				const double w_norm2 = scale * scale * norm2;
+				if (w_norm2 > max_norm2) {
+					scale *= std::sqrt(max_norm2 / w_norm2);
+				}
+				if (scale < 1e-9) {
+					for (double& value : v) {
+						value *= scale;
+					}
+					norm2 *= scale * scale;
+					scale = 1.0;
+				}
+			}
+		}
+		result.resize(v.size());
+		for (std::size_t d = 0; d < v.size(); ++d) {
+			result[d] = scale * v[d];
+		}
+	}
+}
+
+bool trainLinearSvm(const FeatureFile& features, const LinearSvmParameters& params, std::vector<float>& detector) {
+	if (features.size() == 0 || params.lambda <= 0 || params.block_rows == 0 || params.blocks_per_shuffle == 0) {
+		return false;
+	}
+	const std::size_t dims = features.dims();
+	const std::size_t block_count = (features.size() + params.block_rows - 1) / params.block_rows;
+	std::size_t threads = params.threads > 0 ? params.threads : std::max(1u, boost::thread::hardware_concurrency());
+	threads = std::min(threads, block_count);
+	// thread t owns blocks t, t + threads, ... so every share samples the whole file
+	std::vector<std::vector<std::size_t>> shares(threads);
+	for (std::size_t b = 0; b < block_count; ++b) {
+		shares[b % threads].push_back(b);
+	}
+	std::vector<std::mt19937> rngs;
+	for (std::size_t t = 0; t < threads; ++t) {
+		rngs.emplace_back(params.seed + static_cast<unsigned int>(t));
+	}
+	std::vector<double> weights(dims + 1, 0.0);
+	std::vector<std::vector<double>> results(threads);
+	for (std::size_t epoch = 0; epoch < params.epochs; ++epoch) {
+		boost::thread_group group;
+		for (std::size_t t = 0; t < threads; ++t) {
+			group.create_thread([&, t]() {
+				std::vector<std::size_t> blocks = shares[t];
+				std::shuffle(blocks.begin(), blocks.end(), rngs[t]);
+				const std::size_t rows_per_epoch = blocks.size() * params.block_rows;
+				::runEpoch(features, params, blocks, epoch * rows_per_epoch, rngs[t], weights, results[t]);
+			});
+		}
+		group.join_all();
+		for (std::size_t d = 0; d <= dims; ++d) {
+			double sum = 0.0;
+			for (std::size_t t = 0; t < threads; ++t) {
+				sum += results[t][d];
+			}
+			weights[d] = sum / threads;
+		}
+	}
+	detector.assign(weights.begin(), weights.end());
+	return true;
+}
@@ -0,0 +1,28 @@
+#ifndef __LINEAR_SVM_HPP__
+#define __LINEAR_SVM_HPP__
+#include <vector>
+#include "FeatureFile.hpp"
+
+struct LinearSvmParameters {
+	/** L2 regularization; roughly 1 / (C * number of samples) of a C-SVM */
+	double lambda = 1e-4;
+	std::size_t epochs = 5;
+	/** 0 uses the number of hardware threads */
+	std::size_t threads = 0;
+	/** rows read together; blocks are the unit of shuffling and of splitting work between threads */
+	std::size_t block_rows = 1024;
+	/** blocks whose rows are shuffled together, so label-sorted files still mix */
+	std::size_t blocks_per_shuffle = 16;
+	unsigned int seed = 0;
+};
+
+/**
+ * Trains a hinge-loss linear SVM on a feature file with Pegasos SGD.
+ *
+ * Rows are streamed from the mapping, so memory is one weight vector per thread whatever the file size.
+ * Each thread runs SGD over its own interleaved share of the blocks, starting from the same weights,
+ * and the weights are averaged after every epoch.
+ * \param[out] detector weights followed by the bias, the form cv::HOGDescriptor::setSVMDetector takes
+ */
+bool trainLinearSvm(const FeatureFile& features, const LinearSvmParameters& params, std::vector<float>& detector);
+#endif
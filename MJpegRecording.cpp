@@ -0,0 +1,139 @@
+#include "MJpegRecording.hpp"
+#include <cstddef>
+#include <cstring>
+
+namespace {
+	const char MJPEG_RECORDING_MAGIC[8] = { 'F', 'C', 'M', 'J', 'R', 'E', 'C', '\0' };
+}
+
+MJpegRecording::MJpegRecording() {
+	std::memset(&this->header_, 0, sizeof(this->header_));
+}
+
+MJpegRecording::~MJpegRecording() {
+}
+
+bool MJpegRecording::isRecording(const std::string& filename) {
+	std::ifstream ifs(filename, std::ios::binary);
+	char magic[sizeof(MJPEG_RECORDING_MAGIC)];
+	if (!ifs.read(magic, sizeof(magic))) {
+		return false;
+	}
+	return std::memcmp(magic, MJPEG_RECORDING_MAGIC, sizeof(magic)) == 0;
+}
+
+bool MJpegRecording::open(const std::string& filename) {
+	this->close();
+	if (!this->mapped_.open(filename) || this->mapped_.size() < sizeof(Header)) {
+		this->close();
+		return false;
+	}
+	std::memcpy(&this->header_, this->mapped_.data(), sizeof(Header));
+	if (std::memcmp(this->header_.magic, MJPEG_RECORDING_MAGIC, sizeof(this->header_.magic)) != 0
+		|| this->header_.version != MJpegRecording::VERSION
+		|| sizeof(Header) + this->header_.response_size > this->mapped_.size()) {
+		this->close();
+		return false;
+	}
+	// chunks are not aligned, so their headers are only read through memcpy
+	const unsigned char* p = this->mapped_.data();
+	const std::size_t size = this->mapped_.size();
+	bool previous_ff = false;
+	for (std::size_t offset = sizeof(Header) + static_cast<std::size_t>(this->header_.response_size); offset + sizeof(Chunk) <= size;) {
+		Chunk chunk;
+		std::memcpy(&chunk, p + offset, sizeof(Chunk));
+		if (chunk.size > size - offset - sizeof(Chunk)) {
+			break;
+		}
+		this->offsets_.push_back(offset);
+		const unsigned char* data = p + offset + sizeof(Chunk);
+		for (std::size_t i = 0; i < chunk.size; ++i) {
+			if (previous_ff && data[i] == 0xd9) {
+				this->frames_++;
+			}
+			previous_ff = data[i] == 0xff;
+		}
+		offset += sizeof(Chunk) + static_cast<std::size_t>(chunk.size);
+	}
+	this->mapped_.adviseSequential();
+	return true;
+}
+
+void MJpegRecording::close() {
+	this->mapped_.close();
+	std::memset(&this->header_, 0, sizeof(this->header_));
+	this->offsets_.clear();
+	this->frames_ = 0;
+}
+
+std::string MJpegRecording::response()const {
+	return std::string(
+		reinterpret_cast<const char*>(this->mapped_.data() + sizeof(Header)),
+		static_cast<std::size_t>(this->header_.response_size));
+}
+
+std::size_t MJpegRecording::size()const {
+	return this->offsets_.size();
+}
+
+std::int64_t MJpegRecording::time(const std::size_t& chunk)const {
+	std::int64_t t;
+	std::memcpy(&t, this->mapped_.data() + this->offsets_[chunk] + offsetof(Chunk, time), sizeof(t));
+	return t;
+}
+
+const unsigned char* MJpegRecording::data(const std::size_t& chunk)const {
+	return this->mapped_.data() + this->offsets_[chunk] + sizeof(Chunk);
+}
+
+std::size_t MJpegRecording::dataSize(const std::size_t& chunk)const {
+	std::uint64_t s;
+	std::memcpy(&s, this->mapped_.data() + this->offsets_[chunk] + offsetof(Chunk, size), sizeof(s));
+	return static_cast<std::size_t>(s);
+}
+
+std::int64_t MJpegRecording::duration()const {
+	return this->offsets_.empty() ? 0 : this->time(this->offsets_.size() - 1);
+}
+
+std::size_t MJpegRecording::frames()const {
+	return this->frames_;
+}
+
+MJpegRecordingWriter::MJpegRecordingWriter() {
+}
+
+MJpegRecordingWriter::~MJpegRecordingWriter() {
+	if (this->ofs_.is_open()) {
+		this->close();
+	}
+}
+
+bool MJpegRecordingWriter::open(const std::string& filename, const std::string& response) {
+	this->ofs_.open(filename, std::ios::binary | std::ios::trunc);
+	if (!this->ofs_) {
+		return false;
+	}
+	MJpegRecording::Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MJPEG_RECORDING_MAGIC, sizeof(header.magic));
+	header.version = MJpegRecording::VERSION;
+	header.response_size = response.size();
+	this->ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	this->ofs_.write(response.data(), response.size());
+	return static_cast<bool>(this->ofs_);
+}
+
+bool MJpegRecordingWriter::append(const std::int64_t& time, const unsigned char* data, const std::size_t& size) {
+	MJpegRecording::Chunk chunk;
+	chunk.time = time;
+	chunk.size = size;
+	this->ofs_.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+	this->ofs_.write(reinterpret_cast<const char*>(data), size);
+	return static_cast<bool>(this->ofs_);
+}
+
+bool MJpegRecordingWriter::close() {
+	this->ofs_.close();
+	return !this->ofs_.fail();
+}
@@ -0,0 +1,84 @@
+#ifndef __MJPEG_RECORDING_HPP__
+#define __MJPEG_RECORDING_HPP__
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "MappedFile.hpp"
+
+/**
+ * Bytes of an MJPEG camera stream as they arrived on the socket, with arrival times,
+ * so the stream can be served again byte for byte and at its original pace.
+ *
+ * Layout (native endian):
+ *   Header
+ *   char response[response_size]   HTTP response header of the camera, up to and including the empty line
+ *   chunks, each a Chunk followed by size bytes of the multipart body
+ *
+ * The recorder appends one chunk per socket read. A chunk cut short by an
+ * interrupted recorder is ignored.
+ */
+class MJpegRecording {
+public:
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t reserved;
+		std::uint64_t response_size;
+	};
+	struct Chunk {
+		/** microseconds since the response header arrived */
+		std::int64_t time;
+		std::uint64_t size;
+	};
+	static const std::uint32_t VERSION = 1;
+
+	MJpegRecording();
+	~MJpegRecording();
+	MJpegRecording(const MJpegRecording&) = delete;
+	MJpegRecording& operator=(const MJpegRecording&) = delete;
+
+	static bool isRecording(const std::string& filename);
+	bool open(const std::string& filename);
+	void close();
+
+	/**
+	 * HTTP response header to send before the first chunk.
+	 */
+	std::string response()const;
+	std::size_t size()const;
+	std::int64_t time(const std::size_t& chunk)const;
+	const unsigned char* data(const std::size_t& chunk)const;
+	std::size_t dataSize(const std::size_t& chunk)const;
+
+	/**
+	 * Time of the last chunk in microseconds.
+	 */
+	std::int64_t duration()const;
+
+	/**
+	 * Number of JPEG images (end of image markers) in the body.
+	 */
+	std::size_t frames()const;
+private:
+	MappedFile mapped_;
+	Header header_;
+	std::vector<std::size_t> offsets_;
+	std::size_t frames_ = 0;
+};
+
+class MJpegRecordingWriter {
+private:
+	std::ofstream ofs_;
+public:
+	MJpegRecordingWriter();
+	~MJpegRecordingWriter();
+
+	/**
+	 * Creates filename and writes the HTTP response header of the stream.
+	 */
+	bool open(const std::string& filename, const std::string& response);
+	bool append(const std::int64_t& time, const unsigned char* data, const std::size_t& size);
+	bool close();
+};
+#endif
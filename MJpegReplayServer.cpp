@@ -0,0 +1,208 @@
+#include "MJpegReplayServer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <boost/asio/basic_waitable_timer.hpp>
+#include <boost/chrono.hpp>
+
+namespace {
+	// boost::chrono regardless of how boost::asio::steady_timer is configured, so boost::chrono durations can be added
+	typedef boost::asio::basic_waitable_timer<boost::chrono::steady_clock> ReplayTimer;
+}
+
+struct MJpegReplayServer::Connection {
+	boost::asio::ip::tcp::socket socket;
+	ReplayTimer timer;
+	boost::asio::streambuf request;
+	std::string response;
+	const MJpegRecording* recording = nullptr;
+	std::size_t chunk = 0;
+	/** when chunk time 0 of the current pass is due */
+	ReplayTimer::time_point origin;
+
+	explicit Connection(boost::asio::io_service& io_service)
+		:socket(io_service), timer(io_service) {
+	}
+};
+
+MJpegReplayServer::MJpegReplayServer(const std::vector<const MJpegRecording*>& recordings, const Parameters& params)
+	:recordings_(recordings), params_(params), acceptor_(io_service_), connections_(0), active_(0), bytes_(0) {
+	if (this->params_.cameras == 0) {
+		this->params_.cameras = this->recordings_.size();
+	}
+	if (this->params_.threads == 0) {
+		this->params_.threads = 1;
+	}
+}
+
+MJpegReplayServer::~MJpegReplayServer() {
+	this->stop();
+}
+
+bool MJpegReplayServer::start(unsigned short port) {
+	if (this->recordings_.empty()) {
+		return false;
+	}
+	boost::system::error_code error;
+	const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+	this->acceptor_.open(endpoint.protocol(), error);
+	if (!error) {
+		this->acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), error);
+	}
+	if (!error) {
+		this->acceptor_.bind(endpoint, error);
+	}
+	if (!error) {
+		this->acceptor_.listen(boost::asio::socket_base::max_connections, error);
+	}
+	if (error) {
+		std::cerr << "ERROR: replay server: " << error.message() << std::endl;
+		return false;
+	}
+	this->accept();
+	for (std::size_t t = 0; t < this->params_.threads; ++t) {
+		this->threads_.create_thread([this]() { this->io_service_.run(); });
+	}
+	return true;
+}
+
+void MJpegReplayServer::stop() {
+	this->io_service_.stop();
+	this->threads_.join_all();
+	boost::system::error_code error;
+	this->acceptor_.close(error);
+	// the handlers still hold their connections, so close them for the clients to see the end
+	boost::mutex::scoped_lock l(this->open_mutex_);
+	for (const auto& weak : this->open_) {
+		if (auto connection = weak.lock()) {
+			connection->socket.close(error);
+		}
+	}
+	this->open_.clear();
+}
+
+unsigned short MJpegReplayServer::port()const {
+	boost::system::error_code error;
+	const auto endpoint = this->acceptor_.local_endpoint(error);
+	return error ? 0 : endpoint.port();
+}
+
+std::size_t MJpegReplayServer::cameras()const {
+	return this->params_.cameras;
+}
+
+MJpegReplayServer::Statistics MJpegReplayServer::statistics()const {
+	Statistics statistics;
+	statistics.connections = this->connections_;
+	statistics.active = this->active_;
+	statistics.bytes = this->bytes_;
+	return statistics;
+}
+
+void MJpegReplayServer::accept() {
+	auto connection = std::make_shared<Connection>(this->io_service_);
+	this->acceptor_.async_accept(connection->socket, [this, connection](const boost::system::error_code& error) {
+		if (error) {
+			return;
+		}
+		{
+			boost::mutex::scoped_lock l(this->open_mutex_);
+			this->open_.erase(
+				std::remove_if(this->open_.begin(), this->open_.end(), [](const std::weak_ptr<Connection>& c) { return c.expired(); }),
+				this->open_.end());
+			this->open_.push_back(connection);
+		}
+		boost::asio::async_read_until(connection->socket, connection->request, "\r\n\r\n",
+			[this, connection](const boost::system::error_code& error, std::size_t) {
+				if (!error) {
+					this->serve(connection);
+				}
+			});
+		this->accept();
+	});
+}
+
+void MJpegReplayServer::serve(const std::shared_ptr<Connection>& connection) {
+	std::istream request_stream(&connection->request);
+	std::string method, target;
+	request_stream >> method >> target;
+	// "/3" is camera 3, "/" camera 0
+	char* end = nullptr;
+	const unsigned long camera = target.size() > 1 ? std::strtoul(target.c_str() + 1, &end, 10) : 0;
+	if (method != "GET" || target.empty() || target[0] != '/' || (end != nullptr && *end != '\0') || camera >= this->params_.cameras) {
+		connection->response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		boost::asio::async_write(connection->socket, boost::asio::buffer(connection->response),
+			[connection](const boost::system::error_code&, std::size_t) {
+				boost::system::error_code ignored;
+				connection->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+			});
+		return;
+	}
+	connection->recording = this->recordings_[camera % this->recordings_.size()];
+	connection->response = connection->recording->response();
+	this->connections_++;
+	this->active_++;
+	boost::asio::async_write(connection->socket, boost::asio::buffer(connection->response),
+		[this, connection](const boost::system::error_code& error, std::size_t bytes) {
+			if (error) {
+				this->finish(connection);
+				return;
+			}
+			this->bytes_ += bytes;
+			connection->origin = ReplayTimer::clock_type::now();
+			this->sendChunk(connection);
+		});
+}
+
+void MJpegReplayServer::sendChunk(const std::shared_ptr<Connection>& connection) {
+	const MJpegRecording& recording = *connection->recording;
+	if (connection->chunk >= recording.size()) {
+		if (!this->params_.loop || recording.size() == 0) {
+			this->finish(connection);
+			return;
+		}
+		// the next pass starts one average chunk interval after the last chunk
+		const std::int64_t gap = recording.size() > 1 ? recording.duration() / static_cast<std::int64_t>(recording.size() - 1) : 0;
+		if (this->params_.speed > 0) {
+			connection->origin += boost::chrono::microseconds(static_cast<std::int64_t>((recording.duration() + gap) / this->params_.speed));
+		}
+		connection->chunk = 0;
+	}
+	const std::size_t chunk = connection->chunk++;
+	auto write = [this, connection, chunk]() {
+		const MJpegRecording& recording = *connection->recording;
+		boost::asio::async_write(connection->socket, boost::asio::buffer(recording.data(chunk), recording.dataSize(chunk)),
+			[this, connection](const boost::system::error_code& error, std::size_t bytes) {
+				if (error) {
+					this->finish(connection);
+					return;
+				}
+				this->bytes_ += bytes;
+				this->sendChunk(connection);
+			});
+	};
+	if (this->params_.speed <= 0) {
+		write();
+		return;
+	}
+	const auto due = connection->origin + boost::chrono::microseconds(static_cast<std::int64_t>(recording.time(chunk) / this->params_.speed));
+	if (due <= ReplayTimer::clock_type::now()) {
+		write();
+		return;
+	}
+	connection->timer.expires_at(due);
+	connection->timer.async_wait([this, connection, write](const boost::system::error_code& error) {
+		if (error) {
+			this->finish(connection);
+			return;
+		}
+		write();
+	});
+}
+
+void MJpegReplayServer::finish(const std::shared_ptr<Connection>& connection) {
+	boost::system::error_code ignored;
+	connection->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+	connection->socket.close(ignored);
+	this->active_--;
+}
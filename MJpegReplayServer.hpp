@@ -0,0 +1,74 @@
+#ifndef __MJPEG_REPLAY_SERVER_HPP__
+#define __MJPEG_REPLAY_SERVER_HPP__
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include "MJpegRecording.hpp"
+
+/**
+ * Serves recorded MJPEG streams on the loopback interface as if they came from cameras.
+ *
+ * Camera i is GET /i and plays recording i modulo the number of recordings, so a few
+ * recordings can emulate many cameras. Every connection plays its recording from the
+ * start, sending each chunk at its recorded time divided by the speed.
+ */
+class MJpegReplayServer {
+public:
+	struct Parameters {
+		/** 1: real time, N: N times real time, 0: as fast as the client reads */
+		double speed = 1.0;
+		/** start over at the end of the recording instead of closing the connection */
+		bool loop = false;
+		/** number of emulated cameras (0: one per recording) */
+		std::size_t cameras = 0;
+		/** threads running the sockets */
+		std::size_t threads = 1;
+	};
+	struct Statistics {
+		std::size_t connections = 0;
+		/** connections still streaming */
+		std::size_t active = 0;
+		std::size_t bytes = 0;
+	};
+private:
+	struct Connection;
+	std::vector<const MJpegRecording*> recordings_;
+	Parameters params_;
+	boost::asio::io_service io_service_;
+	boost::asio::ip::tcp::acceptor acceptor_;
+	boost::thread_group threads_;
+	std::atomic<std::size_t> connections_;
+	std::atomic<std::size_t> active_;
+	std::atomic<std::size_t> bytes_;
+	boost::mutex open_mutex_;
+	std::vector<std::weak_ptr<Connection>> open_;
+	void accept();
+	void serve(const std::shared_ptr<Connection>& connection);
+	void sendChunk(const std::shared_ptr<Connection>& connection);
+	void finish(const std::shared_ptr<Connection>& connection);
+public:
+	/**
+	 * \param[in] recordings opened recordings, which must outlive the server
+	 */
+	MJpegReplayServer(const std::vector<const MJpegRecording*>& recordings, const Parameters& params);
+	~MJpegReplayServer();
+	MJpegReplayServer(const MJpegReplayServer&) = delete;
+	MJpegReplayServer& operator=(const MJpegReplayServer&) = delete;
+
+	/**
+	 * Starts listening on 127.0.0.1:port; port 0 picks a free port.
+	 * \return false if the port can not be bound
+	 */
+	bool start(unsigned short port);
+	void stop();
+
+	/**
+	 * Port the server listens on.
+	 */
+	unsigned short port()const;
+	std::size_t cameras()const;
+	Statistics statistics()const;
+};
+#endif
@@ -2,9 +2,17 @@
 #include <iostream>
 #include <sstream>
 #include <opencv2/highgui.hpp>
+#include "DecodeScale.hpp"
 
 MJpegStream::MJpegStream(const std::size_t& request_size)
-	:REQUEST_SIZE(request_size){
+	:REQUEST_SIZE(request_size), socket_(io_service_){
+}
+
+MJpegStream::~MJpegStream() {
+	this->close();
+	if (this->read_thread_.joinable()) {
+		this->read_thread_.join();
+	}
 }
 
 void MJpegStream::buildRequest(const std::string& host, const std::string& file) {
@@ -30,7 +38,7 @@ void MJpegStream::buildRequest(const std::string& host, const std::string& file)
 }
 
 void MJpegStream::beginConnect(const std::string& host, const std::string& file, const std::string& port) {
-	boost::asio::ip::tcp::socket socket(io_service_);
+	boost::asio::ip::tcp::socket& socket = this->socket_;
 	boost::asio::ip::tcp::resolver resolver(io_service_);
 	this->buildRequest(host, file);
 	boost::asio::ip::tcp::resolver::query query(
@@ -69,6 +77,10 @@ void MJpegStream::beginConnect(const std::string& host, const std::string& file,
 		boost::mutex::scoped_lock l(this->is_connecting_mutex_);
 		running = this->is_connecting_ && running;
 	}
+	boost::mutex::scoped_lock l(this->is_connecting_mutex_);
+	this->is_connecting_ = false;
+	boost::system::error_code ignored;
+	socket.close(ignored);
 }
 
 
@@ -118,6 +130,11 @@ int MJpegStream::read(boost::asio::ip::tcp::socket& socket) {
 
 void MJpegStream::close(){
 	boost::mutex::scoped_lock l(this->is_connecting_mutex_);
+	if (this->is_connecting_) {
+		// the read thread closes the socket when it leaves the read this ends
+		boost::system::error_code ignored;
+		this->socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+	}
 	this->is_connecting_ = false;
 }
 
@@ -150,6 +167,7 @@ void MJpegStream::stripAImage() {
 		return;
 	}
 	this->currentframe_end_index_ = end_index - begin_index;
+	this->received_frames_++;
 	this->image_buf_.erase(this->image_buf_.begin(), this->image_buf_.begin() + begin_index);
 }
 
@@ -162,9 +180,26 @@ cv::Mat MJpegStream::readImage() {
 	for (auto i = 0; i <= this->currentframe_end_index_; ++i) {
 		buf.push_back(this->image_buf_[i]);
 	}
-	return cv::imdecode(cv::Mat(buf), CV_LOAD_IMAGE_COLOR);
+	return cv::imdecode(cv::Mat(buf), ::reducedColorFlag(this->decode_scale_));
+}
+
+std::size_t MJpegStream::receivedFrames() {
+	boost::mutex::scoped_lock l(this->image_buf_mutex_);
+	return this->received_frames_;
 }
 
 std::string MJpegStream::getLastErrorMessage()const {
 	return this->last_error_code_.message();
 }
+
+bool MJpegStream::setDecodeScale(int scale) {
+	if (!::isValidDecodeScale(scale)) {
+		return false;
+	}
+	this->decode_scale_ = scale;
+	return true;
+}
+
+int MJpegStream::decodeScale()const {
+	return this->decode_scale_;
+}
\ No newline at end of file
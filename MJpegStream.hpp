@@ -14,16 +14,20 @@ class MJpegStream {
 private:
 	const std::size_t REQUEST_SIZE;
 	boost::asio::io_service io_service_;
+	/** used by the read thread only, but shut down by close() while connected */
+	boost::asio::ip::tcp::socket socket_;
 	boost::system::error_code last_error_code_;
 	boost::asio::streambuf request_;
 	boost::thread read_thread_;
 	boost::mutex image_buf_mutex_;
 	std::vector<unsigned char> image_buf_;
 	std::size_t currentframe_end_index_ = 0;
+	std::size_t received_frames_ = 0;
 	boost::mutex is_connecting_mutex_;
 	bool is_connecting_ = false;
 	boost::mutex end_init_mutex_;
 	bool end_init_ = false;
+	int decode_scale_ = 1;
 	void buildRequest(const std::string& host, const std::string& file);
 	void beginConnect(const std::string& host, const std::string& file, const std::string& port);
 	void readRequestSize();
@@ -32,7 +36,16 @@ private:
 	void endInit();
 public:
 	MJpegStream(const std::size_t& request_size=1024);
+
+	/**
+	 * Closes the stream and waits for the read thread.
+	 */
+	~MJpegStream();
 	int connect(const std::string& host, const std::string& file, const std::string& port);
+
+	/**
+	 * Stops reading. The socket is shut down, so a read blocked on a stalled camera returns at once.
+	 */
 	void close();
 	bool isConnected();
 	cv::Mat readImage();
@@ -41,5 +54,11 @@ public:
 		return *this;
 	}
 	std::string getLastErrorMessage()const;
+	/**
+	 * Number of complete images received so far; readImage returns the same image until it changes.
+	 */
+	std::size_t receivedFrames();
+	bool setDecodeScale(int scale);
+	int decodeScale()const;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "MappedFile.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+MappedFile::MappedFile() {
+}
+
+MappedFile::MappedFile(const std::string& filename) :MappedFile() {
+	this->open(filename);
+}
+
+MappedFile::~MappedFile() {
+}
+
+bool MappedFile::open(const std::string& filename) {
+	namespace bi = boost::interprocess;
+	this->close();
+	boost::system::error_code ec;
+	auto size = boost::filesystem::file_size(filename, ec);
+	if (ec || size == 0) {
+		return false;
+	}
+	try {
+		bi::file_mapping mapping(filename.c_str(), bi::read_only);
+		bi::mapped_region region(mapping, bi::read_only);
+		this->mapping_.swap(mapping);
+		this->region_.swap(region);
+	}
+	catch (const bi::interprocess_exception&) {
+		return false;
+	}
+	this->is_opened_ = true;
+	return true;
+}
+
+void MappedFile::close() {
+	boost::interprocess::mapped_region empty_region;
+	boost::interprocess::file_mapping empty_mapping;
+	this->region_.swap(empty_region);
+	this->mapping_.swap(empty_mapping);
+	this->is_opened_ = false;
+}
+
+bool MappedFile::isOpened()const {
+	return this->is_opened_;
+}
+
+const unsigned char* MappedFile::data()const {
+	return static_cast<const unsigned char*>(this->region_.get_address());
+}
+
+std::size_t MappedFile::size()const {
+	return this->region_.get_size();
+}
+
+void MappedFile::adviseSequential() {
+	if (this->is_opened_) {
+		this->region_.advise(boost::interprocess::mapped_region::advice_sequential);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+#include <string>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+/**
+ * Read-only memory mapping of a whole file.
+ * Pages are loaded lazily by the OS, so opening is cheap regardless of the file size.
+ */
+class MappedFile {
+private:
+	boost::interprocess::file_mapping mapping_;
+	boost::interprocess::mapped_region region_;
+	bool is_opened_ = false;
+public:
+	MappedFile();
+	MappedFile(const std::string& filename);
+	~MappedFile();
+
+	/**
+	 * Maps the file. Returns false if it does not exist, is empty or can not be mapped.
+	 */
+	bool open(const std::string& filename);
+	void close();
+	bool isOpened()const;
+	const unsigned char* data()const;
+	std::size_t size()const;
+
+	/**
+	 * Hints the OS that the mapping will be read front to back so it reads ahead aggressively.
+	 */
+	void adviseSequential();
+};
+#endif
@@ -0,0 +1,135 @@
+#include "MotionTracker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace {
+	const double PI = 3.141592653589793238463;
+
+	double wrapAngle(double angle) {
+		while (angle > PI) {
+			angle -= 2.0 * PI;
+		}
+		while (angle < -PI) {
+			angle += 2.0 * PI;
+		}
+		return angle;
+	}
+
+	cv::Point rect2center(const cv::Rect& rect) {
+		return cv::Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
+	}
+}
+
+MotionTracker::MotionTracker(const cv::Point2d& center, MotionModel model, double gate, double max_step)
+	:center_(center), model_(model), gate_(gate), max_step_(max_step) {
+}
+
+cv::Point2d MotionTracker::predict(const Track& track, std::size_t frame)const {
+	const double dt = static_cast<double>(frame) - static_cast<double>(track.last_frame);
+	if (this->model_ == CONSTANT_VELOCITY) {
+		return cv::Point2d(track.position.x + track.velocity.x * dt, track.position.y + track.velocity.y * dt);
+	}
+	const double x = track.position.x - this->center_.x;
+	const double y = track.position.y - this->center_.y;
+	const double theta = std::atan2(y, x) + track.velocity.x * dt;
+	const double r = std::max(0.0, std::sqrt(x * x + y * y) + track.velocity.y * dt);
+	return cv::Point2d(this->center_.x + r * std::cos(theta), this->center_.y + r * std::sin(theta));
+}
+
+void MotionTracker::updateVelocity(Track& track, const cv::Point2d& position, std::size_t frame)const {
+	const double dt = static_cast<double>(frame) - static_cast<double>(track.last_frame);
+	if (dt <= 0) {
+		return;
+	}
+	cv::Point2d velocity;
+	if (this->model_ == CONSTANT_VELOCITY) {
+		velocity = cv::Point2d((position.x - track.position.x) / dt, (position.y - track.position.y) / dt);
+	}
+	else {
+		const double x0 = track.position.x - this->center_.x, y0 = track.position.y - this->center_.y;
+		const double x1 = position.x - this->center_.x, y1 = position.y - this->center_.y;
+		velocity = cv::Point2d(
+			::wrapAngle(std::atan2(y1, x1) - std::atan2(y0, x0)) / dt,
+			(std::sqrt(x1 * x1 + y1 * y1) - std::sqrt(x0 * x0 + y0 * y0)) / dt);
+	}
+	if (track.hits < 2) {
+		track.velocity = velocity;
+	}
+	else {
+		track.velocity.x = this->smoothing_ * velocity.x + (1.0 - this->smoothing_) * track.velocity.x;
+		track.velocity.y = this->smoothing_ * velocity.y + (1.0 - this->smoothing_) * track.velocity.y;
+	}
+}
+
+std::size_t MotionTracker::update(std::size_t frame, const std::vector<cv::Rect>& detections, const CrossFunc& crossed) {
+	typedef std::tuple<double, std::size_t, std::size_t> Relation;
+	std::vector<Relation> rels;
+	for (std::size_t t = 0; t < this->tracks_.size(); ++t) {
+		const auto& track = this->tracks_[t];
+		const auto predicted = this->predict(track, frame);
+		// a track seen only once has no velocity, so allow it to move as far as max_step per frame
+		const double dt = static_cast<double>(frame - track.last_frame);
+		const double gate = track.hits < 2 ? std::max(this->gate_, this->max_step_ * dt) : this->gate_;
+		for (std::size_t d = 0; d < detections.size(); ++d) {
+			const cv::Point c = ::rect2center(detections[d]);
+			const double dist = std::sqrt(std::pow(c.x - predicted.x, 2) + std::pow(c.y - predicted.y, 2));
+			if (dist < gate) {
+				rels.push_back(std::make_tuple(dist, t, d));
+			}
+		}
+	}
+	std::sort(rels.begin(), rels.end(),
+		[](const Relation& left, const Relation& right) {
+			return std::get<0>(left) < std::get<0>(right);
+		}
+	);
+	std::vector<bool> used_t(this->tracks_.size(), false);
+	std::vector<bool> used_d(detections.size(), false);
+	std::size_t count = 0;
+	for (const auto& r : rels) {
+		const std::size_t t = std::get<1>(r), d = std::get<2>(r);
+		if (used_t[t] || used_d[d]) {
+			continue;
+		}
+		used_t[t] = true;
+		used_d[d] = true;
+		auto& track = this->tracks_[t];
+		const cv::Point c = ::rect2center(detections[d]);
+		if (crossed(cv::Point(track.position), c)) {
+			count++;
+		}
+		const cv::Point2d position(c.x, c.y);
+		this->updateVelocity(track, position, frame);
+		track.position = position;
+		track.last_frame = frame;
+		track.hits++;
+		track.misses = 0;
+	}
+	std::vector<Track> next;
+	for (std::size_t t = 0; t < this->tracks_.size(); ++t) {
+		if (used_t[t] || ++this->tracks_[t].misses <= this->max_misses_) {
+			next.push_back(this->tracks_[t]);
+		}
+	}
+	for (std::size_t d = 0; d < detections.size(); ++d) {
+		if (!used_d[d]) {
+			Track track;
+			const cv::Point c = ::rect2center(detections[d]);
+			track.position = cv::Point2d(c.x, c.y);
+			track.last_frame = frame;
+			track.hits = 1;
+			next.push_back(track);
+		}
+	}
+	this->tracks_.swap(next);
+	return count;
+}
+
+const std::vector<MotionTracker::Track>& MotionTracker::tracks()const {
+	return this->tracks_;
+}
+
+void MotionTracker::restore(const std::vector<Track>& tracks) {
+	this->tracks_ = tracks;
+}
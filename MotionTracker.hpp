@@ -0,0 +1,59 @@
+#ifndef __MOTION_TRACKER_HPP__
+#define __MOTION_TRACKER_HPP__
+#include <vector>
+#include <functional>
+#include <opencv2/core.hpp>
+
+/**
+ * Tracker that associates detections with the predicted positions of existing tracks.
+ *
+ * Tomatoes move around the image center, so by default a track keeps its angular and radial
+ * velocity around center and is extrapolated along the circle. With the prediction the gate
+ * does not depend on how many frames were skipped, so counting survives frame decimation.
+ */
+class MotionTracker {
+public:
+	enum MotionModel {
+		ROTATIONAL,
+		CONSTANT_VELOCITY
+	};
+	struct Track {
+		cv::Point2d position;
+		// (angular [rad/frame], radial [px/frame]) for ROTATIONAL, (x, y) [px/frame] for CONSTANT_VELOCITY
+		cv::Point2d velocity;
+		std::size_t last_frame = 0;
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+	};
+	typedef std::function<bool(const cv::Point&, const cv::Point&)> CrossFunc;
+
+	/**
+	 * \param[in] center rotation center, the same center the counting lines use
+	 * \param[in] gate largest distance in pixels between a prediction and its detection
+	 * \param[in] max_step largest motion in pixels per frame of a track with no velocity yet
+	 */
+	MotionTracker(const cv::Point2d& center, MotionModel model = ROTATIONAL, double gate = 50.0, double max_step = 50.0);
+
+	/**
+	 * Associates the detections of frame with the tracks.
+	 * Returns how many associated tracks moved across a counting line according to crossed(from, to).
+	 */
+	std::size_t update(std::size_t frame, const std::vector<cv::Rect>& detections, const CrossFunc& crossed);
+	cv::Point2d predict(const Track& track, std::size_t frame)const;
+	const std::vector<Track>& tracks()const;
+
+	/**
+	 * Replaces the tracks, e.g. with the tracks() of an earlier run.
+	 */
+	void restore(const std::vector<Track>& tracks);
+private:
+	cv::Point2d center_;
+	MotionModel model_;
+	double gate_;
+	double max_step_;
+	std::size_t max_misses_ = 2;
+	double smoothing_ = 0.5;
+	std::vector<Track> tracks_;
+	void updateVelocity(Track& track, const cv::Point2d& position, std::size_t frame)const;
+};
+#endif
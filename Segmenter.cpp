@@ -0,0 +1,103 @@
+#include "Segmenter.hpp"
+#include <cmath>
+#include <functional>
+#include <map>
+
+namespace {
+	typedef std::function<std::unique_ptr<SegmenterBase>()> Factory;
+
+	template<class ColorModel, class Smoothing, class Opening>
+	Factory factory() {
+		return []() {
+			return std::unique_ptr<SegmenterBase>(new Segmenter<ColorModel, Smoothing, Opening>());
+		};
+	}
+
+	/**
+	 * The full resolution kernels are a 15x15 blur and 3 iterations of 3x3 (hls),
+	 * a 9x9 gaussian and a 15x15 opening (ver1); smaller decode scales shrink them.
+	 */
+	const std::map<std::pair<std::string, int>, Factory>& registry() {
+		static const std::map<std::pair<std::string, int>, Factory> factories = {
+			{ { "hls", 1 }, ::factory<HlsTomatoColorModel, BoxSmoothing<15>, RectOpening<3>>() },
+			{ { "hls", 2 }, ::factory<HlsTomatoColorModel, BoxSmoothing<7>, RectOpening<2>>() },
+			{ { "hls", 4 }, ::factory<HlsTomatoColorModel, BoxSmoothing<3>, RectOpening<1>>() },
+			{ { "hls", 8 }, ::factory<HlsTomatoColorModel, BoxSmoothing<1>, RectOpening<1>>() },
+			{ { "ver1", 1 }, ::factory<RgbDistanceColorModel, GaussianSmoothing<9>, RectOpening<7>>() },
+			{ { "ver1", 2 }, ::factory<RgbDistanceColorModel, GaussianSmoothing<5>, RectOpening<4>>() },
+			{ { "ver1", 4 }, ::factory<RgbDistanceColorModel, GaussianSmoothing<3>, RectOpening<2>>() },
+			{ { "ver1", 8 }, ::factory<RgbDistanceColorModel, GaussianSmoothing<1>, RectOpening<1>>() },
+		};
+		return factories;
+	}
+
+	struct HlsTables {
+		float hue[256];
+		float lightness[256];
+		float saturation[256];
+		HlsTables() {
+			for (int v = 0; v < 256; ++v) {
+				hue[v] = static_cast<float>(std::exp((std::abs(v - 90.0) / 90.0 - 1.0) / 3.0));
+				lightness[v] = static_cast<float>(std::exp(-std::abs(v - 128.0) / 128.0 / 3.0));
+				saturation[v] = static_cast<float>(std::exp(-(255.0 - v) / 255.0 / 3.0));
+			}
+		}
+	};
+
+	struct SquareTable {
+		float value[256];
+		SquareTable() {
+			for (int v = 0; v < 256; ++v) {
+				value[v] = static_cast<float>(v * v);
+			}
+		}
+	};
+}
+
+void HlsTomatoColorModel::probability(const cv::Mat& bgr, cv::Mat& prob) {
+	// exp((h + l + s) / 3) == exp(h / 3) * exp(l / 3) * exp(s / 3)
+	static const HlsTables tables;
+	cv::Mat hls;
+	cv::cvtColor(bgr, hls, cv::COLOR_BGR2HLS);
+	prob.create(hls.size(), CV_32FC1);
+	for (int y = 0; y < hls.rows; ++y) {
+		const unsigned char* in = hls.ptr<unsigned char>(y);
+		float* out = prob.ptr<float>(y);
+		for (int x = 0; x < hls.cols; ++x) {
+			out[x] = tables.hue[in[3 * x]] * tables.lightness[in[3 * x + 1]] * tables.saturation[in[3 * x + 2]];
+		}
+	}
+}
+
+void RgbDistanceColorModel::probability(const cv::Mat& bgr, cv::Mat& prob) {
+	static const SquareTable squares;
+	prob.create(bgr.size(), CV_8UC1);
+	for (int y = 0; y < bgr.rows; ++y) {
+		const unsigned char* in = bgr.ptr<unsigned char>(y);
+		unsigned char* out = prob.ptr<unsigned char>(y);
+		for (int x = 0; x < bgr.cols; ++x) {
+			const float distance = std::sqrt(squares.value[in[3 * x]] + squares.value[in[3 * x + 1]] + squares.value[255 - in[3 * x + 2]]);
+			const float p = 255.0f * 60.0f / (distance + 1.0f);
+			out[x] = static_cast<unsigned char>(p < 255.0f ? p : 255.0f);
+		}
+	}
+}
+
+std::unique_ptr<SegmenterBase> createSegmenter(const std::string& name, int decode_scale) {
+	const auto& factories = ::registry();
+	auto it = factories.find(std::make_pair(name, decode_scale));
+	if (it == factories.end()) {
+		return std::unique_ptr<SegmenterBase>();
+	}
+	return it->second();
+}
+
+std::vector<std::string> segmenterNames() {
+	std::vector<std::string> names;
+	for (const auto& entry : ::registry()) {
+		if (names.empty() || names.back() != entry.first.first) {
+			names.push_back(entry.first.first);
+		}
+	}
+	return names;
+}
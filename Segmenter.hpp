@@ -0,0 +1,379 @@
+#ifndef __SEGMENTER_HPP__
+#define __SEGMENTER_HPP__
+#include <string>
+#include <vector>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include "BinaryMorphology.hpp"
+#include "SeparableFilter.hpp"
+#include "DirtyTiles.hpp"
+#include "BandComponents.hpp"
+#include "WorkStealingPool.hpp"
+
+/**
+ * Finds tomato candidates in a BGR frame.
+ */
+class SegmenterBase {
+public:
+	virtual ~SegmenterBase() {}
+
+	/**
+	 * Bounding rects of the candidates, in the coordinates of frame.
+	 */
+	virtual void segment(const cv::Mat& frame, std::vector<cv::Rect>& rects) = 0;
+
+	/**
+	 * Smoothed probability of the last frame as CV_8UC1.
+	 */
+	virtual const cv::Mat& probability()const = 0;
+
+	/**
+	 * Mask after thresholding and opening of the last frame as CV_8UC1 of 0 and 255.
+	 */
+	virtual const cv::Mat& mask()const = 0;
+
+	/**
+	 * Reuses the probability of 64x64 tiles where no channel changed by more than tolerance
+	 * since they were last computed. Only dirty tiles and the smoothing halo around them
+	 * are recomputed; opening and contours still run on the whole mask.
+	 * \param[in] tolerance 0 reuses only identical tiles, negative recomputes every frame (default)
+	 */
+	virtual void setChangeTolerance(int tolerance) = 0;
+
+	/**
+	 * Fraction of the tiles of the last frame that were dirty, 1 without change tolerance.
+	 */
+	virtual double dirtyRatio()const = 0;
+
+	/**
+	 * Segments each frame in horizontal bands on a pool of threads workers (0: number of
+	 * hardware threads). A band reads the smoothing radius of probability and twice the
+	 * opening radius of mask around it, components crossing band seams are joined and the
+	 * ones inside holes are dropped, so the rects are those of the single-threaded pass,
+	 * though in another order. 1 (default) runs on the calling thread.
+	 * With change tolerance the probability is still updated on the calling thread.
+	 */
+	virtual void setThreads(std::size_t threads) = 0;
+};
+
+/**
+ * Color model of main.cpp: a product of per-channel terms of the HLS pixel,
+ * so it is evaluated with three 256-entry tables.
+ */
+struct HlsTomatoColorModel {
+	static const int DEPTH = CV_32F;
+	static double scale() { return 255.0; }
+	static double threshold() { return 255 * 0.73; }
+	static void probability(const cv::Mat& bgr, cv::Mat& prob);
+};
+
+/**
+ * Color model of the USE_VER1 variant: inverse distance to pure red in BGR.
+ */
+struct RgbDistanceColorModel {
+	static const int DEPTH = CV_8U;
+	static double scale() { return 1.0; }
+	static double threshold() { return 90; }
+	static void probability(const cv::Mat& bgr, cv::Mat& prob);
+};
+
+/**
+ * SIZE x SIZE box blur of CV_32FC1 or CV_8UC1, as cv::blur.
+ * src may be a ROI; pixels around it are read from the parent image as in a full-frame pass.
+ */
+template<int SIZE>
+struct BoxSmoothing {
+	/** how far a pixel of src reaches into dst */
+	static const int RADIUS = SIZE / 2;
+	/**
+	 * Takes src to dst, which must not share data with src.
+	 */
+	static void apply(const cv::Mat& src, cv::Mat& dst) {
+		static const Taps taps;
+		if (SIZE == 1) {
+			src.copyTo(dst);
+		}
+		else if (src.depth() == CV_32F) {
+			::separableFilter<SIZE, float>(src, dst, taps.real, [](float sum) {
+				return sum * (1.0f / (SIZE * SIZE));
+			});
+		}
+		else {
+			CV_Assert(src.depth() == CV_8U);
+			::separableFilter<SIZE, unsigned char>(src, dst, taps.fixed, [](int sum) {
+				return static_cast<unsigned char>((sum + SIZE * SIZE / 2) / (SIZE * SIZE));
+			});
+		}
+	}
+private:
+	struct Taps {
+		float real[SIZE];
+		int fixed[SIZE];
+		Taps() {
+			for (int k = 0; k < SIZE; ++k) {
+				this->real[k] = 1.0f;
+				this->fixed[k] = 1;
+			}
+		}
+	};
+};
+
+/**
+ * SIZE x SIZE gaussian blur of CV_32FC1 or CV_8UC1, as cv::GaussianBlur with sigma 0.
+ * CV_8UC1 uses the 8 fraction bit taps of OpenCV, so the result is the same to the bit.
+ * src may be a ROI; pixels around it are read from the parent image as in a full-frame pass.
+ */
+template<int SIZE>
+struct GaussianSmoothing {
+	/** how far a pixel of src reaches into dst */
+	static const int RADIUS = SIZE / 2;
+	/**
+	 * Takes src to dst, which must not share data with src.
+	 */
+	static void apply(const cv::Mat& src, cv::Mat& dst) {
+		static const Taps taps;
+		if (SIZE == 1) {
+			src.copyTo(dst);
+		}
+		else if (src.depth() == CV_32F) {
+			::separableFilter<SIZE, float>(src, dst, taps.real, [](float sum) {
+				return sum;
+			});
+		}
+		else {
+			CV_Assert(src.depth() == CV_8U);
+			// 8 fraction bits in each pass
+			::separableFilter<SIZE, unsigned char>(src, dst, taps.fixed, [](int sum) {
+				return static_cast<unsigned char>((sum + (1 << 15)) >> 16);
+			});
+		}
+	}
+private:
+	struct Taps {
+		float real[SIZE];
+		int fixed[SIZE];
+		Taps() {
+			const cv::Mat kernel = cv::getGaussianKernel(SIZE, 0.0, CV_64F);
+			int sum = 0;
+			for (int k = 0; k < SIZE; ++k) {
+				this->real[k] = static_cast<float>(kernel.at<double>(k));
+				this->fixed[k] = cvRound(kernel.at<double>(k) * 256);
+				sum += this->fixed[k];
+			}
+			this->fixed[RADIUS] += 256 - sum;
+		}
+	};
+};
+
+/**
+ * Opening with a (2 * RADIUS + 1) square on the bit-packed mask.
+ */
+template<int RADIUS>
+struct RectOpening {
+	static void apply(const BitMask& src, BitMask& dst) {
+		dst.create(src.rows(), src.cols());
+		::openSquare<RADIUS>(src, dst, 0, src.rows());
+	}
+	/**
+	 * Rows [y0, y1) of apply; dst must already have the size of src.
+	 */
+	static void apply(const BitMask& src, BitMask& dst, int y0, int y1) {
+		::openSquare<RADIUS>(src, dst, y0, y1);
+	}
+};
+
+/**
+ * Segmentation pipeline with its stages fixed at compile time:
+ * color model -> smoothing -> threshold -> opening -> contours.
+ * Kernel sizes are template constants, so the per-pixel loops of every stage are inlined and unrolled.
+ */
+template<class ColorModel, class Smoothing, class Opening>
+class Segmenter : public SegmenterBase {
+private:
+	cv::Mat prob_;
+	cv::Mat prob8u_;
+	cv::Mat binary_;
+	BitMask mask_;
+	BitMask opened_;
+	std::vector<std::vector<cv::Point>> contours_;
+	int tolerance_ = -1;
+	DirtyTiles tiles_;
+	/** unsmoothed probability; with change tolerance kept for the halo of the next frame's dirty tiles */
+	cv::Mat raw_;
+	cv::Mat tile_;
+	std::vector<cv::Rect> rects_;
+	double dirty_ratio_ = 1.0;
+	std::unique_ptr<WorkStealingPool> pool_;
+	BandComponents components_;
+	std::vector<cv::Mat> band_tiles_;
+
+	/**
+	 * Runs func(b, rect of band b) for every band, on the pool if there is one.
+	 */
+	template<class Func>
+	void forEachBand(int cols, const Func& func) {
+		const int bands = this->components_.bands();
+		auto run = [this, cols, &func](int b) {
+			const cv::Range rows = this->components_.band(b);
+			func(b, cv::Rect(0, rows.start, cols, rows.size()));
+		};
+		if (!this->pool_ || bands == 1) {
+			for (int b = 0; b < bands; ++b) {
+				run(b);
+			}
+			return;
+		}
+		for (int b = 0; b < bands; ++b) {
+			this->pool_->submit([&run, b]() { run(b); });
+		}
+		this->pool_->wait();
+	}
+
+	void updateMask(const cv::Mat& frame) {
+		ColorModel::probability(frame, this->raw_);
+		Smoothing::apply(this->raw_, this->prob_);
+		if (ColorModel::DEPTH == CV_8U) {
+			this->prob8u_ = this->prob_;
+		}
+		else {
+			this->prob_.convertTo(this->prob8u_, CV_8U, ColorModel::scale());
+		}
+		::packThreshold(this->prob8u_, ColorModel::threshold(), this->mask_);
+	}
+
+	void updateDirtyMask(const cv::Mat& frame) {
+		const bool is_new = this->raw_.size() != frame.size();
+		this->tiles_.update(frame, this->tolerance_);
+		this->dirty_ratio_ = static_cast<double>(this->tiles_.dirtyCount()) / (this->tiles_.cols() * this->tiles_.rows());
+		if (is_new) {
+			ColorModel::probability(frame, this->raw_);
+			Smoothing::apply(this->raw_, this->prob_);
+			this->prob8u_.create(frame.size(), CV_8UC1);
+			this->mask_.create(frame.rows, frame.cols);
+		}
+		else {
+			this->tiles_.rects(0, this->rects_);
+			for (const auto& rect : this->rects_) {
+				ColorModel::probability(frame(rect), this->tile_);
+				this->tile_.copyTo(this->raw_(rect));
+			}
+		}
+		// every pixel within RADIUS of a changed one; whole frame if it is new
+		if (is_new) {
+			this->rects_.assign(1, cv::Rect(0, 0, frame.cols, frame.rows));
+		}
+		else {
+			this->tiles_.rects(Smoothing::RADIUS, this->rects_);
+		}
+		for (const auto& rect : this->rects_) {
+			if (!is_new) {
+				Smoothing::apply(this->raw_(rect), this->tile_);
+				this->tile_.copyTo(this->prob_(rect));
+			}
+			this->prob_(rect).convertTo(this->prob8u_(rect), CV_8U, ColorModel::scale());
+			::packThreshold(this->prob8u_, ColorModel::threshold(), rect, this->mask_);
+		}
+	}
+
+	void updateBandMask(const cv::Mat& frame) {
+		// smoothing a band reads the probability of the bands next to it, so that is a separate pass
+		this->raw_.create(frame.size(), CV_MAKETYPE(ColorModel::DEPTH, 1));
+		this->prob_.create(frame.size(), CV_MAKETYPE(ColorModel::DEPTH, 1));
+		this->prob8u_.create(frame.size(), CV_8UC1);
+		if (this->mask_.rows() != frame.rows || this->mask_.cols() != frame.cols) {
+			this->mask_.create(frame.rows, frame.cols);
+		}
+		this->forEachBand(frame.cols, [this, &frame](int b, const cv::Rect& rect) {
+			ColorModel::probability(frame(rect), this->band_tiles_[b]);
+			this->band_tiles_[b].copyTo(this->raw_(rect));
+		});
+		this->forEachBand(frame.cols, [this](int b, const cv::Rect& rect) {
+			Smoothing::apply(this->raw_(rect), this->band_tiles_[b]);
+			this->band_tiles_[b].copyTo(this->prob_(rect));
+			this->prob_(rect).convertTo(this->prob8u_(rect), CV_8U, ColorModel::scale());
+			::packThreshold(this->prob8u_, ColorModel::threshold(), rect, this->mask_);
+		});
+	}
+
+	void segmentBands(const cv::Mat& frame, std::vector<cv::Rect>& rects) {
+		if (this->opened_.rows() != frame.rows || this->opened_.cols() != frame.cols) {
+			this->opened_.create(frame.rows, frame.cols);
+		}
+		this->binary_.create(frame.size(), CV_8UC1);
+		this->forEachBand(frame.cols, [this](int, const cv::Rect& rect) {
+			Opening::apply(this->mask_, this->opened_, rect.y, rect.y + rect.height);
+			::unpackMask(this->opened_, this->binary_, rect.y, rect.y + rect.height);
+		});
+		this->forEachBand(frame.cols, [this](int b, const cv::Rect&) {
+			this->components_.label(this->binary_, b);
+		});
+		this->components_.merge(rects);
+	}
+public:
+	void segment(const cv::Mat& frame, std::vector<cv::Rect>& rects) override {
+		// bands of at least 32 rows, so the halos stay small next to the bands
+		const int threads = this->pool_ ? static_cast<int>(this->pool_->threadCount()) : 1;
+		this->components_.reset(frame.rows, std::max(1, std::min(threads, frame.rows / 32)));
+		this->band_tiles_.resize(this->components_.bands());
+		const bool is_banded = this->components_.bands() > 1;
+		if (this->tolerance_ >= 0) {
+			this->updateDirtyMask(frame);
+		}
+		else if (is_banded) {
+			this->updateBandMask(frame);
+		}
+		else {
+			this->updateMask(frame);
+		}
+		if (is_banded) {
+			this->segmentBands(frame, rects);
+			return;
+		}
+		Opening::apply(this->mask_, this->opened_);
+		::unpackMask(this->opened_, this->binary_);
+		cv::findContours(this->binary_.clone(), this->contours_, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+		rects.clear();
+		for (const auto& contour : this->contours_) {
+			rects.push_back(cv::boundingRect(contour));
+		}
+	}
+	const cv::Mat& probability()const override {
+		return this->prob8u_;
+	}
+	const cv::Mat& mask()const override {
+		return this->binary_;
+	}
+	void setChangeTolerance(int tolerance) override {
+		this->tolerance_ = tolerance;
+		this->tiles_.reset();
+		this->raw_.release();
+		this->dirty_ratio_ = 1.0;
+	}
+	double dirtyRatio()const override {
+		return this->tolerance_ < 0 ? 1.0 : this->dirty_ratio_;
+	}
+	void setThreads(std::size_t threads) override {
+		if (threads == 1) {
+			this->pool_.reset();
+		}
+		else {
+			this->pool_.reset(new WorkStealingPool(threads));
+		}
+	}
+};
+
+/**
+ * Instantiates a registered configuration.
+ * Kernel sizes are compile-time constants, so there is one configuration per decode scale.
+ * \param[in] name color model, "hls" or "ver1"
+ * \param[in] decode_scale 1, 2, 4 or 8
+ * \return nullptr if there is no such configuration
+ */
+std::unique_ptr<SegmenterBase> createSegmenter(const std::string& name, int decode_scale);
+
+/**
+ * Names accepted by createSegmenter.
+ */
+std::vector<std::string> segmenterNames();
+#endif
@@ -0,0 +1,74 @@
+#ifndef __SEPARABLE_FILTER_HPP__
+#define __SEPARABLE_FILTER_HPP__
+#include <vector>
+#include <cstddef>
+#include <opencv2/core.hpp>
+
+/**
+ * Filters a 1 channel image of T with the same SIZE-tap kernel along rows and then columns.
+ * SIZE is a compile-time constant, so both tap loops unroll and the pixel loops vectorize.
+ * Pixels past the border are mirrored as with BORDER_REFLECT_101. If src is a ROI, pixels
+ * around it are read from the parent image, as cv::blur and cv::GaussianBlur do.
+ * \param[in] taps SIZE weights
+ * \param[in] finish turns the sum of both passes into a pixel of T
+ * \param[out] dst must not share data with src
+ */
+template<int SIZE, class T, class Acc, class Finish>
+void separableFilter(const cv::Mat& src, cv::Mat& dst, const Acc* taps, const Finish& finish) {
+	static_assert(SIZE % 2 == 1, "SIZE must be odd");
+	const int radius = SIZE / 2;
+	CV_Assert(src.channels() == 1 && src.elemSize() == sizeof(T));
+	if (src.empty()) {
+		dst.create(src.size(), src.type());
+		return;
+	}
+	CV_Assert(dst.data != src.data);
+	dst.create(src.size(), src.type());
+	cv::Size whole;
+	cv::Point offset;
+	src.locateROI(whole, offset);
+	const int cols = src.cols;
+	// column of src read at x - radius of the padded line, relative to src
+	std::vector<int> columns(cols + 2 * radius);
+	for (int x = 0; x < cols + 2 * radius; ++x) {
+		columns[x] = cv::borderInterpolate(offset.x + x - radius, whole.width, cv::BORDER_REFLECT_101) - offset.x;
+	}
+	std::vector<T> line(cols + 2 * radius);
+	// row pass of the last SIZE rows; row i is in slot (i + radius) % SIZE
+	std::vector<Acc> ring(static_cast<std::size_t>(SIZE) * cols);
+	auto filterRow = [&](int i) {
+		const int y = cv::borderInterpolate(offset.y + i, whole.height, cv::BORDER_REFLECT_101) - offset.y;
+		const T* in = reinterpret_cast<const T*>(src.data + static_cast<std::ptrdiff_t>(y) * static_cast<std::ptrdiff_t>(src.step[0]));
+		for (int x = 0; x < cols + 2 * radius; ++x) {
+			line[x] = in[columns[x]];
+		}
+		const T* padded = line.data();
+		Acc* out = ring.data() + static_cast<std::size_t>((i + radius) % SIZE) * cols;
+		for (int x = 0; x < cols; ++x) {
+			Acc sum = 0;
+			for (int k = 0; k < SIZE; ++k) {
+				sum += taps[k] * padded[x + k];
+			}
+			out[x] = sum;
+		}
+	};
+	for (int i = -radius; i < radius; ++i) {
+		filterRow(i);
+	}
+	const Acc* rows[SIZE];
+	for (int y = 0; y < src.rows; ++y) {
+		filterRow(y + radius);
+		for (int k = 0; k < SIZE; ++k) {
+			rows[k] = ring.data() + static_cast<std::size_t>((y + k) % SIZE) * cols;
+		}
+		T* out = dst.ptr<T>(y);
+		for (int x = 0; x < cols; ++x) {
+			Acc sum = 0;
+			for (int k = 0; k < SIZE; ++k) {
+				sum += taps[k] * rows[k][x];
+			}
+			out[x] = finish(sum);
+		}
+	}
+}
+#endif
@@ -0,0 +1,83 @@
+#include "Shard.hpp"
+#include "StateFile.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace {
+	const char SHARD_MAGIC[] = "FruitsCounterShard";
+	const int SHARD_VERSION = 1;
+}
+
+bool writeShard(const std::string& filename, const ShardState& state) {
+	// write to a temporary file first so a merge never sees a half written shard
+	const std::string temp = filename + ".tmp";
+	{
+		std::ofstream ofs(temp);
+		if (!ofs) {
+			return false;
+		}
+		ofs << SHARD_MAGIC << " " << SHARD_VERSION << "\n"
+			<< "range " << state.begin << " " << state.end << " " << state.total_frames << "\n"
+			<< "size " << state.width << " " << state.height << "\n"
+			<< "count " << state.count << "\n";
+		::writeRects(ofs, "first", state.first);
+		::writeRects(ofs, "last", state.last);
+		if (!ofs) {
+			return false;
+		}
+	}
+	return ::replaceFile(temp, filename);
+}
+
+bool readShard(const std::string& filename, ShardState& state) {
+	std::ifstream ifs(filename);
+	std::string magic, key;
+	int version = 0;
+	if (!(ifs >> magic >> version) || magic != SHARD_MAGIC || version != SHARD_VERSION) {
+		return false;
+	}
+	if (!(ifs >> key >> state.begin >> state.end >> state.total_frames) || key != "range") {
+		return false;
+	}
+	if (!(ifs >> key >> state.width >> state.height) || key != "size") {
+		return false;
+	}
+	if (!(ifs >> key >> state.count) || key != "count") {
+		return false;
+	}
+	return ::readRects(ifs, "first", state.first) && ::readRects(ifs, "last", state.last);
+}
+
+bool checkShardCoverage(std::vector<ShardState>& shards, std::string& error) {
+	if (shards.empty()) {
+		error = "no shards";
+		return false;
+	}
+	std::sort(shards.begin(), shards.end(), [](const ShardState& a, const ShardState& b) {
+		return a.begin < b.begin;
+	});
+	std::size_t expected = 0;
+	for (const auto& shard : shards) {
+		std::stringstream ss;
+		if (shard.total_frames != shards[0].total_frames
+			|| shard.width != shards[0].width
+			|| shard.height != shards[0].height) {
+			error = "shards come from different timelapses";
+			return false;
+		}
+		if (shard.begin != expected) {
+			ss << "shards do not cover frames [" << expected << ", " << shard.begin << ")";
+			error = ss.str();
+			return false;
+		}
+		expected = shard.end;
+	}
+	if (expected != shards[0].total_frames) {
+		std::stringstream ss;
+		ss << "shards do not cover frames [" << expected << ", " << shards[0].total_frames << ")";
+		error = ss.str();
+		return false;
+	}
+	return true;
+}
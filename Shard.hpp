@@ -0,0 +1,32 @@
+#ifndef __SHARD_HPP__
+#define __SHARD_HPP__
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Result of counting the frame range [begin, end) of a timelapse.
+ *
+ * count holds only the line crossings between frames in the range (and the frame before begin).
+ * The tomatoes already in range at frame 0 and the ones left at the last frame are
+ * added when the shards are merged, from first and last of the outermost shards.
+ */
+struct ShardState {
+	std::size_t begin = 0;
+	std::size_t end = 0;
+	std::size_t total_frames = 0;
+	int width = 0;
+	int height = 0;
+	std::size_t count = 0;
+	std::vector<cv::Rect> first;
+	std::vector<cv::Rect> last;
+};
+
+bool writeShard(const std::string& filename, const ShardState& state);
+bool readShard(const std::string& filename, ShardState& state);
+
+/**
+ * Sorts shards by begin and checks that they cover [0, total_frames) without gaps or overlaps.
+ */
+bool checkShardCoverage(std::vector<ShardState>& shards, std::string& error);
+#endif
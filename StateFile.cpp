@@ -0,0 +1,36 @@
+#include "StateFile.hpp"
+#include <boost/filesystem.hpp>
+
+void writeRects(std::ostream& os, const std::string& name, const std::vector<cv::Rect>& rects) {
+	os << name << " " << rects.size() << "\n";
+	for (const auto& r : rects) {
+		os << r.x << " " << r.y << " " << r.width << " " << r.height << "\n";
+	}
+}
+
+bool readRects(std::istream& is, const std::string& name, std::vector<cv::Rect>& rects) {
+	std::string key;
+	std::size_t size = 0;
+	if (!(is >> key >> size) || key != name) {
+		return false;
+	}
+	rects.resize(size);
+	for (auto& r : rects) {
+		if (!(is >> r.x >> r.y >> r.width >> r.height)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool replaceFile(const std::string& temp, const std::string& filename) {
+	namespace bf = boost::filesystem;
+	boost::system::error_code ec;
+	bf::rename(temp, filename, ec);
+	if (ec) {
+		boost::system::error_code ignored;
+		bf::remove(temp, ignored);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#ifndef __STATE_FILE_HPP__
+#define __STATE_FILE_HPP__
+#include <string>
+#include <vector>
+#include <iostream>
+#include <opencv2/core.hpp>
+
+/**
+ * Writes rects as a "name size" line followed by one "x y width height" line per rect.
+ */
+void writeRects(std::ostream& os, const std::string& name, const std::vector<cv::Rect>& rects);
+
+/**
+ * Reads rects written by writeRects; fails if the name differs.
+ */
+bool readRects(std::istream& is, const std::string& name, std::vector<cv::Rect>& rects);
+
+/**
+ * Moves temp over filename in one step, so a reader sees either the old or the new file.
+ * temp is removed if the move fails.
+ */
+bool replaceFile(const std::string& temp, const std::string& filename);
+#endif
@@ -0,0 +1,88 @@
+#include "StatusServer.hpp"
+#include <sstream>
+#include <iostream>
+
+StatusServer::StatusServer(const BodyFunc& body)
+	:body_(body), acceptor_(io_service_) {
+}
+
+StatusServer::~StatusServer() {
+	this->stop();
+}
+
+bool StatusServer::start(unsigned short port) {
+	boost::system::error_code error;
+	const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+	this->acceptor_.open(endpoint.protocol(), error);
+	if (!error) {
+		this->acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), error);
+	}
+	if (!error) {
+		this->acceptor_.bind(endpoint, error);
+	}
+	if (!error) {
+		this->acceptor_.listen(boost::asio::socket_base::max_connections, error);
+	}
+	if (error) {
+		std::cerr << "ERROR: status server: " << error.message() << std::endl;
+		return false;
+	}
+	this->accept();
+	this->thread_ = boost::thread([this]() { this->io_service_.run(); });
+	return true;
+}
+
+void StatusServer::stop() {
+	this->io_service_.stop();
+	if (this->thread_.joinable()) {
+		this->thread_.join();
+	}
+	boost::system::error_code error;
+	this->acceptor_.close(error);
+}
+
+void StatusServer::accept() {
+	auto socket = std::make_shared<boost::asio::ip::tcp::socket>(this->io_service_);
+	this->acceptor_.async_accept(*socket, [this, socket](const boost::system::error_code& error) {
+		if (error) {
+			return;
+		}
+		auto request = std::make_shared<boost::asio::streambuf>();
+		boost::asio::async_read_until(*socket, *request, "\r\n\r\n",
+			[this, socket, request](const boost::system::error_code& error, std::size_t) {
+				if (!error) {
+					this->respond(socket, request);
+				}
+			});
+		this->accept();
+	});
+}
+
+void StatusServer::respond(std::shared_ptr<boost::asio::ip::tcp::socket> socket, std::shared_ptr<boost::asio::streambuf> request) {
+	std::istream request_stream(request.get());
+	std::string method, target;
+	request_stream >> method >> target;
+	std::string status = "200 OK";
+	std::string body;
+	if (method != "GET") {
+		status = "405 Method Not Allowed";
+	}
+	else if (target == "/" || target == "/status" || target == "/status.json") {
+		body = this->body_();
+	}
+	else {
+		status = "404 Not Found";
+	}
+	std::stringstream ss;
+	ss << "HTTP/1.1 " << status << "\r\n"
+		<< "Content-Type: application/json\r\n"
+		<< "Content-Length: " << body.size() << "\r\n"
+		<< "Connection: close\r\n\r\n"
+		<< body;
+	auto response = std::make_shared<std::string>(ss.str());
+	boost::asio::async_write(*socket, boost::asio::buffer(*response),
+		[socket, response](const boost::system::error_code&, std::size_t) {
+			boost::system::error_code ignored;
+			socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+		});
+}
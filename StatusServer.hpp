@@ -0,0 +1,36 @@
+#ifndef __STATUS_SERVER_HPP__
+#define __STATUS_SERVER_HPP__
+#include <string>
+#include <memory>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+/**
+ * Minimal HTTP endpoint on the loopback interface.
+ *
+ * Every GET of /, /status or /status.json is answered with the JSON document returned by the body function,
+ * which is called on the server thread for each request.
+ */
+class StatusServer {
+public:
+	typedef std::function<std::string()> BodyFunc;
+private:
+	BodyFunc body_;
+	boost::asio::io_service io_service_;
+	boost::asio::ip::tcp::acceptor acceptor_;
+	boost::thread thread_;
+	void accept();
+	void respond(std::shared_ptr<boost::asio::ip::tcp::socket> socket, std::shared_ptr<boost::asio::streambuf> request);
+public:
+	explicit StatusServer(const BodyFunc& body);
+	~StatusServer();
+
+	/**
+	 * Starts listening on 127.0.0.1:port.
+	 * \return false if the port can not be bound
+	 */
+	bool start(unsigned short port);
+	void stop();
+};
+#endif
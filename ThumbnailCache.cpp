@@ -0,0 +1,206 @@
+#include "ThumbnailCache.hpp"
+#include <ctime>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "TimeLapse.hpp"
+#include "FrameIndex.hpp"
+
+ThumbnailCache::ThumbnailCache(const cv::Size& size)
+	:size_(size) {
+}
+
+ThumbnailCache::~ThumbnailCache() {
+	this->close();
+}
+
+boost::filesystem::path ThumbnailCache::cachePath(const boost::filesystem::path& input) {
+	auto index_path = FrameIndex::indexPath(input);
+	return index_path.replace_extension(".thumbs");
+}
+
+bool ThumbnailCache::open(const std::string& input, std::size_t threads) {
+	namespace bf = boost::filesystem;
+	this->close();
+	TimeLapse lapse;
+	cv::Mat first;
+	if (!lapse.open(input) || !lapse.read(0, first)) {
+		return false;
+	}
+	this->input_ = input;
+	this->frame_size_ = first.size();
+	this->total_ = lapse.totalFrames();
+	this->cache_path_ = ThumbnailCache::cachePath(input);
+	boost::system::error_code cache_error, input_error;
+	const std::time_t cache_mtime = bf::last_write_time(this->cache_path_, cache_error);
+	const std::time_t input_mtime = bf::last_write_time(input, input_error);
+	cv::Mat thumbnail;
+	// mtimes have 1 second resolution, so a cache from the second the input changed is not trusted
+	if (!cache_error && !input_error && cache_mtime > input_mtime
+		&& this->archive_.open(this->cache_path_.string())
+		&& this->archive_.size() == this->total_
+		&& this->archive_.read(0, thumbnail, cv::IMREAD_COLOR)
+		&& thumbnail.size() == this->size_) {
+		return true;
+	}
+	this->archive_.close();
+	// the largest JPEG reduction that still decodes at least the thumbnail size
+	this->decode_scale_ = 1;
+	while (this->decode_scale_ < 8
+		&& first.cols / (this->decode_scale_ * 2) >= this->size_.width
+		&& first.rows / (this->decode_scale_ * 2) >= this->size_.height) {
+		this->decode_scale_ *= 2;
+	}
+	this->encoded_.assign(this->total_, std::vector<unsigned char>());
+	this->claimed_.assign(this->total_, 0);
+	this->ready_.assign(this->total_, 0);
+	this->ready_count_ = 0;
+	this->next_ = 0;
+	this->stopping_ = false;
+	this->input_mtime_ = input_error ? 0 : input_mtime;
+	this->build_time_ = std::time(nullptr);
+	if (threads == 0) {
+		threads = std::max(1u, boost::thread::hardware_concurrency());
+	}
+	this->threads_ = threads;
+	this->failed_ = 0;
+	for (std::size_t i = 0; i < threads; ++i) {
+		this->workers_.create_thread(boost::bind(&ThumbnailCache::work, this));
+	}
+	return true;
+}
+
+void ThumbnailCache::close() {
+	{
+		boost::mutex::scoped_lock l(this->mutex_);
+		this->stopping_ = true;
+	}
+	this->ready_cond_.notify_all();
+	this->workers_.join_all();
+	this->archive_.close();
+	this->encoded_.clear();
+	this->claimed_.clear();
+	this->ready_.clear();
+	this->total_ = 0;
+}
+
+std::size_t ThumbnailCache::size()const {
+	return this->total_;
+}
+
+const cv::Size& ThumbnailCache::frameSize()const {
+	return this->frame_size_;
+}
+
+bool ThumbnailCache::isComplete() {
+	boost::mutex::scoped_lock l(this->mutex_);
+	return this->archive_.size() > 0 || (this->total_ > 0 && this->ready_count_ == this->total_);
+}
+
+bool ThumbnailCache::claim(std::size_t& frame) {
+	boost::mutex::scoped_lock l(this->mutex_);
+	if (this->stopping_) {
+		return false;
+	}
+	// first unclaimed frame from the playhead on, then from the beginning
+	for (std::size_t i = 0; i < this->total_; ++i) {
+		const std::size_t candidate = (this->next_ + i) % this->total_;
+		if (!this->claimed_[candidate]) {
+			this->claimed_[candidate] = 1;
+			this->next_ = candidate + 1;
+			frame = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThumbnailCache::work() {
+	TimeLapse lapse;
+	if (!lapse.open(this->input_) || !lapse.setDecodeScale(this->decode_scale_)) {
+		{
+			boost::mutex::scoped_lock l(this->mutex_);
+			this->failed_++;
+		}
+		this->ready_cond_.notify_all();
+		return;
+	}
+	cv::Mat image, thumbnail;
+	std::vector<unsigned char> buf;
+	const std::vector<int> params{ cv::IMWRITE_JPEG_QUALITY, 90 };
+	std::size_t frame;
+	while (this->claim(frame)) {
+		buf.clear();
+		if (lapse.read(frame, image)) {
+			cv::resize(image, thumbnail, this->size_, 0, 0, cv::INTER_AREA);
+		}
+		else {
+			thumbnail = cv::Mat::zeros(this->size_, CV_8UC3);
+		}
+		cv::imencode(".jpg", thumbnail, buf, params);
+		bool complete;
+		{
+			boost::mutex::scoped_lock l(this->mutex_);
+			this->encoded_[frame].swap(buf);
+			this->ready_[frame] = 1;
+			this->ready_count_++;
+			complete = this->ready_count_ == this->total_;
+		}
+		this->ready_cond_.notify_all();
+		if (complete) {
+			this->save();
+		}
+	}
+}
+
+bool ThumbnailCache::save() {
+	namespace bf = boost::filesystem;
+	// An input modified during the second the build started could have changed without changing its mtime.
+	if (this->input_mtime_ >= this->build_time_) {
+		return false;
+	}
+	const bf::path tmp_path = this->cache_path_.string() + ".tmp";
+	FrameArchiveWriter writer;
+	if (!writer.open(tmp_path.string())) {
+		return false;
+	}
+	// every thumbnail is ready and nothing writes encoded_ any more
+	for (const auto& encoded : this->encoded_) {
+		if (!writer.append(encoded.data(), encoded.size())) {
+			writer.close();
+			bf::remove(tmp_path);
+			return false;
+		}
+	}
+	if (!writer.close()) {
+		bf::remove(tmp_path);
+		return false;
+	}
+	boost::system::error_code error;
+	bf::rename(tmp_path, this->cache_path_, error);
+	return !error;
+}
+
+bool ThumbnailCache::get(std::size_t frame, cv::Mat& thumbnail) {
+	if (frame >= this->total_) {
+		return false;
+	}
+	if (this->archive_.size() > 0) {
+		return this->archive_.read(frame, thumbnail, cv::IMREAD_COLOR);
+	}
+	boost::mutex::scoped_lock l(this->mutex_);
+	if (!this->ready_[frame] && !this->claimed_[frame]) {
+		this->next_ = frame;
+	}
+	while (!this->ready_[frame] && !this->stopping_ && this->failed_ < this->threads_) {
+		this->ready_cond_.wait(l);
+	}
+	if (!this->ready_[frame]) {
+		return false;
+	}
+	// a ready thumbnail is never written again, so it can be decoded without the lock
+	const std::vector<unsigned char>& encoded = this->encoded_[frame];
+	l.unlock();
+	thumbnail = cv::imdecode(encoded, cv::IMREAD_COLOR);
+	return !thumbnail.empty();
+}
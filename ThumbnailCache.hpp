@@ -0,0 +1,76 @@
+#ifndef __THUMBNAIL_CACHE_HPP__
+#define __THUMBNAIL_CACHE_HPP__
+#include <ctime>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <opencv2/core.hpp>
+#include "FrameArchive.hpp"
+
+/**
+ * Fixed-size thumbnails of every frame of a timelapse.
+ *
+ * The thumbnails are stored as a frame archive of JPEGs next to the input ("<input>.thumbs")
+ * and mmapped when the input has not changed since, so revisiting a sequence decodes nothing
+ * at full resolution. Otherwise worker threads build them in the background with reduced
+ * JPEG decoding, starting at the frame last asked for, and the archive is written once all are done.
+ */
+class ThumbnailCache {
+private:
+	cv::Size size_;
+	cv::Size frame_size_;
+	std::string input_;
+	boost::filesystem::path cache_path_;
+	int decode_scale_ = 1;
+	std::size_t total_ = 0;
+	/** input mtime and wall clock second when the build started */
+	std::time_t input_mtime_ = 0;
+	std::time_t build_time_ = 0;
+	FrameArchive archive_;
+	boost::mutex mutex_;
+	boost::condition_variable ready_cond_;
+	std::vector<std::vector<unsigned char>> encoded_;
+	std::vector<char> claimed_;
+	std::vector<char> ready_;
+	std::size_t ready_count_ = 0;
+	std::size_t next_ = 0;
+	bool stopping_ = false;
+	std::size_t threads_ = 0;
+	/** workers that could not open the input */
+	std::size_t failed_ = 0;
+	boost::thread_group workers_;
+	bool claim(std::size_t& frame);
+	void work();
+	bool save();
+public:
+	ThumbnailCache(const cv::Size& size = cv::Size(500, 500));
+	~ThumbnailCache();
+
+	static boost::filesystem::path cachePath(const boost::filesystem::path& input);
+
+	/**
+	 * Maps a valid cache of input or starts building one with threads workers (0: hardware threads).
+	 */
+	bool open(const std::string& input, std::size_t threads = 0);
+	void close();
+	std::size_t size()const;
+
+	/**
+	 * Full-resolution size of the frames.
+	 */
+	const cv::Size& frameSize()const;
+
+	/**
+	 * Returns true once every thumbnail is available.
+	 */
+	bool isComplete();
+
+	/**
+	 * Decodes the thumbnail of frame, waiting for it if it is not built yet.
+	 * The workers continue from this frame, so the frames after the playhead come first.
+	 * Returns false if no worker could open the input.
+	 */
+	bool get(std::size_t frame, cv::Mat& thumbnail);
+};
+#endif
@@ -3,6 +3,7 @@
 #include <string>
 #include <boost/filesystem.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include "DecodeScale.hpp"
 
 TimeLapse::TimeLapse(){
 }
@@ -16,41 +17,56 @@ TimeLapse::~TimeLapse(){
 }
 
 bool TimeLapse::open(const std::string& dirname){
-	using namespace boost::filesystem;
-	auto dirpath = path(dirname);
-	if (!is_directory(dirpath)) {
-		return false;
-	}
-	frame_paths_.clear();
-	for (const auto& file : directory_iterator(dirpath)) {
-		if (is_regular(file)) {
-			this->frame_paths_.push_back(file);
-		}
+	this->frames_.close();
+	this->archive_.close();
+	this->video_.close();
+	if (boost::filesystem::is_regular_file(dirname) && FrameArchive::isArchive(dirname)) {
+		return this->archive_.open(dirname);
 	}
-	if (this->frame_paths_.empty()) {
-		return false;
+	if (boost::filesystem::is_regular_file(dirname) && VideoSource::isVideo(dirname)) {
+		return this->video_.open(dirname, this->video_backend_);
 	}
-	std::sort(this->frame_paths_.begin(), this->frame_paths_.end());
-	return true;
+	return this->frames_.open(boost::filesystem::path(dirname));
 }
 
 bool TimeLapse::isOpened()const{
-	return this->frame_paths_.size() > current_frame_;
+	return this->totalFrames() > current_frame_;
+}
+
+int TimeLapse::imreadFlags()const {
+	return ::reducedColorFlag(this->decode_scale_);
+}
+
+bool TimeLapse::readFrame(const std::size_t& frame, cv::Mat& image)const {
+	if (this->archive_.size() > 0) {
+		return this->archive_.read(frame, image, this->imreadFlags());
+	}
+	if (this->video_.size() > 0) {
+		return this->video_.read(frame, image, this->decode_scale_);
+	}
+	image = cv::imread(this->frames_.path(frame).string(), this->imreadFlags());
+	return !image.empty();
 }
 
 bool TimeLapse::read(cv::Mat& image){
-	image = cv::imread(this->frame_paths_[this->current_frame_].string());
+	bool result = this->readFrame(this->current_frame_, image);
 	this->current_frame_++;
-	return !image.empty();
+	return result;
 }
 
 bool TimeLapse::read(const std::size_t& frame, cv::Mat& image) {
-	image = cv::imread(this->frame_paths_[frame].string());
-	return !image.empty();
+	return this->readFrame(frame, image);
 }
 
 std::size_t TimeLapse::totalFrames()const {
-	return this->frame_paths_.size();
+	if (this->archive_.size() > 0) {
+		return this->archive_.size();
+	}
+	return this->video_.size() > 0 ? this->video_.size() : this->frames_.size();
+}
+
+double TimeLapse::frameRate()const {
+	return this->video_.size() > 0 ? this->video_.frameRate() : 0.0;
 }
 
 std::size_t TimeLapse::currentFrame()const {
@@ -60,3 +76,19 @@ std::size_t TimeLapse::currentFrame()const {
 void TimeLapse::setCurrentFrame(const std::size_t& value) {
 	this->current_frame_ = value;
 }
+
+bool TimeLapse::setDecodeScale(int scale) {
+	if (!::isValidDecodeScale(scale)) {
+		return false;
+	}
+	this->decode_scale_ = scale;
+	return true;
+}
+
+int TimeLapse::decodeScale()const {
+	return this->decode_scale_;
+}
+
+void TimeLapse::setVideoBackend(VideoSource::Backend backend) {
+	this->video_backend_ = backend;
+}
@@ -4,10 +4,20 @@
 #include <vector>
 #include <boost/filesystem.hpp>
 #include <opencv2/core.hpp>
+#include "FrameIndex.hpp"
+#include "FrameArchive.hpp"
+#include "VideoSource.hpp"
 class TimeLapse {
 private:
-	std::vector<boost::filesystem::path> frame_paths_;
+	FrameIndex frames_;
+	FrameArchive archive_;
+	// fR[_̈ʒu͌̏Ԃł͂Ȃ̂ŁAconstreadFrame
+	mutable VideoSource video_;
+	VideoSource::Backend video_backend_ = VideoSource::OPENCV;
 	std::size_t current_frame_ = 0;
+	int decode_scale_ = 1;
+	int imreadFlags()const;
+	bool readFrame(const std::size_t& frame, cv::Mat& image)const;
 public:
 	/**
 	 * RXgN^BĂȂ
@@ -27,7 +37,11 @@ public:
 
 	/**
 	* fBNgw肵āÃfBNgJ܂
-	* \param[in] dirname JfBNg
+	* t[ꗗ "<dirname>.frameindex" ɃLbVA񂩂̓fBNg𑖍܂
+	* packōA[JCut@Cw肵ꍇ́AmmapĊJ܂
+	* t@C(.avi, .mp4Ȃ)w肵ꍇ́AsetVideoBackendőI񂾕@ŏɃfR[h܂
+	* L[t[ꗗ "<t@C>.keyindex" ɃLbVAV[N͂s܂
+	* \param[in] dirname JfBNg܂̓A[JCut@C
 	*/
 	bool open(const std::string& dirname);
 
@@ -60,6 +74,11 @@ public:
 	 */
 	std::size_t totalFrames()const;
 
+	/**
+	 * t@C̃t[[gB摜̘AԂA[JCuA[gȂȂ0
+	 */
+	double frameRate()const;
+
 	/**
 	 *  >> Iy[^ɂēǂݏo
 	 * ݂̃t[ԍ
@@ -70,5 +89,24 @@ public:
 	 *  >> Iy[^ɂēǂ݂ԍύX܂B
 	 */
 	void setCurrentFrame(const std::size_t& value);
+
+	/**
+	 * t[1/scalẻ𑜓xŃfR[h悤ɐݒ肵܂B
+	 * JPEG̏ꍇ̓fR[_DCTXP[OĝŁAt𑜓xŃfR[h葬ł
+	 * \param[in] scale 1, 2, 4, 8̂ꂩ
+	 * \return scalesȂfalseԂAݒ͕ύX܂
+	 */
+	bool setDecodeScale(int scale);
+
+	/**
+	 * ݂̃fR[hkB1Ȃt𑜓x
+	 */
+	int decodeScale()const;
+
+	/**
+	 * t@C̃fR[h@ݒ肵܂BopenLł
+	 * \param[in] backend OPENCVȂcv::VideoCaptureAFFMPEGȂffmpegvZXpCvŐ̃t[ǂ݂܂
+	 */
+	void setVideoBackend(VideoSource::Backend backend);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "VideoSource.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+#include <opencv2/imgproc.hpp>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace {
+	/** without an index, gaps shorter than this are decoded through instead of seeking */
+	const std::size_t SEQUENTIAL_LIMIT = 64;
+}
+
+VideoSource::VideoSource() {
+}
+
+VideoSource::~VideoSource() {
+	this->close();
+}
+
+bool VideoSource::isVideo(const std::string& filename) {
+	static const char* const EXTENSIONS[] = {
+		".avi", ".mp4", ".m4v", ".mov", ".mkv", ".webm", ".ts", ".mts", ".mjpeg", ".mjpg", ".h264", ".264", ".h265", ".265"
+	};
+	const std::string extension = boost::algorithm::to_lower_copy(boost::filesystem::path(filename).extension().string());
+	return std::find(std::begin(EXTENSIONS), std::end(EXTENSIONS), extension) != std::end(EXTENSIONS);
+}
+
+bool VideoSource::open(const std::string& filename, Backend backend) {
+	this->close();
+	this->filename_ = filename;
+	this->backend_ = backend;
+	this->has_index_ = this->index_.open(filename);
+	if (backend == FFMPEG) {
+		if (!this->has_index_) {
+			return false;
+		}
+		this->frame_count_ = this->index_.frameCount();
+		this->frame_rate_ = this->index_.fps();
+		this->buffer_.resize(static_cast<std::size_t>(this->index_.width()) * this->index_.height() * 3);
+		return this->frame_count_ > 0;
+	}
+	if (!this->capture_.open(filename)) {
+		return false;
+	}
+	this->frame_count_ = this->has_index_
+		? this->index_.frameCount()
+		: static_cast<std::size_t>(std::max(0.0, this->capture_.get(cv::CAP_PROP_FRAME_COUNT)));
+	this->frame_rate_ = this->has_index_ && this->index_.fps() > 0
+		? this->index_.fps()
+		: std::max(0.0, this->capture_.get(cv::CAP_PROP_FPS));
+	this->next_ = 0;
+	this->is_started_ = true;
+	return this->frame_count_ > 0;
+}
+
+void VideoSource::close() {
+	this->stopPipe();
+	this->capture_.release();
+	this->index_.close();
+	this->has_index_ = false;
+	this->frame_count_ = 0;
+	this->frame_rate_ = 0.0;
+	this->next_ = 0;
+	this->is_started_ = false;
+}
+
+std::size_t VideoSource::size()const {
+	return this->frame_count_;
+}
+
+double VideoSource::frameRate()const {
+	return this->frame_rate_;
+}
+
+bool VideoSource::startPipe(const std::size_t& key) {
+	this->stopPipe();
+	std::ostringstream command;
+	command << "ffmpeg -v error -nostdin";
+	if (this->index_.keyFrame(key) > 0) {
+		// half a frame past the keyframe, so the demuxer lands on it and not on the one before
+		const double fps = this->index_.fps() > 0 ? this->index_.fps() : 25.0;
+		command << " -noaccurate_seek -ss " << std::fixed << std::setprecision(6) << this->index_.keyTime(key) + 0.5 / fps;
+	}
+	// frames come in the coded size the keyframe index was built with, not rotated by the display matrix
+	command << " -noautorotate -i " << ::shellQuote(this->filename_) << " -map 0:v:0 -vsync 0 -f rawvideo -pix_fmt bgr24 -";
+#ifdef _WIN32
+	this->pipe_ = popen(command.str().c_str(), "rb");
+#else
+	this->pipe_ = popen(command.str().c_str(), "r");
+#endif
+	this->next_ = this->index_.keyFrame(key);
+	this->is_started_ = this->pipe_ != nullptr;
+	return this->is_started_;
+}
+
+void VideoSource::stopPipe() {
+	if (this->pipe_ != nullptr) {
+		// ffmpeg exits on the broken pipe
+		pclose(this->pipe_);
+		this->pipe_ = nullptr;
+	}
+}
+
+bool VideoSource::seek(const std::size_t& frame) {
+	if (this->has_index_) {
+		const std::size_t key = this->index_.keyBefore(frame);
+		const std::size_t key_frame = this->index_.keyFrame(key);
+		if (this->is_started_ && this->next_ <= frame && this->next_ >= key_frame) {
+			return true;
+		}
+		if (this->backend_ == FFMPEG) {
+			return this->startPipe(key);
+		}
+		this->capture_.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(key_frame));
+		this->next_ = key_frame;
+		this->is_started_ = true;
+		return true;
+	}
+	if (this->is_started_ && this->next_ <= frame && frame - this->next_ < SEQUENTIAL_LIMIT) {
+		return true;
+	}
+	this->capture_.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(frame));
+	this->next_ = frame;
+	this->is_started_ = true;
+	return true;
+}
+
+bool VideoSource::skip() {
+	const bool result = this->backend_ == FFMPEG
+		? std::fread(this->buffer_.data(), 1, this->buffer_.size(), this->pipe_) == this->buffer_.size()
+		: this->capture_.grab();
+	this->next_++;
+	return result;
+}
+
+bool VideoSource::decode(cv::Mat& image) {
+	bool result;
+	if (this->backend_ == FFMPEG) {
+		result = std::fread(this->buffer_.data(), 1, this->buffer_.size(), this->pipe_) == this->buffer_.size();
+		image = cv::Mat(this->index_.height(), this->index_.width(), CV_8UC3, this->buffer_.data());
+	}
+	else {
+		result = this->capture_.read(image);
+	}
+	this->next_++;
+	return result && !image.empty();
+}
+
+bool VideoSource::read(const std::size_t& frame, cv::Mat& image, int decode_scale) {
+	cv::Mat decoded;
+	image.release();
+	if (frame >= this->frame_count_ || !this->seek(frame)) {
+		return false;
+	}
+	while (this->next_ < frame) {
+		if (!this->skip()) {
+			this->is_started_ = false;
+			return false;
+		}
+	}
+	if (!this->decode(decoded)) {
+		this->is_started_ = false;
+		return false;
+	}
+	if (decode_scale > 1) {
+		cv::resize(decoded, image, cv::Size(), 1.0 / decode_scale, 1.0 / decode_scale, cv::INTER_AREA);
+	}
+	else {
+		// the pipe buffer is reused by the next frame
+		image = this->backend_ == FFMPEG ? decoded.clone() : decoded;
+	}
+	return true;
+}
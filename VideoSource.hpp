@@ -0,0 +1,74 @@
+#ifndef __VIDEO_SOURCE_HPP__
+#define __VIDEO_SOURCE_HPP__
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include "KeyframeIndex.hpp"
+
+/**
+ * Frames of a video file, decoded in order by cv::VideoCapture or read as raw BGR
+ * from an ffmpeg process through a pipe. Nothing is written to disk but the keyframe index.
+ *
+ * Reading the next frame only decodes it. A read elsewhere seeks to the last keyframe
+ * at or before the frame and decodes forward, unless the decoder already is between
+ * that keyframe and the frame.
+ */
+class VideoSource {
+public:
+	enum Backend {
+		OPENCV,
+		FFMPEG
+	};
+private:
+	Backend backend_ = OPENCV;
+	std::string filename_;
+	KeyframeIndex index_;
+	bool has_index_ = false;
+	std::size_t frame_count_ = 0;
+	double frame_rate_ = 0.0;
+	cv::VideoCapture capture_;
+	FILE* pipe_ = nullptr;
+	std::vector<unsigned char> buffer_;
+	/** frame the decoder returns next */
+	std::size_t next_ = 0;
+	bool is_started_ = false;
+
+	bool seek(const std::size_t& frame);
+	bool startPipe(const std::size_t& key);
+	void stopPipe();
+	bool skip();
+	bool decode(cv::Mat& image);
+public:
+	VideoSource();
+	~VideoSource();
+	VideoSource(const VideoSource&) = delete;
+	VideoSource& operator=(const VideoSource&) = delete;
+
+	/**
+	 * Returns true if filename has the extension of a video container or stream.
+	 */
+	static bool isVideo(const std::string& filename);
+
+	/**
+	 * Opens filename and its keyframe index.
+	 * FFMPEG needs ffmpeg and ffprobe on the PATH. OPENCV works without ffprobe,
+	 * but then seeks with CAP_PROP_POS_FRAMES, which is slow and not exact for every codec.
+	 * FFMPEG returns frames in their coded orientation; the rotation metadata of the stream is ignored.
+	 */
+	bool open(const std::string& filename, Backend backend);
+	void close();
+	std::size_t size()const;
+
+	/**
+	 * Frames per second of the stream, 0 if the container does not tell.
+	 */
+	double frameRate()const;
+
+	/**
+	 * Decodes frame and shrinks it to 1/decode_scale.
+	 */
+	bool read(const std::size_t& frame, cv::Mat& image, int decode_scale);
+};
+#endif
@@ -0,0 +1,129 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+
+namespace {
+	// worker identity of the calling thread, so submit() can push to its own deque
+	thread_local const WorkStealingPool* current_pool = nullptr;
+	thread_local std::size_t current_index = 0;
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t threads) {
+	if (threads == 0) {
+		threads = std::max(1u, boost::thread::hardware_concurrency());
+	}
+	for (std::size_t i = 0; i < threads; ++i) {
+		this->queues_.emplace_back(new Queue);
+	}
+	for (std::size_t i = 0; i < threads; ++i) {
+		this->threads_.create_thread(boost::bind(&WorkStealingPool::work, this, i));
+	}
+}
+
+WorkStealingPool::~WorkStealingPool() {
+	this->stop();
+}
+
+void WorkStealingPool::submit(const Task& task) {
+	{
+		boost::mutex::scoped_lock l(this->mutex_);
+		if (this->stopping_) {
+			return;
+		}
+		const std::size_t index = current_pool == this
+			? current_index
+			: this->next_queue_++ % this->queues_.size();
+		// pushed under mutex_ so queued_ never counts a task a worker has already taken
+		boost::mutex::scoped_lock ql(this->queues_[index]->mutex);
+		this->queues_[index]->tasks.push_back(task);
+		this->queued_++;
+		this->pending_++;
+	}
+	this->work_cond_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+	boost::mutex::scoped_lock l(this->mutex_);
+	while (this->pending_ > 0 && !this->stopping_) {
+		this->done_cond_.wait(l);
+	}
+	if (this->error_) {
+		std::exception_ptr error;
+		std::swap(error, this->error_);
+		std::rethrow_exception(error);
+	}
+}
+
+void WorkStealingPool::stop() {
+	{
+		boost::mutex::scoped_lock l(this->mutex_);
+		this->stopping_ = true;
+	}
+	this->work_cond_.notify_all();
+	this->done_cond_.notify_all();
+	this->threads_.join_all();
+}
+
+std::size_t WorkStealingPool::threadCount()const {
+	return this->queues_.size();
+}
+
+bool WorkStealingPool::pop(std::size_t index, Task& task) {
+	Queue& queue = *this->queues_[index];
+	boost::mutex::scoped_lock l(queue.mutex);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::steal(std::size_t index, Task& task) {
+	for (std::size_t i = 1; i < this->queues_.size(); ++i) {
+		Queue& queue = *this->queues_[(index + i) % this->queues_.size()];
+		boost::mutex::scoped_lock l(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::work(std::size_t index) {
+	current_pool = this;
+	current_index = index;
+	while (true) {
+		{
+			boost::mutex::scoped_lock l(this->mutex_);
+			while (this->queued_ == 0 && !this->stopping_) {
+				this->work_cond_.wait(l);
+			}
+			if (this->stopping_) {
+				return;
+			}
+			// claim a task before taking it, so idle workers sleep instead of racing for it
+			this->queued_--;
+		}
+		Task task;
+		// a claimed task is in some deque, but another worker may take it first and leave a different one
+		while (!this->pop(index, task) && !this->steal(index, task)) {
+			boost::this_thread::yield();
+		}
+		std::exception_ptr error;
+		try {
+			task();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		boost::mutex::scoped_lock l(this->mutex_);
+		if (error && !this->error_) {
+			this->error_ = error;
+		}
+		if (--this->pending_ == 0) {
+			this->done_cond_.notify_all();
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef __WORK_STEALING_POOL_HPP__
+#define __WORK_STEALING_POOL_HPP__
+#include <deque>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <boost/thread.hpp>
+
+/**
+ * Fixed-size thread pool where every worker owns a task deque.
+ *
+ * A task submitted from a worker goes to the back of that worker's deque and the worker
+ * takes its own work from the back, so a task that resubmits itself stays on the same thread.
+ * An idle worker steals from the front of the other deques.
+ * A task that throws still counts as finished; the first exception is rethrown by wait().
+ */
+class WorkStealingPool {
+public:
+	typedef std::function<void()> Task;
+private:
+	struct Queue {
+		boost::mutex mutex;
+		std::deque<Task> tasks;
+	};
+	std::vector<std::unique_ptr<Queue>> queues_;
+	boost::thread_group threads_;
+	boost::mutex mutex_;
+	boost::condition_variable work_cond_;
+	boost::condition_variable done_cond_;
+	std::size_t queued_ = 0;
+	std::size_t pending_ = 0;
+	std::size_t next_queue_ = 0;
+	bool stopping_ = false;
+	std::exception_ptr error_;
+	bool pop(std::size_t index, Task& task);
+	bool steal(std::size_t index, Task& task);
+	void work(std::size_t index);
+public:
+	/**
+	 * \param[in] threads number of workers; 0 uses the number of hardware threads
+	 */
+	explicit WorkStealingPool(std::size_t threads = 0);
+	~WorkStealingPool();
+
+	void submit(const Task& task);
+
+	/**
+	 * Blocks until every submitted task, including the ones they submit, has finished.
+	 * Rethrows the first exception a task threw since the last wait.
+	 */
+	void wait();
+
+	/**
+	 * Stops the workers. Tasks that have not started are dropped.
+	 */
+	void stop();
+	std::size_t threadCount()const;
+};
+#endif
@@ -0,0 +1,44 @@
+# Runs main on a synthetic timelapse and checks the count against the ground truth written by synth.
+#
+#   cmake -DMAIN=<main> -DINPUT=<dir> -DTRUTH=<file> [-DARGS=<main options>] [-DTOLERANCE=<n>] [-DMIN_FPS=<fps>] -P CheckCount.cmake
+
+if(NOT DEFINED TOLERANCE)
+    set(TOLERANCE 0)
+endif()
+if(NOT DEFINED MIN_FPS)
+    set(MIN_FPS 0)
+endif()
+separate_arguments(ARGS)
+
+execute_process(
+    COMMAND ${MAIN} -i ${INPUT} ${ARGS}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "main failed (${result}):\n${output}\n${error}")
+endif()
+
+file(READ ${TRUTH} truth)
+string(REGEX MATCH "count ([0-9]+)" _ "${truth}")
+set(expected ${CMAKE_MATCH_1})
+string(REGEX MATCH "TOMATO: ([0-9]+)" _ "${output}")
+set(actual ${CMAKE_MATCH_1})
+if("${actual}" STREQUAL "")
+    message(FATAL_ERROR "main printed no count:\n${output}")
+endif()
+
+math(EXPR diff "${actual} - ${expected}")
+if(diff LESS 0)
+    math(EXPR diff "-${diff}")
+endif()
+if(diff GREATER TOLERANCE)
+    message(FATAL_ERROR "count ${actual}, expected ${expected} (tolerance ${TOLERANCE})")
+endif()
+
+string(REGEX MATCH "FPS: ([0-9.e+]+)" _ "${error}")
+set(fps ${CMAKE_MATCH_1})
+if("${fps}" STREQUAL "" OR fps LESS MIN_FPS)
+    message(FATAL_ERROR "throughput ${fps} fps is below ${MIN_FPS} fps")
+endif()
+message(STATUS "count ${actual}/${expected}, ${fps} fps")
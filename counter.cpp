@@ -1,7 +1,49 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include "TimeLapse.hpp"
+#include "ThumbnailCache.hpp"
+#include "CountEventLog.hpp"
+
+/**
+ * Annotation state shared with the mouse callback.
+ */
+struct Annotation {
+	std::size_t frame = 0;
+	std::size_t count = 0;
+	cv::Size frame_size;
+	cv::Size thumbnail_size;
+	CountEventLog* events = nullptr;
+
+	void record(int x, int y, bool increment) {
+		if (increment) {
+			this->count++;
+		}
+		else if (this->count > 0) {
+			this->count--;
+		}
+		CountEvent event;
+		event.frame = this->frame;
+		// the annotation is about the frame, not about when it was clicked
+		event.timestamp = static_cast<double>(this->frame);
+		event.x = x;
+		event.y = y;
+		event.line = CountEvent::MANUAL;
+		event.total = this->count;
+		this->events->write(event);
+	}
+};
+
+void onMouse(int event, int x, int y, int, void* userdata) {
+	auto& annotation = *static_cast<Annotation*>(userdata);
+	if (event != cv::EVENT_LBUTTONDOWN) {
+		return;
+	}
+	// clicked tomatoes are logged in full-resolution coordinates like the counts of main
+	annotation.record(
+		x * annotation.frame_size.width / annotation.thumbnail_size.width,
+		y * annotation.frame_size.height / annotation.thumbnail_size.height,
+		true);
+}
 
 int main(int argc, char** argv) {
 	namespace bp = boost::program_options;
@@ -9,7 +51,11 @@ int main(int argc, char** argv) {
 	bp::options_description general_opt("Genral Options");
 	general_opt.add_options()
 		("help,h", "Show help")
-		("input,i", bp::value<bf::path>()->required(), "Input directory");
+		("input,i", bp::value<bf::path>()->required(), "Input directory")
+		("events", bp::value<std::string>()->default_value("-"), "Count event log (frame, timestamp, clicked position, total per change); - for stdout")
+		("event-format", bp::value<std::string>()->default_value("csv"), "Count event log format: csv or binary")
+		("thumbnail-size", bp::value<int>()->default_value(500), "Width and height of the shown thumbnails")
+		("threads,j", bp::value<std::size_t>()->default_value(0), "Thumbnail worker threads (0: number of hardware threads)");
 	bp::variables_map map;
 	try {
 		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
@@ -22,31 +68,84 @@ int main(int argc, char** argv) {
 	}
 	if (map.count("help")) {
 		std::cout << general_opt << std::endl;
+		std::cout << "Keys: w/click +1, s -1, space play/pause, d/a step, D/A jump 100 frames, 1-9 playback stride, q quit" << std::endl;
 	}
 	auto input_path = map["input"].as<bf::path>();
-	TimeLapse lapce;
-	lapce.open(input_path.string());
-	cv::Mat frame;
+	const int thumbnail_size = map["thumbnail-size"].as<int>();
+	ThumbnailCache cache(cv::Size(thumbnail_size, thumbnail_size));
+	if (!cache.open(input_path.string(), map["threads"].as<std::size_t>())) {
+		std::cerr << "ERROR: can not open " << input_path << std::endl;
+		return -1;
+	}
+	const std::string event_format = map["event-format"].as<std::string>();
+	if (event_format != "csv" && event_format != "binary") {
+		std::cerr << "ERROR: event-format must be csv or binary" << std::endl;
+		return -1;
+	}
+	CountEventLog events;
+	if (!events.open(map["events"].as<std::string>(), event_format == "binary" ? CountEventLog::BINARY : CountEventLog::CSV)) {
+		std::cerr << "ERROR: can not open event log " << map["events"].as<std::string>() << std::endl;
+		return -1;
+	}
+	Annotation annotation;
+	annotation.frame_size = cache.frameSize();
+	annotation.thumbnail_size = cv::Size(thumbnail_size, thumbnail_size);
+	annotation.events = &events;
 	cv::namedWindow("FRAME");
-	std::size_t count = 0;
-	while (lapce.isOpened()) {
-		lapce >> frame;
-		cv::resize(frame, frame, cv::Size(500, 500));
+	cv::setMouseCallback("FRAME", ::onMouse, &annotation);
+	const std::size_t last = cache.size() - 1;
+	cv::Mat frame;
+	bool playing = true;
+	std::size_t mul = 1;
+	while (true) {
+		if (!cache.get(annotation.frame, frame)) {
+			std::cerr << "ERROR: can not read frame " << annotation.frame << " of " << input_path << std::endl;
+			return -1;
+		}
+		std::stringstream ss;
+		ss << annotation.frame << "/" << last << "  " << annotation.count << (cache.isComplete() ? "" : "  (caching)");
+		cv::putText(frame, ss.str(), cv::Point(10, 25), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
 		cv::imshow("FRAME", frame);
-		auto key = cv::waitKey(33);
+		// thumbnails are cheap, so playback runs as fast as the display and scrubbing keys repeat freely
+		auto key = cv::waitKey(playing ? 1 : 0);
 		if (key == 'q') {
 			break;
 		}
 		if (key == 'w') {
-			count++;
-			std::cout << count << std::endl;
+			annotation.record(-1, -1, true);
 		}
 		else if (key == 's') {
-			count--;
-			std::cout << count << std::endl;
+			annotation.record(-1, -1, false);
+		}
+		else if (key == ' ') {
+			playing = !playing;
+		}
+		else if (key == 'd') {
+			playing = false;
+			annotation.frame = std::min(annotation.frame + 1, last);
+		}
+		else if (key == 'a') {
+			playing = false;
+			annotation.frame = annotation.frame > 0 ? annotation.frame - 1 : 0;
+		}
+		else if (key == 'D') {
+			annotation.frame = std::min(annotation.frame + 100, last);
+		}
+		else if (key == 'A') {
+			annotation.frame = annotation.frame > 100 ? annotation.frame - 100 : 0;
+		}
+		else if ('1' <= key && key <= '9') {
+			mul = key - '0';
+		}
+		events.flushIfDue();
+		if (playing) {
+			if (annotation.frame == last) {
+				playing = false;
+			}
+			annotation.frame = std::min(annotation.frame + mul, last);
 		}
 	}
-	std::cout << "TOMATO: " << count << std::endl;
-	cv::waitKey();
+	events.close();
+	std::cout << "TOMATO: " << annotation.count << std::endl;
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,224 @@
+#include <csignal>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <sstream>
+#include <iostream>
+#include <opencv2/core.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include "CountingSession.hpp"
+#include "WorkStealingPool.hpp"
+#include "StatusServer.hpp"
+
+namespace {
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void onSignal(int) {
+		interrupted = 1;
+	}
+
+	std::string jsonString(const std::string& value) {
+		std::string escaped = "\"";
+		for (char c : value) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped + "\"";
+	}
+}
+
+/**
+ * Sessions waiting for a stream image; the main thread puts them back into the pool.
+ */
+class IdleSessions {
+private:
+	boost::mutex mutex_;
+	std::vector<std::shared_ptr<CountingSession>> sessions_;
+public:
+	void push(const std::shared_ptr<CountingSession>& session) {
+		boost::mutex::scoped_lock l(this->mutex_);
+		this->sessions_.push_back(session);
+	}
+	std::vector<std::shared_ptr<CountingSession>> take() {
+		boost::mutex::scoped_lock l(this->mutex_);
+		std::vector<std::shared_ptr<CountingSession>> sessions;
+		sessions.swap(this->sessions_);
+		return sessions;
+	}
+};
+
+/**
+ * Runs one frame of the session and schedules the next one,
+ * so each session has at most one frame in flight and its tracker sees frames in order.
+ * A session whose frame throws ends in the "error" state.
+ */
+void schedule(WorkStealingPool& pool, const std::shared_ptr<CountingSession>& session, IdleSessions& idle) {
+	pool.submit([&pool, session, &idle]() {
+		CountingSession::StepResult result = CountingSession::FINISHED;
+		try {
+			result = session->step();
+		}
+		catch (const std::exception& e) {
+			// the pool keeps task exceptions for wait(), which the daemon never calls
+			std::cerr << "ERROR: " << session->name() << ": " << e.what() << std::endl;
+			session->publish("error");
+		}
+		switch (result) {
+		case CountingSession::FRAME:
+			::schedule(pool, session, idle);
+			break;
+		case CountingSession::IDLE:
+			idle.push(session);
+			break;
+		case CountingSession::FINISHED:
+			break;
+		}
+	});
+}
+
+std::string statusJson(const std::vector<std::shared_ptr<CountingSession>>& sessions) {
+	std::stringstream ss;
+	ss << "{\"sessions\":[";
+	for (std::size_t i = 0; i < sessions.size(); ++i) {
+		const SessionStatus status = sessions[i]->status();
+		ss << (i == 0 ? "" : ",")
+			<< "{\"name\":" << ::jsonString(status.name)
+			<< ",\"source\":" << ::jsonString(status.source)
+			<< ",\"state\":" << ::jsonString(status.state)
+			<< ",\"frames\":" << status.frames
+			<< ",\"count\":" << status.count
+			<< ",\"fps\":" << status.fps
+			<< "}";
+	}
+	ss << "]}";
+	return ss.str();
+}
+
+/**
+ * Splits host[:port][/file] of an MJPEG stream.
+ */
+bool parseStream(const std::string& spec, std::string& host, std::string& port, std::string& file) {
+	const std::size_t slash = spec.find('/');
+	const std::string authority = spec.substr(0, slash);
+	file = slash == std::string::npos ? "" : spec.substr(slash + 1);
+	const std::size_t colon = authority.find(':');
+	host = authority.substr(0, colon);
+	port = colon == std::string::npos ? "80" : authority.substr(colon + 1);
+	return !host.empty() && !port.empty();
+}
+
+int main(int argc, char** argv) {
+	namespace bp = boost::program_options;
+	namespace bf = boost::filesystem;
+	bp::options_description general_opt("Allowed Options");
+	general_opt.add_options()
+		("help,h", "Show help")
+		("timelapse,i", bp::value<std::vector<bf::path>>()->multitoken(), "Timelapse directories or archives, one session each")
+		("mjpeg", bp::value<std::vector<std::string>>()->multitoken(), "MJPEG streams as host[:port][/file], one session each")
+		("threads,j", bp::value<std::size_t>()->default_value(0), "Worker threads (0: number of hardware threads)")
+		("port,p", bp::value<unsigned short>()->default_value(8080), "Status endpoint port on 127.0.0.1 (0: disabled)")
+		("exit-when-done", "Exit when every session has finished instead of serving the status until interrupted")
+		("decode-scale,s", bp::value<int>()->default_value(1), "Decode frames at 1/N resolution (1, 2, 4 or 8)")
+		("segmenter", bp::value<std::string>()->default_value("hls"), "Segmentation configuration: hls or ver1")
+		("geometry,g", bp::value<bf::path>(), "Counting lines and range (cv::FileStorage); default: two lines 30 degrees above the horizontal")
+		("tracker", bp::value<std::string>()->default_value("nearest"), "nearest: nearest neighbour of the previous frame, rotational / velocity: motion-model tracker (for streams that drop frames)");
+	bp::variables_map map;
+	try {
+		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
+		bp::notify(map);
+	}
+	catch (const bp::error& e) {
+		std::cerr << "ERROR:" << e.what() << std::endl;
+		std::cout << general_opt << std::endl;
+		return -1;
+	}
+	if (map.count("help")) {
+		std::cout << general_opt << std::endl;
+		return 0;
+	}
+	FruitsCounterConfig config;
+	config.segmenter = map["segmenter"].as<std::string>();
+	config.decode_scale = map["decode-scale"].as<int>();
+	if (map.count("geometry")) {
+		config.geometry = map["geometry"].as<bf::path>().string();
+	}
+	config.tracker = map["tracker"].as<std::string>();
+	std::string config_error;
+	if (!FruitsCounter().configure(config, config_error)) {
+		std::cerr << "ERROR: " << config_error << std::endl;
+		return -1;
+	}
+
+	std::vector<std::shared_ptr<CountingSession>> sessions;
+	if (map.count("timelapse")) {
+		for (const auto& path : map["timelapse"].as<std::vector<bf::path>>()) {
+			auto session = std::make_shared<CountingSession>(path.filename().string(), config);
+			if (!session->openTimeLapse(path.string())) {
+				std::cerr << "ERROR: can not open " << path << std::endl;
+			}
+			sessions.push_back(session);
+		}
+	}
+	if (map.count("mjpeg")) {
+		for (const auto& spec : map["mjpeg"].as<std::vector<std::string>>()) {
+			std::string host, port, file;
+			auto session = std::make_shared<CountingSession>(spec, config);
+			if (!::parseStream(spec, host, port, file) || !session->openStream(host, file, port)) {
+				std::cerr << "ERROR: can not connect to " << spec << std::endl;
+			}
+			sessions.push_back(session);
+		}
+	}
+	if (sessions.empty()) {
+		std::cerr << "ERROR: You must be set 'timelapse' or 'mjpeg' option!!." << std::endl;
+		return -1;
+	}
+
+	StatusServer server([&sessions]() { return ::statusJson(sessions); });
+	const unsigned short port = map["port"].as<unsigned short>();
+	if (port != 0 && !server.start(port)) {
+		return -1;
+	}
+	std::signal(SIGINT, ::onSignal);
+	std::signal(SIGTERM, ::onSignal);
+
+	const int64 start_tick = cv::getTickCount();
+	WorkStealingPool pool(map["threads"].as<std::size_t>());
+	IdleSessions idle;
+	for (const auto& session : sessions) {
+		if (session->status().state == "running") {
+			::schedule(pool, session, idle);
+		}
+	}
+	const bool exit_when_done = map.count("exit-when-done") > 0;
+	while (!interrupted) {
+		// streams without a new image are retried here instead of spinning on a worker
+		for (const auto& session : idle.take()) {
+			::schedule(pool, session, idle);
+		}
+		bool running = false;
+		for (const auto& session : sessions) {
+			running = running || session->status().state == "running";
+		}
+		if (!running && exit_when_done) {
+			break;
+		}
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+	}
+	pool.stop();
+	server.stop();
+
+	std::size_t frames = 0;
+	for (const auto& session : sessions) {
+		const SessionStatus status = session->status();
+		frames += status.frames;
+		std::cout << status.name << " TOMATO: " << status.count << std::endl;
+	}
+	const double elapsed = (cv::getTickCount() - start_tick) / cv::getTickFrequency();
+	std::cerr << "FPS: " << (elapsed > 0 ? frames / elapsed : 0.0) << std::endl;
+	return 0;
+}
@@ -4,33 +4,49 @@
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include "HogUtil.hpp"
+#include "HogModel.hpp"
+#include "FastHog.hpp"
+#include "CropDataset.hpp"
 
-void get_svm_detector(const cv::Ptr<cv::ml::SVM>& svm, std::vector< float > & hog_detector)
-{
-	cv::Mat sv = svm->getSupportVectors();
-	const int sv_total = sv.rows;
-	// get the decision function
-	cv::Mat alpha, svidx;
-	double rho = svm->getDecisionFunction(0, alpha, svidx);
-	CV_Assert(alpha.total() == 1 && svidx.total() == 1 && sv_total == 1);
-	CV_Assert((alpha.type() == CV_64F && alpha.at<double>(0) == 1.) ||
-		(alpha.type() == CV_32F && alpha.at<float>(0) == 1.f));
-	CV_Assert(sv.type() == CV_32F);
-	hog_detector.clear();
-	hog_detector.resize(sv.cols + 1);
-	memcpy(&hog_detector[0], sv.ptr(), sv.cols*sizeof(hog_detector[0]));
-	hog_detector[sv.cols] = (float)-rho;
-}
-
-void detect(const boost::filesystem::path& input, const boost::filesystem::path& cascade, const boost::filesystem::path& output) {
-	auto detector = getDefaultHOGDescriptor();
-	cv::Ptr<cv::ml::SVM> svm = cv::ml::SVM::load<cv::ml::SVM>(cascade.string());
-	std::vector<float> hog_detector;
-	::get_svm_detector(svm, hog_detector);
-	detector.setSVMDetector(hog_detector);
+/**
+ * \param[in] dataset if open, the detections are appended to it instead of written to output
+ */
+void detect(const boost::filesystem::path& input, const boost::filesystem::path& cascade, const boost::filesystem::path& output, bool use_opencv, CropDatasetWriter& dataset, bool use_dataset, int label) {
+	cv::HOGDescriptor detector;
+	HogModel model;
+	if (HogModel::isModel(cascade.string())) {
+		if (!model.open(cascade.string())) {
+			std::cerr << "ERROR: broken HOG model " << cascade << std::endl;
+			return;
+		}
+		detector = model.descriptor();
+	}
+	else {
+		detector = getDefaultHOGDescriptor();
+		cv::Ptr<cv::ml::SVM> svm = cv::ml::SVM::load<cv::ml::SVM>(cascade.string());
+		std::vector<float> hog_detector;
+		::get_svm_detector(svm, hog_detector);
+		detector.setSVMDetector(hog_detector);
+	}
 	auto frame = cv::imread(input.string());
 	std::vector<cv::Rect> rects;
-	detector.detectMultiScale(frame, rects);
+	FastHog fast;
+	if (!use_opencv && FastHog::isSupported(detector) && fast.setSVMDetector(detector.svmDetector)) {
+		fast.detectMultiScale(frame, rects);
+	}
+	else {
+		detector.detectMultiScale(frame, rects);
+	}
+	if (use_dataset) {
+		if (!dataset.beginSource(boost::filesystem::absolute(input).string())) {
+			std::cerr << "ERROR: can not write detections of " << input << std::endl;
+			return;
+		}
+		for (const auto& rect : rects) {
+			dataset.append(frame, rect & cv::Rect(0, 0, frame.cols, frame.rows), label);
+		}
+		return;
+	}
 	std::size_t index = 0;
 	for (const auto& rect : rects) {
 		std::stringstream ss;
@@ -50,8 +66,11 @@ int main(int argc, char** argv) {
 	general_opt.add_options()
 		("help,h", "Show help")
 		("input,i", bp::value<bf::path>(), "Input image path.")
-		("cascade,c", bp::value<bf::path>(), "Cascade file(.yaml format)")
-		("output,o", bp::value<bf::path>(), "Output directory.");
+		("cascade,c", bp::value<bf::path>(), "Cascade file (.hogmodel written by train, or .yaml SVM)")
+		("output,o", bp::value<bf::path>(), "Output directory.")
+		("opencv", "Detect with cv::HOGDescriptor instead of the specialized HOG engine.")
+		("dataset,d", bp::value<bf::path>(), "Crop dataset to append the detections to instead of writing images to the output directory.")
+		("label,l", bp::value<int>()->default_value(0), "Label stored with the detections in the dataset (1: positive, -1: negative, 0: not labeled).");
 	bp::variables_map map;
 	try {
 		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
@@ -64,8 +83,24 @@ int main(int argc, char** argv) {
 	if (map.count("help")) {
 		std::cout << general_opt;
 	}
-	if (map.count("input") && map.count("output") && map.count("cascade")) {
-		::detect(map["input"].as<bf::path>(), map["cascade"].as<bf::path>(), map["output"].as<bf::path>());
+	if (map.count("input") && (map.count("output") || map.count("dataset")) && map.count("cascade")) {
+		CropDatasetWriter dataset;
+		if (map.count("dataset") && !dataset.open(map["dataset"].as<bf::path>().string(), ::getHOGWinSize())) {
+			std::cerr << "ERROR: can not open " << map["dataset"].as<bf::path>() << std::endl;
+			return -1;
+		}
+		::detect(
+			map["input"].as<bf::path>(),
+			map["cascade"].as<bf::path>(),
+			map.count("output") ? map["output"].as<bf::path>() : bf::path(),
+			map.count("opencv") > 0,
+			dataset,
+			map.count("dataset") > 0,
+			map["label"].as<int>());
+		if (map.count("dataset") && !dataset.close()) {
+			std::cerr << "ERROR: can not write " << map["dataset"].as<bf::path>() << std::endl;
+			return -1;
+		}
 	}
 	else {
 		std::cerr << "ERROR: You must be set 'input' and 'output' options!!." << std::endl;
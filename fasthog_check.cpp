@@ -0,0 +1,139 @@
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "HogUtil.hpp"
+#include "FastHog.hpp"
+
+namespace {
+	typedef std::pair<std::vector<int>, double> Window;
+
+	/**
+	 * Windows sorted by rectangle; the order detectMultiScale returns the levels in is not fixed.
+	 */
+	std::vector<Window> sortWindows(const std::vector<cv::Rect>& found, const std::vector<double>& scores) {
+		std::vector<Window> windows;
+		for (std::size_t i = 0; i < found.size(); ++i) {
+			const cv::Rect& r = found[i];
+			windows.push_back(Window({ r.x, r.y, r.width, r.height }, scores[i]));
+		}
+		std::sort(windows.begin(), windows.end());
+		return windows;
+	}
+}
+
+/**
+ * Compares FastHog with cv::HOGDescriptor on one image:
+ * every window descriptor of compute, and every window and score of detectMultiScale.
+ */
+int main(int argc, char** argv) {
+	namespace bp = boost::program_options;
+	namespace bf = boost::filesystem;
+	bp::options_description general_opt("Allowed Options");
+	general_opt.add_options()
+		("help,h", "Show help")
+		("input,i", bp::value<bf::path>(), "Image to compare on (default: a generated texture)")
+		("width", bp::value<int>()->default_value(420), "Width of the generated texture")
+		("height", bp::value<int>()->default_value(300), "Height of the generated texture")
+		("seed", bp::value<int>()->default_value(1), "Seed of the generated texture and detector")
+		("gray", "Convert the image to 1 channel")
+		("tolerance", bp::value<double>()->default_value(1e-4), "Largest difference allowed in a descriptor element or a score")
+		("threads,j", bp::value<std::size_t>()->default_value(0), "Threads of FastHog (0: number of hardware threads)");
+	bp::variables_map map;
+	try {
+		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
+		bp::notify(map);
+	}
+	catch (const bp::error& e) {
+		std::cerr << "ERROR:" << e.what() << std::endl;
+		std::cout << general_opt << std::endl;
+		return -1;
+	}
+	if (map.count("help")) {
+		std::cout << general_opt << std::endl;
+		return 0;
+	}
+	cv::RNG rng(map["seed"].as<int>());
+	cv::Mat img;
+	if (map.count("input")) {
+		img = cv::imread(map["input"].as<bf::path>().string());
+		if (img.empty()) {
+			std::cerr << "ERROR: can not read " << map["input"].as<bf::path>() << std::endl;
+			return -1;
+		}
+	}
+	else {
+		img.create(map["height"].as<int>(), map["width"].as<int>(), CV_8UC3);
+		rng.fill(img, cv::RNG::UNIFORM, 0, 256);
+		cv::GaussianBlur(img, img, cv::Size(5, 5), 0);
+	}
+	if (map.count("gray") && img.channels() == 3) {
+		cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
+	}
+	const double tolerance = map["tolerance"].as<double>();
+
+	cv::HOGDescriptor hog = ::getDefaultHOGDescriptor();
+	FastHog fast(map["threads"].as<std::size_t>());
+	if (!FastHog::isSupported(hog)) {
+		std::cerr << "ERROR: FastHog does not support the default HOG descriptor" << std::endl;
+		return -1;
+	}
+	bool ok = true;
+
+	std::vector<float> expected, actual;
+	hog.compute(img, expected, cv::Size(FastHog::CELL_SIZE, FastHog::CELL_SIZE), cv::Size(0, 0));
+	fast.compute(img, actual);
+	double descriptor_error = 0.0;
+	if (expected.size() != actual.size()) {
+		std::cerr << "ERROR: compute returned " << actual.size() << " values, OpenCV " << expected.size() << std::endl;
+		ok = false;
+	}
+	else {
+		for (std::size_t i = 0; i < expected.size(); ++i) {
+			descriptor_error = std::max(descriptor_error, static_cast<double>(std::abs(expected[i] - actual[i])));
+		}
+	}
+	std::cout << "DESCRIPTOR ERROR: " << descriptor_error << std::endl;
+
+	// a random detector and no threshold or grouping, so every window of every level is compared
+	std::vector<float> detector(FastHog::DESCRIPTOR_SIZE + 1);
+	for (auto& w : detector) {
+		w = static_cast<float>(rng.gaussian(0.02));
+	}
+	hog.setSVMDetector(detector);
+	fast.setSVMDetector(detector);
+	const double hit_threshold = -1e9;
+	std::vector<cv::Rect> expected_found, actual_found;
+	std::vector<double> expected_scores, actual_scores;
+	hog.detectMultiScale(img, expected_found, expected_scores, hit_threshold, cv::Size(), cv::Size(), 1.05, 0);
+	fast.detectMultiScale(img, actual_found, actual_scores, hit_threshold, 1.05, 0);
+	const auto expected_windows = ::sortWindows(expected_found, expected_scores);
+	const auto actual_windows = ::sortWindows(actual_found, actual_scores);
+	double score_error = 0.0;
+	if (expected_windows.size() != actual_windows.size()) {
+		std::cerr << "ERROR: detectMultiScale found " << actual_windows.size() << " windows, OpenCV " << expected_windows.size() << std::endl;
+		ok = false;
+	}
+	else {
+		for (std::size_t i = 0; i < expected_windows.size(); ++i) {
+			if (expected_windows[i].first != actual_windows[i].first) {
+				std::cerr << "ERROR: detectMultiScale window " << i << " differs from OpenCV" << std::endl;
+				ok = false;
+				break;
+			}
+			score_error = std::max(score_error, std::abs(expected_windows[i].second - actual_windows[i].second));
+		}
+	}
+	std::cout << "WINDOWS: " << actual_windows.size() << std::endl;
+	std::cout << "SCORE ERROR: " << score_error << std::endl;
+
+	if (descriptor_error > tolerance || score_error > tolerance) {
+		std::cerr << "ERROR: FastHog differs from OpenCV by more than " << tolerance << std::endl;
+		ok = false;
+	}
+	return ok ? 0 : -1;
+}
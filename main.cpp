@@ -1,40 +1,19 @@
 #include <vector>
 #include <map>
 #include <cmath>
+#include <memory>
 #include <sstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include "TimeLapse.hpp"
-#include "TomatoInformation.hpp"
+#include "Shard.hpp"
+#include "AdaptiveStride.hpp"
+#include "FruitsCounter.hpp"
+#include "CountEventLog.hpp"
+#include "Checkpoint.hpp"
 //#define USE_SHOW
 
-typedef cv::Vec3b Pixel;
-
-double tomatoProb(const Pixel& pixel) {
-	/*  Pixel tomato_color = Pixel(0, 0, 255);
-	double tomato_variance = 0.1;
-	return std::exp(-cv::norm(pixel, tomato_color) / 255.0 / std::sqrt(3) * 2.0);
-	*/
-	return std::exp(
-			(
-				(std::abs(static_cast<double>(pixel[0]) - 90.0) / 90.0 - 1.0)
-				- std::abs(static_cast<double>(pixel[1]) - 128.0) / 128.0
-				- (255.0 - static_cast<double>(pixel[2])) / 255.0
-			) / 3.0
-		);
-}
-
-void calcTomatoProbability(const cv::Mat& img, cv::Mat& dst) {
-	typedef cv::Point3_<uint8_t> Pixel;
-	dst.create(img.size(), CV_64FC1);
-	cv::Mat_<Pixel> pixmat;
-	cv::cvtColor(img, pixmat, cv::COLOR_BGR2HLS);
-	pixmat.forEach([&](Pixel& pix, const int location[2]) ->void {
-		dst.at<double>(location[0], location[1]) = ::tomatoProb(pix);
-	});
-}
-
 void resizeAndShow(cv::Mat& frame, const std::string& name, const cv::Size& size = cv::Size(300, 300)) {
 	cv::resize(frame, frame, size);
 	cv::imshow(name, frame);
@@ -45,96 +24,71 @@ cv::Point rect2point(const cv::Rect& rect) {
 	return cv::Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
 }
 
-template<typename Functor, typename IsInRangeFunctor>
-std::size_t countTomato(const std::vector<std::vector<cv::Rect>>& tomatos, const Functor& func, const IsInRangeFunctor& inrange) {
-	auto previous_tomato_frame = tomatos[0];
-	std::size_t count = 0;
-	for (const auto& tomato : previous_tomato_frame) {
-		if (inrange(::rect2point(tomato))) {
-			count++;
-		}
+bool makeCountingGeometry(const boost::program_options::variables_map& map, const cv::Size& size, double line_rad, CountingGeometry& geometry) {
+	if (map.count("geometry")) {
+		return CountingGeometry::load(map["geometry"].as<boost::filesystem::path>().string(), size, geometry);
 	}
-	for (std::size_t i = 1; i < tomatos.size(); ++i) {
-		if (tomatos[i].empty())
-			continue;
-		for (const auto& cur : tomatos[i]) 
-		{
-			double min_dist = std::numeric_limits<double>::infinity();
-			std::size_t min_dist_index = 0;
-			for (std::size_t index = 0; index < previous_tomato_frame.size(); ++index) {
-				const auto& pre = previous_tomato_frame[index];
-				double distance = std::sqrt(
-					std::pow(cur.x + cur.width * 0.5 - (pre.x + pre.width * 0.5), 2)
-					+ std::pow(cur.y + cur.height * 0.5 - (pre.y + pre.height * 0.5), 2)
-					);
-				if (min_dist > distance) {
-					min_dist = distance;
-					min_dist_index = index;
-				}
-			}
-			if (!std::isinf(min_dist))
-			{
-				if (func(::rect2point(cur), ::rect2point(previous_tomato_frame[min_dist_index])))
-				{
-					std::cout << ::rect2point(cur) << ::rect2point(previous_tomato_frame[min_dist_index]) << std::endl;
-					count++;
-				}
-			}
+	geometry = CountingGeometry::radial(size, line_rad);
+	return true;
+}
+
+/**
+ * Options the count depends on, so a checkpoint is only resumed by the same run.
+ * end is left out on purpose: a run stopped early can be resumed to the end.
+ */
+std::string checkpointConfig(const boost::program_options::variables_map& map, const FruitsCounterConfig& config) {
+	std::stringstream ss;
+	ss << "input " << boost::filesystem::absolute(map["input"].as<boost::filesystem::path>()).string() << "\n"
+		<< "video-backend " << map["video-backend"].as<std::string>() << "\n"
+		<< "segmenter " << config.segmenter << "\n"
+		<< "decode-scale " << config.decode_scale << "\n"
+		<< "tracker " << config.tracker << "\n"
+		<< "geometry " << config.geometry << "\n"
+		<< "line-rad " << config.line_rad << "\n"
+		<< "begin " << map["begin"].as<std::size_t>() << " " << map["overlap"].as<std::size_t>() << "\n"
+		<< "stride " << map["stride"].as<std::size_t>() << " " << map.count("adaptive-stride") << " "
+		<< map["max-stride"].as<std::size_t>() << " " << map["static-threshold"].as<double>() << " " << map["static-pixels"].as<int>() << " "
+		<< map["near-line-distance"].as<double>() << "\n"
+		<< "events " << map["events"].as<std::string>() << " " << map["event-format"].as<std::string>() << " " << config.frame_rate << "\n";
+	return ss.str();
+}
+
+int mergeShards(const std::vector<boost::filesystem::path>& files, const boost::program_options::variables_map& map, double line_rad) {
+	std::vector<ShardState> shards;
+	for (const auto& file : files) {
+		ShardState shard;
+		if (!::readShard(file.string(), shard)) {
+			std::cerr << "ERROR: can not read shard " << file << std::endl;
+			return -1;
 		}
-		previous_tomato_frame = tomatos[i];
+		shards.push_back(std::move(shard));
 	}
-	for (const auto& tomato : previous_tomato_frame) {
-		if (!inrange(::rect2point(tomato))) {
-			count++;
-		}
+	std::string error;
+	if (!::checkShardCoverage(shards, error)) {
+		std::cerr << "ERROR: " << error << std::endl;
+		return -1;
 	}
-	return count;
-}
-
-template<typename COUNTUP_FUNC>
-std::size_t getIncrementalTomato(const std::vector<cv::Rect>& previous_tomato, const std::vector<cv::Rect>& current_tomato, const COUNTUP_FUNC& coutup_func) {
-	if (previous_tomato.empty() || current_tomato.empty()) {
-		return 0;
+	CountingGeometry geometry;
+	if (!::makeCountingGeometry(map, cv::Size(shards[0].width, shards[0].height), line_rad, geometry)) {
+		std::cerr << "ERROR: can not read counting geometry" << std::endl;
+		return -1;
 	}
-	std::size_t count = 0;
-	for (const auto& cur : current_tomato) {
-		double min_dist = std::numeric_limits<double>::infinity();
-		std::size_t min_dist_index = 0;
-		for (std::size_t i = 0; i < previous_tomato.size(); ++i) {
-			const auto& pre = previous_tomato[i];
-			const auto& pre_pos = ::rect2point(pre);
-			const auto& cur_pos = ::rect2point(cur);
-			double distance = std::sqrt(std::pow(pre_pos.x - cur_pos.x, 2) + std::pow(pre_pos.y - cur_pos.y, 2));
-			if (min_dist > distance) {
-				min_dist = distance;
-				min_dist_index = i;
-			}
+	std::size_t tomato_count = 0;
+	for (const auto& cur : shards.front().first) {
+		if (geometry.isInRange(::rect2point(cur))) {
+			tomato_count++;
 		}
-		if (!std::isinf(min_dist))
-		{
-			if (coutup_func(::rect2point(cur), ::rect2point(previous_tomato[min_dist_index]))) {
-				count++;
-			}
+	}
+	for (const auto& shard : shards) {
+		tomato_count += shard.count;
+	}
+	for (const auto& cur : shards.back().last) {
+		if (!geometry.isInRange(::rect2point(cur))) {
+			tomato_count++;
 		}
 	}
-	return count;
-}
-
-int side(const std::pair<cv::Point, cv::Point>& seg1, const cv::Point& pos)
-{
-	cv::Vec3d v1 = cv::Vec3d((seg1.second - seg1.first).x, (seg1.second - seg1.first).y, 0);
-	cv::Vec3d v2 = cv::Vec3d((pos - seg1.first).x, (pos - seg1.first).y, 0);
-	return v1.cross(v2)[2] > 0 ? 1 : -1;
-}
-
-bool isCross(const std::pair<cv::Point, cv::Point>& seg1, const std::pair<cv::Point, cv::Point>& seg2)
-{
-	return side(seg1, seg2.first) * side(seg1, seg2.second) < 0
-		&& side(seg2, seg1.first) * side(seg2, seg1.second) < 0;
-}
-
-double distance(const cv::Point& a, const cv::Point& b) {
-	return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2));
+	std::cout << "TOMATO: " << tomato_count << std::endl;
+	return 0;
 }
 
 int main(int argc, char** argv) {
@@ -143,8 +97,41 @@ int main(int argc, char** argv) {
 	bp::options_description general_opt("Genral Options");
 	general_opt.add_options()
 		("help,h", "Show help")
-		("input,i", bp::value<bf::path>()->required(), "Input directory")
-		("output,o", bp::value<bf::path>(), "Output directory");
+		("input,i", bp::value<bf::path>(), "Input directory, frame archive or video file")
+		("video-backend", bp::value<std::string>()->default_value("opencv"), "Video decoder: opencv (cv::VideoCapture) or ffmpeg (raw frames piped from an ffmpeg process)")
+		("output,o", bp::value<bf::path>(), "Output directory")
+		("decode-scale,s", bp::value<int>()->default_value(1), "Decode frames at 1/N resolution (1, 2, 4 or 8)")
+		("change-tolerance", bp::value<int>()->default_value(-1), "Reuse the segmentation of 64x64 tiles where no channel changed by more than N (-1: segment every frame in full)")
+		("segment-threads", bp::value<std::size_t>()->default_value(1), "Segment each frame in horizontal bands on N threads (0: number of hardware threads)")
+		("segmenter", bp::value<std::string>()->default_value("hls"), "Segmentation configuration: hls or ver1")
+		("geometry,g", bp::value<bf::path>(), "Counting lines and range (cv::FileStorage); default: two lines 30 degrees above the horizontal")
+		("tracker", bp::value<std::string>()->default_value("nearest"), "nearest: nearest neighbour of the previous frame, rotational / velocity: motion-model tracker")
+		("events", bp::value<std::string>()->default_value("-"), "Count event log (frame, timestamp, position, line, total per counted tomato); - for stdout")
+		("event-format", bp::value<std::string>()->default_value("csv"), "Count event log format: csv or binary")
+		("frame-rate", bp::value<double>()->default_value(0.0), "Frames per second of the input for the event timestamps (0: the rate of a video file, the frame index otherwise)");
+	bp::options_description stride_opt("Adaptive Stride Options");
+	stride_opt.add_options()
+		("stride", bp::value<std::size_t>()->default_value(1), "Process every N-th frame (use with a motion-model tracker)")
+		("adaptive-stride", "Skip static frames and frames without anything near the counting lines (needs a motion-model tracker)")
+		("max-stride", bp::value<std::size_t>()->default_value(8), "Largest number of frames to advance at once")
+		("static-threshold", bp::value<double>()->default_value(8.0), "Difference (0-255) above which a pixel of the 64x64 thumbnail changed")
+		("static-pixels", bp::value<int>()->default_value(1), "Changed thumbnail pixels from which a frame is not static")
+		("near-line-distance", bp::value<double>()->default_value(150.0), "Distance in pixels from a counting line at which the stride drops to 1");
+	general_opt.add(stride_opt);
+	bp::options_description shard_opt("Shard Options");
+	shard_opt.add_options()
+		("begin", bp::value<std::size_t>()->default_value(0), "First frame of the shard")
+		("end", bp::value<std::size_t>(), "Frame after the last frame of the shard (default: all frames)")
+		("overlap", bp::value<std::size_t>()->default_value(1), "Frames processed before begin to restore the tracker")
+		("shard-output", bp::value<bf::path>(), "Write the partial count and boundary detections of [begin, end) to this file")
+		("merge", bp::value<std::vector<bf::path>>()->multitoken(), "Merge shard files into the total count");
+	general_opt.add(shard_opt);
+	bp::options_description checkpoint_opt("Checkpoint Options");
+	checkpoint_opt.add_options()
+		("checkpoint", bp::value<bf::path>(), "Save the frame position and tracker state to this file periodically and when the run ends")
+		("checkpoint-interval", bp::value<double>()->default_value(60.0), "Seconds between checkpoints")
+		("resume", "Continue from the checkpoint file if it exists; the final count is the same as without the restart");
+	general_opt.add(checkpoint_opt);
 	bp::variables_map map;
 	try {
 		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
@@ -158,17 +145,153 @@ int main(int argc, char** argv) {
 	if (map.count("help")) {
 		std::cout << general_opt << std::endl;
 	}
+	const double line_rad = 30.0 / 180.0 * 3.1415926535;
+	if (map.count("merge")) {
+		return ::mergeShards(map["merge"].as<std::vector<bf::path>>(), map, line_rad);
+	}
+	if (!map.count("input")) {
+		std::cerr << "ERROR: You must be set 'input' option!!." << std::endl;
+		std::cout << general_opt << std::endl;
+		return -1;
+	}
 	auto input_path = map["input"].as<bf::path>();
+	const std::string video_backend = map["video-backend"].as<std::string>();
+	if (video_backend != "opencv" && video_backend != "ffmpeg") {
+		std::cerr << "ERROR: video-backend must be opencv or ffmpeg" << std::endl;
+		return -1;
+	}
 	TimeLapse lapce;
+	lapce.setVideoBackend(video_backend == "ffmpeg" ? VideoSource::FFMPEG : VideoSource::OPENCV);
 	lapce.open(input_path.string());
+	if (!lapce.setDecodeScale(map["decode-scale"].as<int>())) {
+		std::cerr << "ERROR: decode-scale must be 1, 2, 4 or 8" << std::endl;
+		return -1;
+	}
+	// Segmentation runs on the reduced frame, so kernels shrink with it.
+	// Detections come back from the counter in full-resolution units.
+	const int decode_scale = lapce.decodeScale();
+	const std::string tracker_name = map["tracker"].as<std::string>();
+	if (tracker_name != "nearest" && tracker_name != "rotational" && tracker_name != "velocity") {
+		std::cerr << "ERROR: tracker must be nearest, rotational or velocity" << std::endl;
+		return -1;
+	}
 	cv::Mat frame;
-	cv::Mat prob;
-	cv::Mat converted_prob;
-	cv::Mat thresh;
-	std::vector<std::vector<cv::Point>> contours;
-	std::vector<std::vector<cv::Rect>> tomato_rectangles;
-	std::size_t tomato_count = 0;
-	const double line_rad = 30.0 / 180.0 * 3.1415926535;
+	// A shard counts only the crossings into frames [shard_begin, shard_end).
+	// The pair ending at shard_begin needs the previous frame, so at least one frame of overlap is processed.
+	const bool is_shard = map.count("shard-output") > 0;
+	const std::size_t shard_begin = map["begin"].as<std::size_t>();
+	const std::size_t shard_end = map.count("end")
+		? std::min(map["end"].as<std::size_t>(), lapce.totalFrames())
+		: lapce.totalFrames();
+	const std::size_t overlap = std::max<std::size_t>(1, map["overlap"].as<std::size_t>());
+	ShardState shard;
+	shard.begin = shard_begin;
+	shard.end = shard_end;
+	shard.total_frames = lapce.totalFrames();
+	if (shard_begin >= shard_end) {
+		std::cerr << "ERROR: empty frame range" << std::endl;
+		return -1;
+	}
+	lapce.setCurrentFrame(shard_begin > overlap ? shard_begin - overlap : 0);
+	FruitsCounterConfig config;
+	config.segmenter = map["segmenter"].as<std::string>();
+	config.decode_scale = decode_scale;
+	config.tracker = tracker_name;
+	config.line_rad = line_rad;
+	if (map.count("geometry")) {
+		config.geometry = map["geometry"].as<bf::path>().string();
+	}
+	config.count_first_frame = !is_shard;
+	config.count_from = shard_begin;
+	config.change_tolerance = map["change-tolerance"].as<int>();
+	config.segment_threads = map["segment-threads"].as<std::size_t>();
+	config.frame_rate = map["frame-rate"].as<double>() > 0 ? map["frame-rate"].as<double>() : lapce.frameRate();
+	FruitsCounter counter;
+	std::string config_error;
+	if (!counter.configure(config, config_error)) {
+		std::cerr << "ERROR: " << config_error << std::endl;
+		return -1;
+	}
+	const bool use_adaptive_stride = map.count("adaptive-stride") > 0;
+	const std::size_t fixed_stride = map["stride"].as<std::size_t>();
+	if (fixed_stride == 0) {
+		std::cerr << "ERROR: stride must be 1 or more" << std::endl;
+		return -1;
+	}
+	if ((use_adaptive_stride || fixed_stride != 1) && is_shard) {
+		std::cerr << "ERROR: stride and adaptive-stride can not be used with shard-output" << std::endl;
+		return -1;
+	}
+	// Track velocities are not part of ShardState, so a shard would start its tracks from the overlap
+	// frames alone and the merged total could differ from a single run.
+	if (tracker_name != "nearest" && is_shard) {
+		std::cerr << "ERROR: shard-output can only be used with the nearest tracker" << std::endl;
+		return -1;
+	}
+	// The nearest tracker matches within a fixed distance that assumes consecutive frames.
+	if (use_adaptive_stride && tracker_name == "nearest") {
+		std::cerr << "ERROR: adaptive-stride can not be used with the nearest tracker" << std::endl;
+		return -1;
+	}
+	AdaptiveStride stride(map["max-stride"].as<std::size_t>(), map["static-threshold"].as<double>(), map["static-pixels"].as<int>());
+	const double near_line_distance = map["near-line-distance"].as<double>();
+	bool near_line = false;
+	std::size_t mul = fixed_stride;
+	// The checkpoint holds what the loop below carries from one frame to the next.
+	// The tile cache of change-tolerance is not part of it, and shards are short runs already.
+	const bool use_checkpoint = map.count("checkpoint") > 0;
+	const std::string checkpoint_file = use_checkpoint ? map["checkpoint"].as<bf::path>().string() : std::string();
+	const double checkpoint_interval = map["checkpoint-interval"].as<double>();
+	if (map.count("resume") && !use_checkpoint) {
+		std::cerr << "ERROR: You must be set 'checkpoint' option!!." << std::endl;
+		return -1;
+	}
+	if (use_checkpoint && (is_shard || config.change_tolerance >= 0)) {
+		std::cerr << "ERROR: checkpoint can not be used with shard-output or change-tolerance" << std::endl;
+		return -1;
+	}
+	CheckpointState checkpoint;
+	const std::uint64_t config_hash = use_checkpoint ? ::checkpointHash(::checkpointConfig(map, config)) : 0;
+	bool resumed = false;
+	if (map.count("resume")) {
+		if (!bf::exists(checkpoint_file)) {
+			std::cerr << "no checkpoint " << checkpoint_file << ", starting from the first frame" << std::endl;
+		}
+		else if (!::readCheckpoint(checkpoint_file, checkpoint)) {
+			std::cerr << "ERROR: can not read checkpoint " << checkpoint_file << std::endl;
+			return -1;
+		}
+		else if (checkpoint.config_hash != config_hash) {
+			std::cerr << "ERROR: checkpoint " << checkpoint_file << " was written with different options" << std::endl;
+			return -1;
+		}
+		else {
+			if (!counter.restore(checkpoint.counter)) {
+				std::cerr << "ERROR: can not read counting geometry" << std::endl;
+				return -1;
+			}
+			stride.restore(checkpoint.stride, checkpoint.stride_reference);
+			near_line = checkpoint.near_line;
+			mul = checkpoint.step;
+			lapce.setCurrentFrame(checkpoint.next_frame);
+			resumed = true;
+			std::cerr << "RESUMED: frame " << checkpoint.next_frame << ", " << counter.count() << " tomatoes" << std::endl;
+		}
+	}
+	const std::string event_format = map["event-format"].as<std::string>();
+	if (event_format != "csv" && event_format != "binary") {
+		std::cerr << "ERROR: event-format must be csv or binary" << std::endl;
+		return -1;
+	}
+	CountEventLog event_log;
+	const CountEventLog::Format event_log_format = event_format == "binary" ? CountEventLog::BINARY : CountEventLog::CSV;
+	if (resumed
+		? !event_log.resume(map["events"].as<std::string>(), event_log_format, checkpoint.events_written)
+		: !event_log.open(map["events"].as<std::string>(), event_log_format)) {
+		std::cerr << "ERROR: can not open event log " << map["events"].as<std::string>() << std::endl;
+		return -1;
+	}
+	std::vector<CountEvent> events;
 	if (!map.count("output")) {
 #ifdef USE_SHOW
 		cv::namedWindow("W");
@@ -177,88 +300,86 @@ int main(int argc, char** argv) {
 		cv::namedWindow("F");
 #endif
 	}
-	std::size_t mul = 1;
-	while (lapce.isOpened()) {
+	// the state between two iterations is complete, so that is where checkpoints are taken
+	auto saveCheckpoint = [&]() -> bool {
+		event_log.flush();
+		checkpoint.config_hash = config_hash;
+		checkpoint.next_frame = lapce.currentFrame() + 1;
+		checkpoint.step = mul;
+		checkpoint.near_line = near_line;
+		checkpoint.counter = counter.state();
+		checkpoint.stride = stride.stride();
+		checkpoint.stride_reference = stride.reference();
+		checkpoint.events_written = event_log.written();
+		if (!::writeCheckpoint(checkpoint_file, checkpoint)) {
+			std::cerr << "ERROR: can not write checkpoint " << checkpoint_file << std::endl;
+			return false;
+		}
+		return true;
+	};
+	std::size_t frames_read = 0;
+	const int64 start_tick = cv::getTickCount();
+	int64 checkpoint_tick = start_tick;
+	// currentFrame() + 1 is the frame the next >> reads
+	while (lapce.isOpened() && lapce.currentFrame() + 1 < shard_end) {
+		if (use_checkpoint && (cv::getTickCount() - checkpoint_tick) / cv::getTickFrequency() >= checkpoint_interval) {
+			if (!saveCheckpoint()) {
+				return -1;
+			}
+			checkpoint_tick = cv::getTickCount();
+		}
 		lapce >> frame;
+		frames_read++;
+		const std::size_t frame_index = lapce.currentFrame();
 		lapce.setCurrentFrame(lapce.currentFrame() + mul);
-		::calcTomatoProbability(frame, prob);
-		cv::blur(prob, prob, cv::Size(15, 15));
-		//      cv::GaussianBlur(prob, prob, cv::Size(9, 9), 0.0);
-		prob.convertTo(converted_prob, CV_8U, 255);
-		cv::threshold(converted_prob, thresh, 255 * 0.73, 255, CV_THRESH_BINARY);
-		cv::erode(thresh, thresh, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::dilate(thresh, thresh, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::findContours(thresh.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
-		//cv::drawContours(frame, contours, -1, cv::Scalar(0, 0, 255), 3);
-		std::vector<cv::Rect> bounding_rects;
-		for (const auto& contour : contours) {
-			auto rect = cv::boundingRect(contour);
-			bounding_rects.push_back(rect);
+		// nothing moved since the last processed frame, so the detections and the count can not change
+		if (use_adaptive_stride && stride.isStatic(frame)) {
+			mul = stride.update(near_line, !counter.detections().empty(), true);
+			lapce.setCurrentFrame(frame_index + mul);
+			continue;
+		}
+		if (!counter.pushFrame(frame_index, frame)) {
+			std::cerr << "ERROR: can not read counting geometry" << std::endl;
+			return -1;
+		}
+		events.clear();
+		counter.takeEvents(events);
+		for (const auto& event : events) {
+			event_log.write(event);
 		}
+		event_log.flushIfDue();
+		const auto& bounding_rects = counter.detections();
 		for (const auto& rect : bounding_rects) {
-			cv::rectangle(frame, rect, cv::Scalar(255, 0, 0), 5);
+			const cv::Rect shown(rect.x / decode_scale, rect.y / decode_scale, rect.width / decode_scale, rect.height / decode_scale);
+			cv::rectangle(frame, shown, cv::Scalar(255, 0, 0), 5);
 		}
-		tomato_rectangles.push_back(std::move(bounding_rects));
-		if (tomato_rectangles.size() == 1) {
-			const int width = frame.cols, height = frame.rows;
-			const double radius = std::max(width, height) / 2.0;
-			auto inrange_func = [width, height, line_rad, radius](const cv::Point& a) {
-				const double x = a.x - width / 2.0;
-				const double y = a.y - height / 2.0;
-				const double theta = std::atan2(y, x);
-				return theta <= -line_rad && theta >= -(3.14159265 - line_rad);
-			};
-			for (const auto& cur : tomato_rectangles[0]) {
-				if (inrange_func(::rect2point(cur))) {
-					tomato_count++;
-				}
-			}
+		if (frame_index == shard_begin) {
+			shard.first = bounding_rects;
 		}
-		if (tomato_rectangles.size() >= 2) {
-			const int width = frame.cols, height = frame.rows;
-			const double radius = std::max(width, height) / 2.0;
-			auto countup_func = [width, height, line_rad, radius](const cv::Point& a, const cv::Point& b) {
-				return (
-					::isCross(
-						std::pair<cv::Point, cv::Point>(a, b),
-						std::pair<cv::Point, cv::Point>(
-							cv::Point(width / 2, height / 2),
-							cv::Point(width / 2 + radius * std::cos(line_rad), height / 2 - radius * std::sin(line_rad))
-							)
-						) || ::isCross(
-							std::pair<cv::Point, cv::Point>(a, b),
-							std::pair<cv::Point, cv::Point>(
-								cv::Point(width / 2, height / 2),
-								cv::Point(width / 2 - radius * std::cos(line_rad), height / 2 - radius * std::sin(line_rad))
-								)
-							)
-					) && ::distance(a, b) < 50;
-			};
-			std::size_t incremt = ::getIncrementalTomato(
-				tomato_rectangles[tomato_rectangles.size() - 1],
-				tomato_rectangles[tomato_rectangles.size() - 2],
-				countup_func
-				);
-			tomato_count += incremt;
-			if (incremt != 0)
-			{
-				std::cout << lapce.currentFrame() << "," << tomato_count << std::endl;
+		if (use_adaptive_stride) {
+			near_line = false;
+			for (const auto& rect : bounding_rects) {
+				if (counter.geometry().distanceToLines(::rect2point(rect)) < near_line_distance) {
+					near_line = true;
+					break;
+				}
 			}
+			mul = stride.update(near_line, !bounding_rects.empty(), false);
+			lapce.setCurrentFrame(frame_index + mul);
 		}
 		std::stringstream tomato_ss;
-		tomato_ss << tomato_count;
+		tomato_ss << counter.count();
 		cv::putText(frame, tomato_ss.str(), cv::Point(20, 150), cv::FONT_HERSHEY_SIMPLEX, 6.0, cv::Scalar(255, 255, 255), 5);
 		if (map.count("output")) {
 			auto output_dir = map["output"].as<bf::path>();
 			std::stringstream ss;
-			ss << lapce.currentFrame() << ".png";
+			ss << frame_index << ".png";
 			auto th_output_path = output_dir / "th" / ss.str();
 			auto prob_output_path = output_dir / "prob" / ss.str();
 			auto frame_output_path = output_dir / "frame" / ss.str();
-			prob.convertTo(prob, CV_8UC1, 255);
 			cv::Mat prob_small, th_small, frame_small;
-			cv::resize(prob, prob_small, cv::Size(), 0.5, 0.5);
-			cv::resize(thresh, th_small, cv::Size(), 0.5, 0.5);
+			cv::resize(counter.segmenter().probability(), prob_small, cv::Size(), 0.5, 0.5);
+			cv::resize(counter.segmenter().mask(), th_small, cv::Size(), 0.5, 0.5);
 			cv::resize(frame, frame_small, cv::Size(), 0.5, 0.5);
 			cv::imwrite(prob_output_path.string(), prob_small);
 			cv::imwrite(th_output_path.string(), th_small);
@@ -267,8 +388,10 @@ int main(int argc, char** argv) {
 		else {
 #ifdef USE_SHOW
 			::resizeAndShow(frame, "W", cv::Size(700, 700));
-			::resizeAndShow(converted_prob, "P");
-			::resizeAndShow(thresh, "O");
+			cv::Mat shown_prob = counter.segmenter().probability().clone();
+			cv::Mat shown_mask = counter.segmenter().mask().clone();
+			::resizeAndShow(shown_prob, "P");
+			::resizeAndShow(shown_mask, "O");
 #endif
 		}
 #ifdef USE_SHOW
@@ -284,52 +407,38 @@ int main(int argc, char** argv) {
 		}
 #endif
 	}
-	const int width = frame.cols, height = frame.rows;
-	const double radius = std::max(width, height) / 2.0;
-	
-	auto inrange_func = [width, height, line_rad, radius](const cv::Point& a) {
-		const double x = a.x - width / 2.0;
-		const double y = a.y - height / 2.0;
-		const double theta = std::atan2(y, x);
-		return theta <= -line_rad && theta >= -(3.14159265 - line_rad);
-	};
-	for (const auto& cur : tomato_rectangles[tomato_rectangles.size() - 1]) {
-		if (!inrange_func(::rect2point(cur))) {
-			tomato_count++;
+	if (counter.frames() == 0) {
+		std::cerr << "ERROR: no frames were read" << std::endl;
+		return -1;
+	}
+	// throughput goes to stderr so the count output on stdout stays parseable
+	const double elapsed = (cv::getTickCount() - start_tick) / cv::getTickFrequency();
+	std::cerr << "FPS: " << (elapsed > 0 ? frames_read / elapsed : 0.0) << std::endl;
+	// a run stopped by end continues from here when resumed without it
+	if (use_checkpoint && !saveCheckpoint()) {
+		return -1;
+	}
+	if (is_shard) {
+		shard.width = counter.geometry().size().width;
+		shard.height = counter.geometry().size().height;
+		shard.count = counter.count();
+		shard.last = counter.detections();
+		if (!::writeShard(map["shard-output"].as<bf::path>().string(), shard)) {
+			std::cerr << "ERROR: can not write shard" << std::endl;
+			return -1;
 		}
+		event_log.close();
+		std::cout << "SHARD: " << shard_begin << "-" << shard_end << " " << counter.count() << std::endl;
+		return 0;
+	}
+	const std::size_t tomato_count = counter.finish();
+	events.clear();
+	counter.takeEvents(events);
+	for (const auto& event : events) {
+		event_log.write(event);
 	}
+	event_log.close();
 	std::cout << "TOMATO: " << tomato_count << std::endl;
-	
-	/*
-	auto count = countTomato(
-		tomato_rectangles,
-		[width, height, line_rad, radius](const cv::Point& a, const cv::Point& b) {
-			return (
-				::isCross(
-					std::pair<cv::Point, cv::Point>(a, b),
-					std::pair<cv::Point, cv::Point>(
-						cv::Point(width / 2, height / 2),
-						cv::Point(width / 2 + radius * std::cos(line_rad), height / 2 - radius * std::sin(line_rad))
-					)
-				) || ::isCross(
-					std::pair<cv::Point, cv::Point>(a, b),
-					std::pair<cv::Point, cv::Point>(
-						cv::Point(width / 2, height / 2),
-						cv::Point(width / 2 - radius * std::cos(line_rad), height / 2 - radius * std::sin(line_rad))
-					)
-				)
-			) && ::distance(a, b) < 100;
-	},
-		[width, height, line_rad, radius](const cv::Point& a) {
-		const double x = a.x - width / 2.0;
-		const double y = a.y - height / 2.0;
-		const double theta = std::atan2(y, x);
-		return theta <= -line_rad && theta >= -(3.14159265 - line_rad);
-	}
-	);
-	std::cout << "TOMATO: " << count << std::endl;
-	*/
-	//  cv::waitKey();
 	return 0;
 }
 
@@ -347,6 +456,7 @@ int main(int argc, char** argv) {
 #include "TimeLapse.hpp"
 #include "TomatoInformation.hpp"
 #include "TomatoCounter.hpp"
+#include "BinaryMorphology.hpp"
 
 typedef cv::Vec3b Pixel;
 
@@ -374,8 +484,11 @@ void calcTomatoProbability(const cv::Mat& img, cv::Mat& dst) {
 }
 
 void opening(const cv::Mat& input, cv::Mat& output) {
-	auto elem = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(15, 15));
-	cv::morphologyEx(input, output, cv::MORPH_OPEN, elem);
+	// same as MORPH_OPEN with a 15x15 rectangle
+	BitMask mask, opened;
+	::packThreshold(input, 0, mask);
+	::openRect(mask, opened, 7, 7);
+	::unpackMask(opened, output);
 }
 
 int main(int argc, char** argv) {
@@ -0,0 +1,211 @@
+#include <csignal>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <boost/asio.hpp>
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "MJpegRecording.hpp"
+
+namespace {
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void onSignal(int) {
+		interrupted = 1;
+	}
+
+	std::size_t countImageEnds(const unsigned char* data, std::size_t size, bool& previous_ff) {
+		std::size_t ends = 0;
+		for (std::size_t i = 0; i < size; ++i) {
+			if (previous_ff && data[i] == 0xd9) {
+				ends++;
+			}
+			previous_ff = data[i] == 0xff;
+		}
+		return ends;
+	}
+}
+
+/**
+ * Splits host[:port][/file] of an MJPEG stream.
+ */
+bool parseStream(const std::string& spec, std::string& host, std::string& port, std::string& file) {
+	const std::size_t slash = spec.find('/');
+	const std::string authority = spec.substr(0, slash);
+	file = slash == std::string::npos ? "" : spec.substr(slash + 1);
+	const std::size_t colon = authority.find(':');
+	host = authority.substr(0, colon);
+	port = colon == std::string::npos ? "80" : authority.substr(colon + 1);
+	return !host.empty() && !port.empty();
+}
+
+/**
+ * Records the bytes of a camera stream until duration seconds or max_frames images
+ * have arrived (0: no limit) or the process is interrupted.
+ */
+bool recordStream(const std::string& spec, const boost::filesystem::path& output, double duration, std::size_t max_frames) {
+	namespace ip = boost::asio::ip;
+	typedef boost::chrono::steady_clock Clock;
+	std::string host, port, file;
+	if (!::parseStream(spec, host, port, file)) {
+		std::cerr << "ERROR: invalid stream " << spec << std::endl;
+		return false;
+	}
+	boost::asio::io_service io_service;
+	ip::tcp::socket socket(io_service);
+	ip::tcp::resolver resolver(io_service);
+	boost::system::error_code error;
+	auto it = resolver.resolve(ip::tcp::resolver::query(ip::tcp::v4(), host, port), error);
+	if (!error) {
+		boost::asio::connect(socket, it, error);
+	}
+	if (!error) {
+		std::stringstream request;
+		request << "GET /" << file << " HTTP/1.1\r\n"
+			<< "Host: " << host << "\r\n"
+			<< "Connection: keep-alive\r\n"
+			<< "Accept: image/webp,image/*,*/*;q=0.8\r\n\r\n";
+		boost::asio::write(socket, boost::asio::buffer(request.str()), error);
+	}
+	boost::asio::streambuf response;
+	std::size_t header_size = 0;
+	if (!error) {
+		header_size = boost::asio::read_until(socket, response, "\r\n\r\n", error);
+	}
+	if (error) {
+		std::cerr << "ERROR: " << spec << ": " << error.message() << std::endl;
+		return false;
+	}
+	const auto start = Clock::now();
+	// read_until may have read past the header; that is the first chunk
+	std::vector<unsigned char> buffer(response.size());
+	boost::asio::buffer_copy(boost::asio::buffer(buffer), response.data());
+	MJpegRecordingWriter writer;
+	if (!writer.open(output.string(), std::string(buffer.begin(), buffer.begin() + header_size))) {
+		std::cerr << "ERROR: can not write " << output << std::endl;
+		return false;
+	}
+	bool previous_ff = false;
+	std::size_t frames = ::countImageEnds(buffer.data() + header_size, buffer.size() - header_size, previous_ff);
+	if (buffer.size() > header_size) {
+		writer.append(0, buffer.data() + header_size, buffer.size() - header_size);
+	}
+	buffer.resize(64 * 1024);
+	while (!interrupted && (max_frames == 0 || frames < max_frames)) {
+		const std::size_t size = socket.read_some(boost::asio::buffer(buffer), error);
+		const auto now = Clock::now();
+		if (size > 0) {
+			const auto time = boost::chrono::duration_cast<boost::chrono::microseconds>(now - start).count();
+			if (!writer.append(time, buffer.data(), size)) {
+				std::cerr << "ERROR: can not write " << output << std::endl;
+				return false;
+			}
+			frames += ::countImageEnds(buffer.data(), size, previous_ff);
+		}
+		if (error) {
+			if (error != boost::asio::error::eof) {
+				std::cerr << "ERROR: " << spec << ": " << error.message() << std::endl;
+			}
+			break;
+		}
+		if (duration > 0 && boost::chrono::duration<double>(now - start).count() >= duration) {
+			break;
+		}
+	}
+	std::cout << "FRAMES: " << frames << std::endl;
+	return writer.close();
+}
+
+/**
+ * Turns the images of a directory, in file name order, into the stream a camera
+ * sending fps images per second would produce, one chunk per image.
+ */
+bool recordImages(const boost::filesystem::path& input, const boost::filesystem::path& output, double fps) {
+	namespace bf = boost::filesystem;
+	const std::string BOUNDARY = "frame";
+	std::vector<bf::path> files;
+	for (const auto& entry : bf::directory_iterator(input)) {
+		if (bf::is_regular_file(entry.path())) {
+			files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	MJpegRecordingWriter writer;
+	if (!writer.open(output.string(), "HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=" + BOUNDARY + "\r\n\r\n")) {
+		std::cerr << "ERROR: can not write " << output << std::endl;
+		return false;
+	}
+	std::size_t frames = 0;
+	std::vector<unsigned char> jpeg;
+	for (const auto& f : files) {
+		cv::Mat image = cv::imread(f.string());
+		if (image.empty() || !cv::imencode(".jpg", image, jpeg)) {
+			continue;
+		}
+		std::stringstream part;
+		part << "--" << BOUNDARY << "\r\n"
+			<< "Content-Type: image/jpeg\r\n"
+			<< "Content-Length: " << jpeg.size() << "\r\n\r\n";
+		std::string chunk = part.str();
+		chunk.append(jpeg.begin(), jpeg.end());
+		chunk += "\r\n";
+		const std::int64_t time = static_cast<std::int64_t>(frames * 1000000.0 / fps);
+		if (!writer.append(time, reinterpret_cast<const unsigned char*>(chunk.data()), chunk.size())) {
+			std::cerr << "ERROR: can not write " << output << std::endl;
+			return false;
+		}
+		frames++;
+	}
+	std::cout << "FRAMES: " << frames << std::endl;
+	return frames > 0 && writer.close();
+}
+
+int main(int argc, char** argv) {
+	namespace bp = boost::program_options;
+	namespace bf = boost::filesystem;
+	bp::options_description general_opt("Allowed Options");
+	general_opt.add_options()
+		("help,h", "Show help")
+		("mjpeg", bp::value<std::string>(), "MJPEG stream to record as host[:port][/file]")
+		("timelapse,i", bp::value<bf::path>(), "Directory of images to turn into a recording instead")
+		("output,o", bp::value<bf::path>(), "Recording to write")
+		("duration,d", bp::value<double>()->default_value(0.0), "Seconds to record (0: until the stream ends or the process is interrupted)")
+		("frames,n", bp::value<std::size_t>()->default_value(0), "Images to record (0: no limit)")
+		("fps", bp::value<double>()->default_value(10.0), "Images per second of a recording made from a directory");
+	bp::variables_map map;
+	try {
+		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
+		bp::notify(map);
+	}
+	catch (const bp::error& e) {
+		std::cerr << "ERROR:" << e.what() << std::endl;
+		std::cout << general_opt << std::endl;
+		return -1;
+	}
+	if (map.count("help")) {
+		std::cout << general_opt << std::endl;
+		return 0;
+	}
+	if (!map.count("output") || map.count("mjpeg") == map.count("timelapse")) {
+		std::cerr << "ERROR: You must be set 'output' and either 'mjpeg' or 'timelapse' options!!." << std::endl;
+		return -1;
+	}
+	if (map.count("timelapse")) {
+		if (map["fps"].as<double>() <= 0) {
+			std::cerr << "ERROR: fps must be positive" << std::endl;
+			return -1;
+		}
+		return ::recordImages(map["timelapse"].as<bf::path>(), map["output"].as<bf::path>(), map["fps"].as<double>()) ? 0 : -1;
+	}
+	std::signal(SIGINT, ::onSignal);
+	std::signal(SIGTERM, ::onSignal);
+	return ::recordStream(
+		map["mjpeg"].as<std::string>(),
+		map["output"].as<bf::path>(),
+		map["duration"].as<double>(),
+		map["frames"].as<std::size_t>()) ? 0 : -1;
+}
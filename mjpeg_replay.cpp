@@ -0,0 +1,191 @@
+#include <csignal>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <opencv2/core.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include "MJpegRecording.hpp"
+#include "MJpegReplayServer.hpp"
+#include "MJpegStream.hpp"
+
+namespace {
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void onSignal(int) {
+		interrupted = 1;
+	}
+}
+
+struct ClientResult {
+	/** images the parser found */
+	std::size_t received = 0;
+	/** images decoded; the rest were replaced by a newer one before the client got to them */
+	std::size_t decoded = 0;
+};
+
+/**
+ * Reads camera like the daemon does and decodes every image it gets to,
+ * until the camera closes the stream or stop is set.
+ */
+void runClient(unsigned short port, std::size_t camera, int decode_scale, const std::atomic<bool>& stop, ClientResult& result) {
+	MJpegStream stream;
+	stream.setDecodeScale(decode_scale);
+	stream.connect("127.0.0.1", std::to_string(camera), std::to_string(port));
+	std::size_t last = 0;
+	while (!stop) {
+		const bool connected = stream.isConnected();
+		const std::size_t received = stream.receivedFrames();
+		if (received == last) {
+			if (!connected) {
+				break;
+			}
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+			continue;
+		}
+		last = received;
+		if (!stream.readImage().empty()) {
+			result.decoded++;
+		}
+	}
+	result.received = last;
+}
+
+int main(int argc, char** argv) {
+	namespace bp = boost::program_options;
+	namespace bf = boost::filesystem;
+	bp::options_description general_opt("Allowed Options");
+	general_opt.add_options()
+		("help,h", "Show help")
+		("input,i", bp::value<std::vector<bf::path>>()->multitoken(), "Recordings written by mjpeg_record")
+		("port,p", bp::value<unsigned short>()->default_value(8090), "Port on 127.0.0.1; camera N is http://127.0.0.1:<port>/N (0: any free port)")
+		("speed", bp::value<double>()->default_value(1.0), "Playback speed: 1 real time, N times real time, 0 as fast as possible")
+		("loop", "Start a recording over when it ends instead of closing the connection")
+		("cameras,c", bp::value<std::size_t>()->default_value(0), "Emulated cameras, playing the recordings in turn (0: one per recording)")
+		("threads,j", bp::value<std::size_t>()->default_value(1), "Server threads")
+		("clients", bp::value<std::size_t>()->default_value(0), "Built-in clients that parse and decode the streams, one per camera in turn (0: serve only)")
+		("decode-scale,s", bp::value<int>()->default_value(1), "Decode scale of the built-in clients (1, 2, 4 or 8)")
+		("duration,d", bp::value<double>()->default_value(0.0), "Seconds to run (0: until the clients have read every recording, or until interrupted)")
+		("expect-frames", bp::value<std::size_t>(), "Fail unless every recording has this many frames and every client received all of them (needs clients, no loop and no duration)");
+	bp::variables_map map;
+	try {
+		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
+		bp::notify(map);
+	}
+	catch (const bp::error& e) {
+		std::cerr << "ERROR:" << e.what() << std::endl;
+		std::cout << general_opt << std::endl;
+		return -1;
+	}
+	if (map.count("help")) {
+		std::cout << general_opt << std::endl;
+		return 0;
+	}
+	if (!map.count("input")) {
+		std::cerr << "ERROR: You must be set 'input' option!!." << std::endl;
+		return -1;
+	}
+	std::vector<std::unique_ptr<MJpegRecording>> recordings;
+	std::vector<const MJpegRecording*> served;
+	for (const auto& path : map["input"].as<std::vector<bf::path>>()) {
+		std::unique_ptr<MJpegRecording> recording(new MJpegRecording());
+		if (!recording->open(path.string())) {
+			std::cerr << "ERROR: can not open " << path << std::endl;
+			return -1;
+		}
+		std::cerr << path << ": " << recording->frames() << " frames, " << recording->duration() / 1e6 << " s" << std::endl;
+		served.push_back(recording.get());
+		recordings.push_back(std::move(recording));
+	}
+	const bool check_frames = map.count("expect-frames") > 0;
+	if (check_frames) {
+		const std::size_t expected = map["expect-frames"].as<std::size_t>();
+		if (map["clients"].as<std::size_t>() == 0 || map.count("loop") || map["duration"].as<double>() > 0) {
+			std::cerr << "ERROR: expect-frames needs clients, no loop and no duration" << std::endl;
+			return -1;
+		}
+		for (const auto recording : served) {
+			if (recording->frames() != expected) {
+				std::cerr << "ERROR: a recording has " << recording->frames() << " frames, expected " << expected << std::endl;
+				return -1;
+			}
+		}
+	}
+	MJpegReplayServer::Parameters params;
+	params.speed = map["speed"].as<double>();
+	params.loop = map.count("loop") > 0;
+	params.cameras = map["cameras"].as<std::size_t>();
+	params.threads = map["threads"].as<std::size_t>();
+	MJpegReplayServer server(served, params);
+	if (!server.start(map["port"].as<unsigned short>())) {
+		return -1;
+	}
+	std::cerr << "SERVING: " << server.cameras() << " cameras on 127.0.0.1:" << server.port() << std::endl;
+	std::signal(SIGINT, ::onSignal);
+	std::signal(SIGTERM, ::onSignal);
+
+	const std::size_t clients = map["clients"].as<std::size_t>();
+	const double duration = map["duration"].as<double>();
+	std::atomic<bool> stop(false);
+	std::vector<ClientResult> results(clients);
+	boost::thread_group group;
+	for (std::size_t c = 0; c < clients; ++c) {
+		group.create_thread([&, c]() {
+			::runClient(server.port(), c % server.cameras(), map["decode-scale"].as<int>(), stop, results[c]);
+		});
+	}
+	const int64 start_tick = cv::getTickCount();
+	bool played_out = false;
+	while (!interrupted) {
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+		const double elapsed = (cv::getTickCount() - start_tick) / cv::getTickFrequency();
+		if (duration > 0 && elapsed >= duration) {
+			break;
+		}
+		// without a duration the built-in clients run until every connection has been played out
+		const auto statistics = server.statistics();
+		if (duration <= 0 && clients > 0 && !params.loop && statistics.connections >= clients && statistics.active == 0) {
+			played_out = true;
+			break;
+		}
+	}
+	if (played_out) {
+		// every stream has been sent; the clients stop once they have parsed what is left in their sockets
+		group.join_all();
+	}
+	const double elapsed = (cv::getTickCount() - start_tick) / cv::getTickFrequency();
+	// closing the connections ends the reads the clients are blocked in
+	server.stop();
+	stop = true;
+	group.join_all();
+
+	const auto statistics = server.statistics();
+	std::size_t received = 0;
+	std::size_t decoded = 0;
+	for (const auto& r : results) {
+		received += r.received;
+		decoded += r.decoded;
+	}
+	std::cout << "CONNECTIONS: " << statistics.connections << std::endl;
+	std::cout << "MBPS: " << (elapsed > 0 ? statistics.bytes * 8 / elapsed / 1e6 : 0.0) << std::endl;
+	if (clients > 0) {
+		std::cout << "RECEIVED: " << received << std::endl;
+		std::cout << "DECODED: " << decoded << std::endl;
+		std::cout << "FPS: " << (elapsed > 0 ? decoded / elapsed : 0.0) << std::endl;
+		if (check_frames) {
+			bool ok = played_out;
+			for (std::size_t c = 0; c < clients; ++c) {
+				if (results[c].received != map["expect-frames"].as<std::size_t>()) {
+					std::cerr << "ERROR: client " << c << " received " << results[c].received << " frames" << std::endl;
+					ok = false;
+				}
+			}
+			return ok ? 0 : -1;
+		}
+		return decoded > 0 ? 0 : -1;
+	}
+	return 0;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "FrameIndex.hpp"
+#include "FrameArchive.hpp"
+
+bool readFile(const boost::filesystem::path& path, std::vector<unsigned char>& buf) {
+	std::ifstream ifs(path.string(), std::ios::binary | std::ios::ate);
+	if (!ifs) {
+		return false;
+	}
+	buf.resize(static_cast<std::size_t>(ifs.tellg()));
+	ifs.seekg(0);
+	return static_cast<bool>(ifs.read(reinterpret_cast<char*>(buf.data()), buf.size()));
+}
+
+int pack(const boost::filesystem::path& input, const boost::filesystem::path& output) {
+	FrameIndex frames;
+	if (!frames.open(input)) {
+		std::cerr << "ERROR: can not open timelapse directory " << input << std::endl;
+		return -1;
+	}
+	FrameArchiveWriter writer;
+	if (!writer.open(output.string())) {
+		std::cerr << "ERROR: can not create " << output << std::endl;
+		return -1;
+	}
+	std::vector<unsigned char> buf;
+	for (std::size_t i = 0; i < frames.size(); ++i) {
+		const auto path = frames.path(i);
+		if (!::readFile(path, buf) || !writer.append(buf.data(), buf.size())) {
+			std::cerr << "ERROR: failed to pack " << path << std::endl;
+			return -1;
+		}
+	}
+	if (!writer.close()) {
+		std::cerr << "ERROR: failed to write " << output << std::endl;
+		return -1;
+	}
+	std::cout << "FRAMES: " << frames.size() << std::endl;
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	namespace bp = boost::program_options;
+	namespace bf = boost::filesystem;
+	bp::options_description general_opt("Allowed Options");
+	general_opt.add_options()
+		("help,h", "Show help")
+		("input,i", bp::value<bf::path>(), "Timelapse directory.")
+		("output,o", bp::value<bf::path>(), "Archive file to create.");
+	bp::variables_map map;
+	try {
+		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
+		bp::notify(map);
+	}
+	catch (const bp::error& e) {
+		std::cerr << "ERROR:" << e.what() << std::endl;
+		return -1;
+	}
+	if (map.count("help")) {
+		std::cout << general_opt;
+	}
+	if (map.count("input") && map.count("output")) {
+		return ::pack(map["input"].as<bf::path>(), map["output"].as<bf::path>());
+	}
+	std::cerr << "ERROR: You must be set 'input' and 'output' options!!." << std::endl;
+	return -1;
+}
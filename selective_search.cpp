@@ -8,6 +8,8 @@
 #include <dlib/image_transforms.h>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
+#include "HogUtil.hpp"
+#include "CropDataset.hpp"
 
 template<class Functor>
 void findObjectRectangle(const cv::Mat& input, std::vector<cv::Rect>& rects, Functor func) {
@@ -26,7 +28,10 @@ void findObjectRectangle(const cv::Mat& input, std::vector<cv::Rect>& rects, Fun
 	}
 }
 
-void extract_objects(const boost::filesystem::path& input_path, const boost::filesystem::path& output_path) {
+/**
+ * \param[in] dataset if open, the crops are appended to it instead of written to output_path
+ */
+void extract_objects(const boost::filesystem::path& input_path, const boost::filesystem::path& output_path, CropDatasetWriter& dataset, bool use_dataset, int label) {
 	cv::Mat frame = cv::imread(input_path.string());
 	std::vector<cv::Rect> rects;
 	::findObjectRectangle(
@@ -39,6 +44,16 @@ void extract_objects(const boost::filesystem::path& input_path, const boost::fil
 			&& rect.height() < 200;
 	}
 	);
+	if (use_dataset) {
+		if (!dataset.beginSource(boost::filesystem::absolute(input_path).string())) {
+			std::cerr << "ERROR: can not write crops of " << input_path << std::endl;
+			return;
+		}
+		for (const auto& rect : rects) {
+			dataset.append(frame, rect, label);
+		}
+		return;
+	}
 	std::size_t num = 0;
 	for (const auto& rect : rects) {
 		std::stringstream ss;
@@ -55,7 +70,9 @@ int main(int argc, char** argv) {
 	general_opt.add_options()
 		("help,h", "Show help")
 		("input,i", bp::value<bf::path>(), "Input image or directory.")
-		("output,o", bp::value<bf::path>(), "Output directory.");
+		("output,o", bp::value<bf::path>(), "Output directory.")
+		("dataset,d", bp::value<bf::path>(), "Crop dataset to append to instead of writing images to the output directory.")
+		("label,l", bp::value<int>()->default_value(0), "Label stored with the crops in the dataset (1: positive, -1: negative, 0: not labeled).");
 	bp::variables_map map;
 	try {
 		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
@@ -68,11 +85,25 @@ int main(int argc, char** argv) {
 	if (map.count("help")) {
 		std::cout << general_opt;
 	}
-	if (map.count("input") && map.count("output")) {
-		::extract_objects(map["input"].as<bf::path>(), map["output"].as<bf::path>());
+	if (map.count("input") && (map.count("output") || map.count("dataset"))) {
+		CropDatasetWriter dataset;
+		if (map.count("dataset") && !dataset.open(map["dataset"].as<bf::path>().string(), ::getHOGWinSize())) {
+			std::cerr << "ERROR: can not open " << map["dataset"].as<bf::path>() << std::endl;
+			return -1;
+		}
+		::extract_objects(
+			map["input"].as<bf::path>(),
+			map.count("output") ? map["output"].as<bf::path>() : bf::path(),
+			dataset,
+			map.count("dataset") > 0,
+			map["label"].as<int>());
+		if (map.count("dataset") && !dataset.close()) {
+			std::cerr << "ERROR: can not write " << map["dataset"].as<bf::path>() << std::endl;
+			return -1;
+		}
 	}
 	else {
-		std::cerr << "ERROR: You must be set 'input' and 'output' options!!." << std::endl;
+		std::cerr << "ERROR: You must be set 'input' and 'output' or 'dataset' options!!." << std::endl;
 	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+/**
+ * Synthetic timelapse: red blobs moving on circles around the image center,
+ * with the ground-truth count of main's counting rule
+ * (tomatoes in range at the first frame + line crossings + tomatoes out of range at the last frame).
+ */
+struct SynthParameters {
+	int width = 640;
+	int height = 640;
+	std::size_t frames = 200;
+	int fruits = 8;
+	double speed = 0.02;
+	int radius = 18;
+	double occlusion = 0.0;
+	double noise = 0.0;
+	unsigned int seed = 0;
+	std::string format = "jpg";
+};
+
+struct Blob {
+	double orbit;
+	double phase;
+	double speed;
+};
+
+namespace {
+	const double PI = 3.141592653589793238463;
+	const double LINE_RAD = 30.0 / 180.0 * PI;
+
+	double wrapAngle(double angle) {
+		return std::atan2(std::sin(angle), std::cos(angle));
+	}
+
+	bool isInRange(double theta) {
+		theta = ::wrapAngle(theta);
+		return theta <= -LINE_RAD && theta >= -(PI - LINE_RAD);
+	}
+
+	/**
+	 * Number of times the angle passes one of the counting lines between two frames.
+	 */
+	std::size_t crossings(double from, double to) {
+		std::size_t count = 0;
+		for (double line : { -LINE_RAD, -(PI - LINE_RAD) }) {
+			const double a = ::wrapAngle(from - line);
+			const double b = ::wrapAngle(to - line);
+			// a small step that changes the sign of the angle to the line near 0 (not near pi) crosses it
+			if ((a < 0) != (b < 0) && std::abs(a - b) < PI) {
+				count++;
+			}
+		}
+		return count;
+	}
+}
+
+class SyntheticTimeLapse {
+private:
+	SynthParameters params_;
+	std::vector<Blob> blobs_;
+	cv::Rect occluder_;
+public:
+	SyntheticTimeLapse(const SynthParameters& params) :params_(params) {
+		cv::RNG rng(params.seed);
+		const double min_side = std::min(params.width, params.height);
+		// blobs share a few orbits and are spread evenly along them so they never touch
+		const int orbits = 3;
+		const int per_orbit = (params.fruits + orbits - 1) / orbits;
+		for (int i = 0; i < params.fruits; ++i) {
+			Blob blob;
+			blob.orbit = min_side * (0.22 + 0.08 * (i % orbits));
+			blob.phase = 2.0 * PI * (i / orbits) / per_orbit + rng.uniform(0.0, 0.2);
+			blob.speed = params.speed;
+			this->blobs_.push_back(blob);
+		}
+		// the occluder is a bar below the center, away from the counting lines
+		const int bar_width = static_cast<int>(params.width * params.occlusion);
+		this->occluder_ = cv::Rect(params.width / 2 - bar_width / 2, params.height / 2, bar_width, params.height / 2);
+	}
+
+	cv::Point2d position(const Blob& blob, std::size_t frame)const {
+		const double theta = blob.phase + blob.speed * frame;
+		return cv::Point2d(
+			this->params_.width / 2.0 + blob.orbit * std::cos(theta),
+			this->params_.height / 2.0 + blob.orbit * std::sin(theta));
+	}
+
+	bool isVisible(const Blob& blob, std::size_t frame)const {
+		const cv::Point2d p = this->position(blob, frame);
+		return !this->occluder_.contains(cv::Point(static_cast<int>(p.x), static_cast<int>(p.y)));
+	}
+
+	void render(std::size_t frame, cv::Mat& image)const {
+		image.create(this->params_.height, this->params_.width, CV_8UC3);
+		image.setTo(cv::Scalar(100, 120, 100));
+		for (const auto& blob : this->blobs_) {
+			const cv::Point2d p = this->position(blob, frame);
+			cv::circle(image, cv::Point(static_cast<int>(p.x), static_cast<int>(p.y)), this->params_.radius, cv::Scalar(30, 30, 220), -1);
+		}
+		if (this->occluder_.area() > 0) {
+			cv::rectangle(image, this->occluder_, cv::Scalar(100, 120, 100), -1);
+		}
+		if (this->params_.noise > 0) {
+			cv::Mat noise(image.size(), CV_16SC3);
+			cv::RNG rng(this->params_.seed + static_cast<unsigned int>(frame) + 1);
+			rng.fill(noise, cv::RNG::NORMAL, 0, this->params_.noise);
+			cv::Mat noisy;
+			image.convertTo(noisy, CV_16SC3);
+			noisy += noise;
+			noisy.convertTo(image, CV_8UC3);
+		}
+	}
+
+	std::size_t groundTruth()const {
+		std::size_t count = 0;
+		const std::size_t last = this->params_.frames - 1;
+		for (const auto& blob : this->blobs_) {
+			if (this->isVisible(blob, 0) && ::isInRange(blob.phase)) {
+				count++;
+			}
+			for (std::size_t f = 1; f <= last; ++f) {
+				count += ::crossings(blob.phase + blob.speed * (f - 1), blob.phase + blob.speed * f);
+			}
+			if (this->isVisible(blob, last) && !::isInRange(blob.phase + blob.speed * last)) {
+				count++;
+			}
+		}
+		return count;
+	}
+};
+
+/**
+ * \param[in] video if not empty, the frames are also encoded to this MJPG video
+ */
+int generate(const SynthParameters& params, const boost::filesystem::path& output, const boost::filesystem::path& truth, const boost::filesystem::path& video) {
+	namespace bf = boost::filesystem;
+	bf::create_directories(output);
+	SyntheticTimeLapse lapse(params);
+	cv::VideoWriter writer;
+	if (!video.empty() && !writer.open(video.string(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, cv::Size(params.width, params.height))) {
+		std::cerr << "ERROR: can not write " << video << std::endl;
+		return -1;
+	}
+	cv::Mat image;
+	for (std::size_t f = 0; f < params.frames; ++f) {
+		lapse.render(f, image);
+		std::stringstream ss;
+		ss << std::setw(8) << std::setfill('0') << f << "." << params.format;
+		if (!cv::imwrite((output / ss.str()).string(), image)) {
+			std::cerr << "ERROR: can not write " << (output / ss.str()) << std::endl;
+			return -1;
+		}
+		if (writer.isOpened()) {
+			writer.write(image);
+		}
+	}
+	std::ofstream ofs(truth.string());
+	ofs << "frames " << params.frames << "\n"
+		<< "count " << lapse.groundTruth() << "\n";
+	std::cout << "TRUTH: " << lapse.groundTruth() << std::endl;
+	return ofs ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+	namespace bp = boost::program_options;
+	namespace bf = boost::filesystem;
+	SynthParameters params;
+	bp::options_description general_opt("Allowed Options");
+	general_opt.add_options()
+		("help,h", "Show help")
+		("output,o", bp::value<bf::path>(), "Output timelapse directory.")
+		("truth,t", bp::value<bf::path>(), "Ground truth file (default: <output>.truth.txt).")
+		("width", bp::value<int>(&params.width)->default_value(params.width), "Frame width.")
+		("height", bp::value<int>(&params.height)->default_value(params.height), "Frame height.")
+		("frames", bp::value<std::size_t>(&params.frames)->default_value(params.frames), "Number of frames.")
+		("fruits", bp::value<int>(&params.fruits)->default_value(params.fruits), "Number of tomatoes.")
+		("speed", bp::value<double>(&params.speed)->default_value(params.speed), "Angular speed in rad/frame.")
+		("radius", bp::value<int>(&params.radius)->default_value(params.radius), "Tomato radius in pixels.")
+		("occlusion", bp::value<double>(&params.occlusion)->default_value(params.occlusion), "Width of the occluding bar as a fraction of the frame width.")
+		("noise", bp::value<double>(&params.noise)->default_value(params.noise), "Standard deviation of gaussian pixel noise.")
+		("seed", bp::value<unsigned int>(&params.seed)->default_value(params.seed), "Random seed.")
+		("format", bp::value<std::string>(&params.format)->default_value(params.format), "Image file extension.")
+		("video", bp::value<bf::path>(), "Also write the frames to this MJPG video (.avi).");
+	bp::variables_map map;
+	try {
+		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
+		bp::notify(map);
+	}
+	catch (const bp::error& e) {
+		std::cerr << "ERROR:" << e.what() << std::endl;
+		return -1;
+	}
+	if (map.count("help")) {
+		std::cout << general_opt;
+	}
+	if (!map.count("output") || params.frames == 0) {
+		std::cerr << "ERROR: You must be set 'output' option!!." << std::endl;
+		return -1;
+	}
+	const auto output = map["output"].as<bf::path>();
+	const auto truth = map.count("truth") ? map["truth"].as<bf::path>() : bf::path(output.string() + ".truth.txt");
+	const auto video = map.count("video") ? map["video"].as<bf::path>() : bf::path();
+	return ::generate(params, output, truth, video);
+}
@@ -1,21 +1,41 @@
 #include <iostream>
 #include <vector>
+#include <atomic>
 #include <algorithm>
+#include <random>
+#include <iomanip>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
+#include <boost/thread.hpp>
 #include "HogUtil.hpp"
+#include "HogModel.hpp"
+#include "FastHog.hpp"
+#include "FeatureFile.hpp"
+#include "LinearSvm.hpp"
+#include "CropDataset.hpp"
+
+/**
+ * Features of a grayscale image of exactly the window size, such as a dataset crop.
+ */
+void calcWindowDescripter(const cv::Mat& gray, std::vector<float>& desc) {
+	// read only, so the mining threads can share it
+	static const FastHog hog;
+	hog.compute(gray, desc);
+}
 
 void calcHOGDescripter(const cv::Mat& img, std::vector<float>& desc) {
-	static auto hog = ::getDefaultHOGDescriptor();
-	hog.winSize = ::getHOGWinSize();
 	cv::Mat gray;
 	cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
 	cv::resize(gray, gray, ::getHOGWinSize());
-	hog.compute(gray, desc, cv::Size(8, 8), cv::Size(0, 0));
+	::calcWindowDescripter(gray, desc);
 }
 
 void descriptorToTraindata(const std::vector<std::vector<float>>& descs, cv::Mat& train_data) {
+	if (descs.empty()) {
+		train_data.release();
+		return;
+	}
 	const std::size_t rows = descs.size();
 	const std::size_t cols = descs[0].size();
 	train_data = cv::Mat(rows, cols, CV_32FC1);
@@ -39,62 +59,243 @@ void listDirectoryContents(const boost::filesystem::path& dir, std::vector<boost
 	}
 }
 
-void createTraindataLabel(const boost::filesystem::path& positive_path, const boost::filesystem::path& negative_path, cv::Mat& train_data, std::vector<int>& labels) {
+bool isCropDataset(const boost::filesystem::path& path) {
+	return boost::filesystem::is_regular_file(path) && CropDataset::isDataset(path.string());
+}
+
+/**
+ * Opens a crop dataset of the HOG window size and collects the crops to train on.
+ * With label 0 each crop keeps the label it was stored with and unlabeled crops are
+ * skipped, otherwise every crop gets label.
+ */
+bool listDatasetCrops(CropDataset& dataset, const boost::filesystem::path& path, int label, std::vector<std::size_t>& crops, std::vector<int>& crop_labels) {
+	crops.clear();
+	crop_labels.clear();
+	if (!dataset.open(path.string())) {
+		std::cerr << "ERROR: can not read " << path << std::endl;
+		return false;
+	}
+	if (dataset.cropSize() != ::getHOGWinSize()) {
+		std::cerr << "ERROR: crops of " << path << " are not of the HOG window size" << std::endl;
+		return false;
+	}
+	for (std::size_t i = 0; i < dataset.size(); ++i) {
+		const int l = label != 0 ? label : dataset.label(i);
+		// the writer can not resize an empty rect, so a crop with one is corrupt
+		if (dataset.isCrop(i) && l != 0 && dataset.rect(i).area() > 0) {
+			crops.push_back(i);
+			crop_labels.push_back(l > 0 ? 1 : -1);
+		}
+	}
+	return true;
+}
+
+/**
+ * Appends the features of the images under a directory, or of the crops of a dataset, to features.
+ */
+void addTrainSamples(const boost::filesystem::path& path, int label, std::vector<std::vector<float>>& features, std::vector<int>& labels) {
 	namespace bf = boost::filesystem;
-	const int POSITIVE_LABEL = 1;
-	const int NEGATIVE_LABEL = -1;
-	std::vector<std::vector<float>> features;
-	labels.clear();
-	std::vector<bf::path> pos_files;
-	::listDirectoryContents(positive_path, pos_files);
-	for (const auto& f : pos_files) {
-		std::cout << "POS_IMAGE:" << f << std::endl;
-		cv::Mat img = cv::imread(f.string());
-		if (img.empty())
-			continue;
-		std::vector<float> desc;
-		::calcHOGDescripter(img, desc);
-		features.push_back(desc);
-		labels.push_back(POSITIVE_LABEL);
+	if (::isCropDataset(path)) {
+		CropDataset dataset;
+		std::vector<std::size_t> crops;
+		std::vector<int> crop_labels;
+		if (!::listDatasetCrops(dataset, path, label, crops, crop_labels)) {
+			return;
+		}
+		std::cout << "DATASET:" << path << " " << crops.size() << " crops" << std::endl;
+		for (std::size_t i = 0; i < crops.size(); ++i) {
+			std::vector<float> desc;
+			::calcWindowDescripter(dataset.image(crops[i]), desc);
+			features.push_back(desc);
+			labels.push_back(crop_labels[i]);
+		}
+		return;
 	}
-	std::vector<bf::path> neg_files;
-	::listDirectoryContents(negative_path, neg_files);
-	for (const auto& f : neg_files) {
-		std::cout << "NEG_IMAGE:" << f << std::endl;
+	std::vector<bf::path> files;
+	::listDirectoryContents(path, files);
+	for (const auto& f : files) {
+		std::cout << (label > 0 ? "POS_IMAGE:" : "NEG_IMAGE:") << f << std::endl;
 		cv::Mat img = cv::imread(f.string());
 		if (img.empty())
 			continue;
 		std::vector<float> desc;
 		::calcHOGDescripter(img, desc);
 		features.push_back(desc);
-		labels.push_back(NEGATIVE_LABEL);
+		labels.push_back(label);
+	}
+}
+
+/**
+ * \param[in] positive_path positive image directory or crop dataset, may be empty
+ * \param[in] negative_path negative image directory or crop dataset, may be empty
+ * \param[in] datasets crop datasets whose stored labels are used
+ * \param[out] train_data one row per sample, empty if no sample was found
+ */
+void createTraindataLabel(const boost::filesystem::path& positive_path, const boost::filesystem::path& negative_path, const std::vector<boost::filesystem::path>& datasets, cv::Mat& train_data, std::vector<int>& labels) {
+	const int POSITIVE_LABEL = 1;
+	const int NEGATIVE_LABEL = -1;
+	std::vector<std::vector<float>> features;
+	labels.clear();
+	if (!positive_path.empty()) {
+		::addTrainSamples(positive_path, POSITIVE_LABEL, features, labels);
+	}
+	if (!negative_path.empty()) {
+		::addTrainSamples(negative_path, NEGATIVE_LABEL, features, labels);
+	}
+	for (const auto& dataset : datasets) {
+		::addTrainSamples(dataset, 0, features, labels);
+	}
+	if (labels.empty()) {
+		train_data.release();
+		return;
 	}
 	::descriptorToTraindata(features, train_data);
 }
 
-void get_svm_detector(const cv::Ptr<cv::ml::SVM>& svm, std::vector< float > & hog_detector)
-{
-	cv::Mat sv = svm->getSupportVectors();
-	const int sv_total = sv.rows;
-	// get the decision function
-	cv::Mat alpha, svidx;
-	double rho = svm->getDecisionFunction(0, alpha, svidx);
-	CV_Assert(alpha.total() == 1 && svidx.total() == 1 && sv_total == 1);
-	CV_Assert((alpha.type() == CV_64F && alpha.at<double>(0) == 1.) ||
-		(alpha.type() == CV_32F && alpha.at<float>(0) == 1.f));
-	CV_Assert(sv.type() == CV_32F);
-	hog_detector.clear();
-	hog_detector.resize(sv.cols + 1);
-	memcpy(&hog_detector[0], sv.ptr(), sv.cols*sizeof(hog_detector[0]));
-	hog_detector[sv.cols] = (float)-rho;
-}
-
-void train(const boost::filesystem::path& positive_path, const boost::filesystem::path& negative_path, const boost::filesystem::path& output_path) {
-	cv::Mat train_data;
-	std::vector<int> labels;
-	std::cout << "POS:" << positive_path << std::endl;
-	std::cout << "NEG:" << negative_path << std::endl;
-	::createTraindataLabel(positive_path, negative_path, train_data, labels);
+struct MiningParameters {
+	/** full frames without tomatoes; every detection in them is a false positive */
+	std::vector<boost::filesystem::path> frames;
+	std::size_t rounds = 0;
+	/** memory for the features mined per round */
+	std::size_t budget_bytes = 256 * 1024 * 1024;
+	double hit_threshold = 0.0;
+	std::size_t threads = 0;
+};
+
+struct MinedWindow {
+	std::size_t frame;
+	cv::Rect rect;
+	double score;
+};
+
+bool higherScore(const MinedWindow& a, const MinedWindow& b) {
+	return a.score > b.score;
+}
+
+/**
+ * Runs detector over the mining frames at all scales and appends the features of the
+ * highest-scoring false positives, as many as fit in the budget, to the training data.
+ * Returns the number of windows added.
+ */
+std::size_t mineHardNegatives(const MiningParameters& params, const std::vector<float>& detector, cv::Mat& train_data, std::vector<int>& labels) {
+	const int NEGATIVE_LABEL = -1;
+	const std::size_t descriptor_size = FastHog::DESCRIPTOR_SIZE;
+	const std::size_t max_windows = std::max<std::size_t>(1, params.budget_bytes / (descriptor_size * sizeof(float)));
+	const std::size_t threads = params.threads > 0 ? params.threads : std::max(1u, boost::thread::hardware_concurrency());
+	std::vector<std::vector<MinedWindow>> found(threads);
+	std::atomic<std::size_t> next(0);
+	boost::mutex warning_mutex;
+	boost::thread_group group;
+	for (std::size_t t = 0; t < threads; ++t) {
+		group.create_thread([&, t]() {
+			// the frames are already spread over the threads
+			FastHog hog(1);
+			hog.setSVMDetector(detector);
+			std::vector<cv::Rect> rects;
+			std::vector<double> weights;
+			auto& windows = found[t];
+			for (std::size_t i = next++; i < params.frames.size(); i = next++) {
+				cv::Mat img = cv::imread(params.frames[i].string());
+				if (img.empty()) {
+					boost::mutex::scoped_lock l(warning_mutex);
+					std::cerr << "WARNING: can not read " << params.frames[i] << ", skipped" << std::endl;
+					continue;
+				}
+				// no grouping: every window above the threshold is a separate negative
+				hog.detectMultiScale(img, rects, weights, params.hit_threshold, 1.05, 0);
+				for (std::size_t r = 0; r < rects.size(); ++r) {
+					const cv::Rect rect = rects[r] & cv::Rect(0, 0, img.cols, img.rows);
+					if (rect.area() > 0) {
+						windows.push_back(MinedWindow{ i, rect, weights[r] });
+					}
+				}
+				// only the best max_windows of this thread can make it into the global top
+				if (windows.size() > 2 * max_windows) {
+					std::nth_element(windows.begin(), windows.begin() + max_windows, windows.end(), ::higherScore);
+					windows.resize(max_windows);
+				}
+			}
+		});
+	}
+	group.join_all();
+	std::vector<MinedWindow> windows;
+	for (const auto& w : found) {
+		windows.insert(windows.end(), w.begin(), w.end());
+	}
+	if (windows.size() > max_windows) {
+		std::nth_element(windows.begin(), windows.begin() + max_windows, windows.end(), ::higherScore);
+		windows.resize(max_windows);
+	}
+	if (windows.empty()) {
+		return 0;
+	}
+	// group by frame so each frame is decoded once, then fill the rows in parallel
+	std::sort(windows.begin(), windows.end(), [](const MinedWindow& a, const MinedWindow& b) {
+		return a.frame < b.frame;
+	});
+	std::vector<std::size_t> starts;
+	for (std::size_t i = 0; i < windows.size(); ++i) {
+		if (i == 0 || windows[i].frame != windows[i - 1].frame) {
+			starts.push_back(i);
+		}
+	}
+	starts.push_back(windows.size());
+	cv::Mat mined(static_cast<int>(windows.size()), static_cast<int>(descriptor_size), CV_32FC1);
+	// a frame can disappear or change between the two passes; its windows are dropped
+	std::vector<char> extracted(windows.size(), 0);
+	next = 0;
+	boost::thread_group extractors;
+	for (std::size_t t = 0; t < threads; ++t) {
+		extractors.create_thread([&]() {
+			std::vector<float> desc;
+			for (std::size_t g = next++; g + 1 < starts.size(); g = next++) {
+				const auto& path = params.frames[windows[starts[g]].frame];
+				cv::Mat img = cv::imread(path.string());
+				if (img.empty()) {
+					boost::mutex::scoped_lock l(warning_mutex);
+					std::cerr << "WARNING: can not read " << path << ", its windows are skipped" << std::endl;
+					continue;
+				}
+				const cv::Rect bounds(0, 0, img.cols, img.rows);
+				for (std::size_t i = starts[g]; i < starts[g + 1]; ++i) {
+					if ((windows[i].rect & bounds) != windows[i].rect) {
+						continue;
+					}
+					::calcHOGDescripter(img(windows[i].rect), desc);
+					std::copy(desc.begin(), desc.end(), mined.ptr<float>(static_cast<int>(i)));
+					extracted[i] = 1;
+				}
+			}
+		});
+	}
+	extractors.join_all();
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < windows.size(); ++i) {
+		if (extracted[i]) {
+			mined.row(static_cast<int>(i)).copyTo(mined.row(static_cast<int>(count++)));
+		}
+	}
+	if (count == 0) {
+		return 0;
+	}
+	train_data.push_back(mined.rowRange(0, static_cast<int>(count)));
+	labels.insert(labels.end(), count, NEGATIVE_LABEL);
+	return count;
+}
+
+struct SvmParameters {
+	/** cv::ml::SVM::EPS_SVR or cv::ml::SVM::C_SVC */
+	int type = cv::ml::SVM::EPS_SVR;
+	double c = 0.01;
+	/** epsilon of EPS_SVR */
+	double p = 0.1;
+};
+
+std::string svmTypeName(int type) {
+	return type == cv::ml::SVM::C_SVC ? "c_svc" : "eps_svr";
+}
+
+cv::Ptr<cv::ml::SVM> trainSvm(const cv::Mat& train_data, const std::vector<int>& labels, const SvmParameters& params = SvmParameters()) {
 	cv::Ptr<cv::ml::SVM> svm = cv::ml::SVM::create();
 	svm->setCoef0(0.0);
 	svm->setDegree(3);
@@ -102,16 +303,296 @@ void train(const boost::filesystem::path& positive_path, const boost::filesystem
 	svm->setGamma(0);
 	svm->setKernel(cv::ml::SVM::LINEAR);
 	svm->setNu(0.5);
-	svm->setP(0.1); // for EPSILON_SVR, epsilon in loss function?
-	svm->setC(0.01); // From paper, soft classifier
-	svm->setType(cv::ml::SVM::EPS_SVR); // C_SVC; // EPSILON_SVR; // may be also NU_SVR; // do regression task
+	svm->setP(params.p); // for EPSILON_SVR, epsilon in loss function?
+	svm->setC(params.c); // From paper, soft classifier
+	svm->setType(params.type); // C_SVC; // EPSILON_SVR; // may be also NU_SVR; // do regression task
 	svm->train(train_data, cv::ml::ROW_SAMPLE, cv::Mat(labels));
+	return svm;
+}
+
+struct SearchParameters {
+	/** no search if empty */
+	std::vector<SvmParameters> grid;
+	std::size_t folds = 5;
+	std::size_t threads = 0;
+	unsigned int seed = 0;
+};
+
+struct SearchResult {
+	SvmParameters params;
+	/** summed over the validation folds */
+	std::size_t tp = 0;
+	std::size_t fp = 0;
+	std::size_t fn = 0;
+	std::size_t tn = 0;
+	double precision()const { return tp + fp > 0 ? static_cast<double>(tp) / (tp + fp) : 0.0; }
+	double recall()const { return tp + fn > 0 ? static_cast<double>(tp) / (tp + fn) : 0.0; }
+	double f1()const {
+		const double p = this->precision();
+		const double r = this->recall();
+		return p + r > 0 ? 2 * p * r / (p + r) : 0.0;
+	}
+};
+
+/**
+ * Evaluates every point of the grid by k-fold cross-validation on the features computed once,
+ * training the folds of all grid points in parallel. A validation window is a detection when the
+ * collapsed linear detector scores it above 0, as in detect.
+ * \param[out] best_params the point with the best F1
+ * \return false if a class has fewer samples than folds, so some training fold would miss it, or if training failed
+ */
+bool searchSvmParameters(const SearchParameters& search, const cv::Mat& train_data, const std::vector<int>& labels, SvmParameters& best_params) {
+	// stratified folds: each class is shuffled and dealt round-robin
+	std::vector<std::size_t> fold_of(labels.size());
+	std::mt19937 rng(search.seed);
+	for (const int label : { 1, -1 }) {
+		std::vector<std::size_t> rows;
+		for (std::size_t i = 0; i < labels.size(); ++i) {
+			if (labels[i] == label) {
+				rows.push_back(i);
+			}
+		}
+		if (rows.size() < search.folds) {
+			std::cerr << "ERROR: " << search.folds << "-fold cross-validation needs " << search.folds << " or more "
+				<< (label > 0 ? "positive" : "negative") << " samples, got " << rows.size() << std::endl;
+			return false;
+		}
+		std::shuffle(rows.begin(), rows.end(), rng);
+		for (std::size_t i = 0; i < rows.size(); ++i) {
+			fold_of[rows[i]] = i % search.folds;
+		}
+	}
+	std::vector<SearchResult> results(search.grid.size());
+	for (std::size_t g = 0; g < search.grid.size(); ++g) {
+		results[g].params = search.grid[g];
+	}
+	boost::mutex results_mutex;
+	std::string error;
+	const std::size_t tasks = search.grid.size() * search.folds;
+	const std::size_t threads = search.threads > 0 ? search.threads : std::max(1u, boost::thread::hardware_concurrency());
+	std::atomic<std::size_t> next(0);
+	boost::thread_group group;
+	for (std::size_t t = 0; t < std::min(threads, tasks); ++t) {
+		group.create_thread([&]() {
+			for (std::size_t task = next++; task < tasks; task = next++) {
+				const std::size_t g = task / search.folds;
+				const std::size_t fold = task % search.folds;
+				cv::Mat fold_data;
+				std::vector<int> fold_labels;
+				for (std::size_t i = 0; i < labels.size(); ++i) {
+					if (fold_of[i] != fold) {
+						fold_data.push_back(train_data.row(static_cast<int>(i)));
+						fold_labels.push_back(labels[i]);
+					}
+				}
+				SearchResult counts;
+				std::vector<float> detector;
+				// an exception escaping a boost thread would terminate the program
+				try {
+					::get_svm_detector(::trainSvm(fold_data, fold_labels, search.grid[g]), detector);
+				}
+				catch (const std::exception& e) {
+					boost::mutex::scoped_lock l(results_mutex);
+					if (error.empty()) {
+						error = e.what();
+					}
+					continue;
+				}
+				for (std::size_t i = 0; i < labels.size(); ++i) {
+					if (fold_of[i] != fold) {
+						continue;
+					}
+					const float* x = train_data.ptr<float>(static_cast<int>(i));
+					double score = detector.back();
+					for (std::size_t d = 0; d + 1 < detector.size(); ++d) {
+						score += detector[d] * x[d];
+					}
+					const bool detected = score > 0;
+					const bool positive = labels[i] > 0;
+					counts.tp += detected && positive;
+					counts.fp += detected && !positive;
+					counts.fn += !detected && positive;
+					counts.tn += !detected && !positive;
+				}
+				boost::mutex::scoped_lock l(results_mutex);
+				results[g].tp += counts.tp;
+				results[g].fp += counts.fp;
+				results[g].fn += counts.fn;
+				results[g].tn += counts.tn;
+			}
+		});
+	}
+	group.join_all();
+	if (!error.empty()) {
+		std::cerr << "ERROR: cross-validation training failed: " << error << std::endl;
+		return false;
+	}
+	std::size_t best = 0;
+	std::cout << search.folds << "-FOLD CROSS-VALIDATION" << std::endl;
+	std::cout << std::setw(8) << "type" << std::setw(10) << "C" << std::setw(10) << "p"
+		<< std::setw(11) << "precision" << std::setw(8) << "recall" << std::setw(8) << "F1" << std::endl;
+	for (std::size_t g = 0; g < results.size(); ++g) {
+		const auto& r = results[g];
+		std::cout << std::setw(8) << ::svmTypeName(r.params.type) << std::setw(10) << r.params.c << std::setw(10) << r.params.p
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(11) << r.precision() << std::setw(8) << r.recall() << std::setw(8) << r.f1()
+			<< std::defaultfloat << std::setprecision(6) << std::endl;
+		if (r.f1() > results[best].f1()) {
+			best = g;
+		}
+	}
+	const auto& b = results[best].params;
+	std::cout << "BEST: " << ::svmTypeName(b.type) << " C=" << b.c << " p=" << b.p
+		<< " F1=" << std::fixed << std::setprecision(3) << results[best].f1() << std::defaultfloat << std::setprecision(6) << std::endl;
+	best_params = b;
+	return true;
+}
+
+bool train(const boost::filesystem::path& positive_path, const boost::filesystem::path& negative_path, const std::vector<boost::filesystem::path>& datasets, const boost::filesystem::path& output_path, const boost::filesystem::path& model_path, const MiningParameters& mining, const SearchParameters& search) {
+	cv::Mat train_data;
+	std::vector<int> labels;
+	std::cout << "POS:" << positive_path << std::endl;
+	std::cout << "NEG:" << negative_path << std::endl;
+	::createTraindataLabel(positive_path, negative_path, datasets, train_data, labels);
+	if (labels.empty()) {
+		std::cerr << "ERROR: no training samples" << std::endl;
+		return false;
+	}
+	SvmParameters params;
+	if (!search.grid.empty() && !::searchSvmParameters(search, train_data, labels, params)) {
+		return false;
+	}
+	cv::Ptr<cv::ml::SVM> svm = ::trainSvm(train_data, labels, params);
+	for (std::size_t round = 1; round <= mining.rounds; ++round) {
+		std::vector<float> hog_detector;
+		::get_svm_detector(svm, hog_detector);
+		const std::size_t mined = ::mineHardNegatives(mining, hog_detector, train_data, labels);
+		std::cout << "ROUND " << round << ": " << mined << " hard negatives" << std::endl;
+		if (mined == 0) {
+			break;
+		}
+		svm = ::trainSvm(train_data, labels, params);
+	}
 	std::vector<float> result;
 	svm->predict(train_data, result);
 	for (const auto& r : result) {
 		std::cout << r << std::endl;
 	}
 	svm->save(output_path.string());
+	std::vector<float> hog_detector;
+	::get_svm_detector(svm, hog_detector);
+	if (!HogModel::save(model_path.string(), ::getDefaultHOGDescriptor(), hog_detector)) {
+		std::cerr << "ERROR: can not write " << model_path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Appends the features of count samples to writer, computing a chunk of samples in parallel
+ * at a time so that memory stays bounded by the chunk. compute(i, desc) returns the label of
+ * sample i, or 0 to leave it out. Returns the number of rows written.
+ */
+template<class Compute>
+std::size_t appendFeatures(std::size_t count, Compute compute, std::size_t threads, FeatureFileWriter& writer) {
+	const std::size_t chunk_size = 64 * threads;
+	std::vector<std::vector<float>> chunk;
+	std::vector<int> chunk_labels;
+	std::size_t written = 0;
+	for (std::size_t begin = 0; begin < count; begin += chunk_size) {
+		const std::size_t end = std::min(begin + chunk_size, count);
+		chunk.assign(end - begin, std::vector<float>());
+		chunk_labels.assign(end - begin, 0);
+		std::atomic<std::size_t> next(begin);
+		boost::thread_group group;
+		for (std::size_t t = 0; t < threads; ++t) {
+			group.create_thread([&]() {
+				for (std::size_t i = next++; i < end; i = next++) {
+					chunk_labels[i - begin] = compute(i, chunk[i - begin]);
+				}
+			});
+		}
+		group.join_all();
+		for (std::size_t i = 0; i < chunk.size(); ++i) {
+			if (chunk_labels[i] != 0 && !chunk[i].empty() && writer.append(static_cast<float>(chunk_labels[i]), chunk[i])) {
+				written++;
+			}
+		}
+	}
+	return written;
+}
+
+/**
+ * Appends the features of the images under a directory, or of the crops of a dataset, to writer.
+ */
+std::size_t appendFeatures(const boost::filesystem::path& path, int label, std::size_t threads, FeatureFileWriter& writer) {
+	namespace bf = boost::filesystem;
+	if (::isCropDataset(path)) {
+		CropDataset dataset;
+		std::vector<std::size_t> crops;
+		std::vector<int> crop_labels;
+		if (!::listDatasetCrops(dataset, path, label, crops, crop_labels)) {
+			return 0;
+		}
+		return ::appendFeatures(crops.size(), [&](std::size_t i, std::vector<float>& desc) {
+			::calcWindowDescripter(dataset.image(crops[i]), desc);
+			return crop_labels[i];
+		}, threads, writer);
+	}
+	std::vector<bf::path> files;
+	::listDirectoryContents(path, files);
+	return ::appendFeatures(files.size(), [&](std::size_t i, std::vector<float>& desc) {
+		cv::Mat img = cv::imread(files[i].string());
+		if (img.empty()) {
+			return 0;
+		}
+		::calcHOGDescripter(img, desc);
+		return label;
+	}, threads, writer);
+}
+
+bool writeFeatureFile(const boost::filesystem::path& positive_path, const boost::filesystem::path& negative_path, const std::vector<boost::filesystem::path>& datasets, const boost::filesystem::path& features_path, std::size_t threads) {
+	FeatureFileWriter writer;
+	if (!writer.open(features_path.string(), ::getDefaultHOGDescriptor().getDescriptorSize())) {
+		return false;
+	}
+	if (!positive_path.empty()) {
+		std::cout << "POS:" << positive_path << " " << ::appendFeatures(positive_path, 1, threads, writer) << " images" << std::endl;
+	}
+	if (!negative_path.empty()) {
+		std::cout << "NEG:" << negative_path << " " << ::appendFeatures(negative_path, -1, threads, writer) << " images" << std::endl;
+	}
+	for (const auto& dataset : datasets) {
+		std::cout << "DATASET:" << dataset << " " << ::appendFeatures(dataset, 0, threads, writer) << " crops" << std::endl;
+	}
+	return writer.close();
+}
+
+/**
+ * Trains from a feature file on disk with the streaming linear solver.
+ * Only the binary HOG model is written; there is no OpenCV SVM to save.
+ */
+bool trainStreaming(const boost::filesystem::path& features_path, const boost::filesystem::path& model_path, const LinearSvmParameters& params) {
+	FeatureFile features;
+	if (!features.open(features_path.string())) {
+		std::cerr << "ERROR: can not read " << features_path << std::endl;
+		return false;
+	}
+	if (features.dims() != ::getDefaultHOGDescriptor().getDescriptorSize()) {
+		std::cerr << "ERROR: " << features_path << " does not hold HOG features of the default window" << std::endl;
+		return false;
+	}
+	std::cout << "FEATURES:" << features_path << " " << features.size() << " rows" << std::endl;
+	std::vector<float> hog_detector;
+	if (!::trainLinearSvm(features, params, hog_detector)) {
+		std::cerr << "ERROR: training failed" << std::endl;
+		return false;
+	}
+	if (!HogModel::save(model_path.string(), ::getDefaultHOGDescriptor(), hog_detector)) {
+		std::cerr << "ERROR: can not write " << model_path << std::endl;
+		return false;
+	}
+	return true;
 }
 
 int main(int argc, char** argv) {
@@ -120,9 +601,34 @@ int main(int argc, char** argv) {
 	bp::options_description general_opt("Allowed Options");
 	general_opt.add_options()
 		("help,h", "Show help")
-		("positive,p", bp::value<bf::path>(), "Positive image directory.")
-		("negative,n", bp::value<bf::path>(), "Negative image directory.")
-		("output,o", bp::value<bf::path>(), "Train data output path.");
+		("positive,p", bp::value<bf::path>(), "Positive image directory or crop dataset.")
+		("negative,n", bp::value<bf::path>(), "Negative image directory or crop dataset.")
+		("dataset,d", bp::value<std::vector<bf::path>>()->multitoken(), "Crop datasets trained with the labels stored in them (unlabeled crops are skipped).")
+		("output,o", bp::value<bf::path>(), "Train data output path.")
+		("model,m", bp::value<bf::path>(), "Binary HOG model output path (default: output path with .hogmodel extension).");
+	bp::options_description mining_opt("Hard Negative Mining Options");
+	mining_opt.add_options()
+		("rounds,r", bp::value<std::size_t>()->default_value(0), "Rounds of mining false positives and retraining.")
+		("mining-frames", bp::value<bf::path>(), "Directory of full frames without tomatoes (default: negative directory, required if it is a crop dataset).")
+		("mining-budget", bp::value<std::size_t>()->default_value(256), "Memory for the features mined per round in MiB.")
+		("mining-threshold", bp::value<double>()->default_value(0.0), "SVM score above which a window is a false positive.")
+		("threads,j", bp::value<std::size_t>()->default_value(0), "Mining, search and sgd threads (0: number of hardware threads).");
+	bp::options_description solver_opt("Solver Options");
+	solver_opt.add_options()
+		("solver", bp::value<std::string>()->default_value("opencv"), "SVM solver: opencv (in memory) | sgd (streams features from disk).")
+		("features", bp::value<bf::path>(), "Feature file for the sgd solver (default: output path with .features extension). Written from the image directories and datasets if they are given, otherwise read.")
+		("epochs", bp::value<std::size_t>()->default_value(5), "Passes over the feature file for the sgd solver.")
+		("lambda", bp::value<double>()->default_value(1e-4), "Regularization of the sgd solver.");
+	bp::options_description search_opt("Parameter Search Options");
+	search_opt.add_options()
+		("search", "Choose the SVM type, C and p by cross-validation over the grid below before training (opencv solver).")
+		("folds,k", bp::value<std::size_t>()->default_value(5), "Cross-validation folds.")
+		("grid-type", bp::value<std::vector<std::string>>()->multitoken()->default_value(std::vector<std::string>{ "eps_svr", "c_svc" }, "eps_svr c_svc"), "SVM types to try: eps_svr, c_svc.")
+		("grid-c", bp::value<std::vector<double>>()->multitoken()->default_value(std::vector<double>{ 0.001, 0.01, 0.1, 1.0 }, "0.001 0.01 0.1 1"), "Values of C to try.")
+		("grid-p", bp::value<std::vector<double>>()->multitoken()->default_value(std::vector<double>{ 0.01, 0.1, 0.5 }, "0.01 0.1 0.5"), "Values of the EPS_SVR epsilon to try.");
+	general_opt.add(mining_opt);
+	general_opt.add(solver_opt);
+	general_opt.add(search_opt);
 	bp::variables_map map;
 	try {
 		bp::store(bp::parse_command_line(argc, argv, general_opt), map);
@@ -135,11 +641,96 @@ int main(int argc, char** argv) {
 	if (map.count("help")) {
 		std::cout << general_opt;
 	}
-	if (map.count("positive") && map.count("negative") && map.count("output")) {
-		::train(map["positive"].as<bf::path>(), map["negative"].as<bf::path>(), map["output"].as<bf::path>());
+	const auto positive_path = map.count("positive") ? map["positive"].as<bf::path>() : bf::path();
+	const auto negative_path = map.count("negative") ? map["negative"].as<bf::path>() : bf::path();
+	const auto datasets = map.count("dataset") ? map["dataset"].as<std::vector<bf::path>>() : std::vector<bf::path>();
+	const bool has_samples = (map.count("positive") && map.count("negative")) || !datasets.empty();
+	const auto solver = map["solver"].as<std::string>();
+	if (solver != "opencv" && solver != "sgd") {
+		std::cerr << "ERROR: unknown solver " << solver << std::endl;
+		return -1;
+	}
+	if (solver == "sgd") {
+		if (!map.count("output") && !map.count("model")) {
+			std::cerr << "ERROR: You must be set 'output' or 'model' option!!." << std::endl;
+			return -1;
+		}
+		if (map["rounds"].as<std::size_t>() > 0) {
+			std::cerr << "ERROR: hard negative mining is not supported by the sgd solver" << std::endl;
+			return -1;
+		}
+		if (map.count("search")) {
+			std::cerr << "ERROR: parameter search is not supported by the sgd solver" << std::endl;
+			return -1;
+		}
+		const auto output_path = map.count("output") ? map["output"].as<bf::path>() : map["model"].as<bf::path>();
+		const auto model_path = map.count("model")
+			? map["model"].as<bf::path>()
+			: bf::path(output_path).replace_extension(".hogmodel");
+		const auto features_path = map.count("features")
+			? map["features"].as<bf::path>()
+			: bf::path(output_path).replace_extension(".features");
+		LinearSvmParameters params;
+		params.epochs = map["epochs"].as<std::size_t>();
+		params.lambda = map["lambda"].as<double>();
+		params.threads = map["threads"].as<std::size_t>();
+		if (has_samples) {
+			const std::size_t threads = params.threads > 0 ? params.threads : std::max(1u, boost::thread::hardware_concurrency());
+			if (!::writeFeatureFile(positive_path, negative_path, datasets, features_path, threads)) {
+				std::cerr << "ERROR: can not write " << features_path << std::endl;
+				return -1;
+			}
+		}
+		return ::trainStreaming(features_path, model_path, params) ? 0 : -1;
+	}
+	if (has_samples && map.count("output")) {
+		const auto output_path = map["output"].as<bf::path>();
+		const auto model_path = map.count("model")
+			? map["model"].as<bf::path>()
+			: bf::path(output_path).replace_extension(".hogmodel");
+		MiningParameters mining;
+		mining.rounds = map["rounds"].as<std::size_t>();
+		mining.budget_bytes = map["mining-budget"].as<std::size_t>() * 1024 * 1024;
+		mining.hit_threshold = map["mining-threshold"].as<double>();
+		mining.threads = map["threads"].as<std::size_t>();
+		if (mining.rounds > 0) {
+			const auto frames_path = map.count("mining-frames") ? map["mining-frames"].as<bf::path>() : negative_path;
+			if (!bf::is_directory(frames_path)) {
+				std::cerr << "ERROR: You must be set 'mining-frames' option to a directory!!." << std::endl;
+				return -1;
+			}
+			::listDirectoryContents(frames_path, mining.frames);
+		}
+		SearchParameters search;
+		search.threads = map["threads"].as<std::size_t>();
+		search.folds = map["folds"].as<std::size_t>();
+		if (map.count("search")) {
+			if (search.folds < 2) {
+				std::cerr << "ERROR: You must be set 'folds' to 2 or more!!." << std::endl;
+				return -1;
+			}
+			for (const auto& name : map["grid-type"].as<std::vector<std::string>>()) {
+				if (name != "eps_svr" && name != "c_svc") {
+					std::cerr << "ERROR: unknown SVM type " << name << std::endl;
+					return -1;
+				}
+				SvmParameters point;
+				point.type = name == "c_svc" ? cv::ml::SVM::C_SVC : cv::ml::SVM::EPS_SVR;
+				for (const double c : map["grid-c"].as<std::vector<double>>()) {
+					point.c = c;
+					// p only matters to EPS_SVR
+					const auto ps = point.type == cv::ml::SVM::EPS_SVR ? map["grid-p"].as<std::vector<double>>() : std::vector<double>{ SvmParameters().p };
+					for (const double p : ps) {
+						point.p = p;
+						search.grid.push_back(point);
+					}
+				}
+			}
+		}
+		return ::train(positive_path, negative_path, datasets, output_path, model_path, mining, search) ? 0 : -1;
 	}
 	else {
-		std::cerr << "ERROR: You must be set 'positve', 'negative' and 'output' options!!." << std::endl;
+		std::cerr << "ERROR: You must be set 'positve' and 'negative' or 'dataset', and 'output' options!!." << std::endl;
 	}
 	return 0;
 }
\ No newline at end of file